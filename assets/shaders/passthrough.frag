@@ -1,16 +1,16 @@
 #version 330 core
-in vec2 vUV;                         
+in vec2 vUV;
 out vec4 FragColor;
 
-uniform sampler2D uTex;              
-uniform mat3 uAffine;                
+uniform sampler2D uTex;
+uniform mat3 uAffine;                // pixel-space output -> source mapping (affineMatrix)
 
 void main()
 {
-    vec3 p  = uAffine * vec3(vUV, 1.0);
-    vec2 uv = p.xy;
-
-    uv.y = 1.0 - uv.y;
+    vec2 size = vec2(textureSize(uTex, 0));
+    vec2 px = vec2(vUV.x, 1.0 - vUV.y) * size;
+    vec3 p  = uAffine * vec3(px, 1.0);
+    vec2 uv = p.xy / size;
 
     if (uv.x < 0.0 || uv.x > 1.0 || uv.y < 0.0 || uv.y > 1.0) {
         FragColor = vec4(0.0, 0.0, 0.0, 1.0);
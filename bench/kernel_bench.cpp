@@ -0,0 +1,339 @@
+// Microbenchmark of the CPU kernels on their own (no window, no GL): applyCpuFilter per
+// filter, warpCpuAffine per warp kind, processCpuFrame per filter graph (the fused passes the
+// application runs), affineMatrix, and the CPU side of a frame upload.
+// Every case runs over a sweep of frame sizes (and Pixelate block sizes) in two variants:
+//   warm - the frame was just written, so whatever fits in cache is still there
+//   cold - a buffer larger than the last-level cache is streamed before every iteration
+// and reports the median ns/pixel and the nominal bandwidth (one read + one write of the frame).
+// --check instead compares warpAffineBGR with a per-pixel bilinear reference and exits non-zero
+// if any channel is more than one level off.
+//
+// Usage: VisualComputing_2_microbench [--sizes 640x480,1920x1080,...] [--blocks 2,8,32]
+//                                     [--min-time S] [--flush-mb N] [--threads N] [--csv FILE]
+//                                     [--check]
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "cpu_pipeline.hpp"
+#include "cv_filters.hpp"
+#include "cv_geom.hpp"
+#include "filter_graph.hpp"
+#include "pixel_kernels.hpp"
+#include "thread_pool.hpp"
+#include "warp_engine.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+struct MicroConfig {
+    std::vector<std::pair<int, int>> sizes = { {320, 240}, {640, 480}, {1280, 720}, {1920, 1080}, {3840, 2160} };
+    std::vector<int> blocks = { 2, 8, 32 };
+    double minTimeSec = 0.2;            // per case and variant, at least kMinIters iterations
+    size_t flushBytes = 128u << 20;     // cold variant: bytes streamed before each iteration
+    std::string csv;
+};
+
+struct MicroResult {
+    std::string kernel, param, variant;
+    int w = 0, h = 0;
+    int iters = 0;
+    double nsPerPixel = 0.0, gbPerSec = 0.0, nsPerCall = 0.0;
+};
+
+static constexpr int kMinIters = 5;
+
+// Stream through a buffer larger than the last-level cache, evicting the frame
+static void flushCaches(std::vector<uchar>& buf) {
+    volatile uchar sink = 0;
+    for (size_t i = 0; i < buf.size(); i += 64) { buf[i] = (uchar)(buf[i] + 1); sink = sink + buf[i]; }
+    (void)sink;
+}
+
+static double medianNs(std::vector<double>& v) {
+    std::sort(v.begin(), v.end());
+    return v.empty() ? 0.0 : v[v.size() / 2];
+}
+
+// Time an in-place frame kernel. The frame is refilled from src before every iteration
+// (untimed), so every iteration sees the same input.
+static MicroResult runFrameCase(const std::string& kernel, const std::string& param, bool cold,
+    const cv::Mat& src, const std::function<void(cv::Mat&)>& fn,
+    const MicroConfig& cfg, std::vector<uchar>& flushBuf)
+{
+    cv::Mat work;
+    std::vector<double> ns;
+    const auto t0 = Clock::now();
+    src.copyTo(work);
+    fn(work);                            // first touch, lazily built tables, pool wake-up
+    while ((int)ns.size() < kMinIters
+        || std::chrono::duration<double>(Clock::now() - t0).count() < cfg.minTimeSec) {
+        src.copyTo(work);
+        if (cold) flushCaches(flushBuf);
+        const auto a = Clock::now();
+        fn(work);
+        ns.push_back((double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - a).count());
+    }
+
+    MicroResult r;
+    r.kernel = kernel; r.param = param; r.variant = cold ? "cold" : "warm";
+    r.w = src.cols; r.h = src.rows;
+    r.iters = (int)ns.size();
+    const double med = medianNs(ns);
+    const double px = (double)src.cols * src.rows;
+    r.nsPerCall = med;
+    r.nsPerPixel = med / px;
+    r.gbPerSec = med > 0.0 ? 2.0 * px * 3.0 / med : 0.0;     // bytes per ns == GB/s
+    return r;
+}
+
+static void printResult(const MicroResult& r) {
+    char line[256];
+    std::snprintf(line, sizeof(line), "%-16s %-21s %5dx%-5d %-4s %8.3f ns/px %8.2f GB/s  (n=%d)",
+        r.kernel.c_str(), r.param.c_str(), r.w, r.h, r.variant.c_str(), r.nsPerPixel, r.gbPerSec, r.iters);
+    std::cout << line << std::endl;
+}
+
+static void writeCsv(const std::vector<MicroResult>& rows, const std::string& path) {
+    std::ofstream f(path, std::ios::out);
+    f << "kernel,param,resolution,variant,iters,ns_per_call,ns_per_pixel,gb_per_s,threads,isa\n";
+    for (const auto& r : rows) {
+        const std::string res = r.w > 0 ? std::to_string(r.w) + "x" + std::to_string(r.h) : "-";
+        f << r.kernel << "," << r.param << "," << res << "," << r.variant << ","
+            << r.iters << "," << r.nsPerCall << "," << r.nsPerPixel << "," << r.gbPerSec << ","
+            << cpuThreadPool().threads() << "," << cpuIsaName(pixelKernels().isa) << "\n";
+    }
+}
+
+// affineMatrix is per frame, not per pixel: ns per call over varying parameters
+static MicroResult runAffineMatrixCase(double minTimeSec) {
+    AffineParams p;
+    float sink = 0.f;
+    long long calls = 0;
+    const auto t0 = Clock::now();
+    double sec = 0.0;
+    do {
+        for (int i = 0; i < 10000; ++i, ++calls) {
+            p.tx = (float)(i & 63); p.ty = (float)(i & 31);
+            p.thetaDeg = (float)(i % 360); p.scale = 1.f + (float)(i & 7) * 0.1f;
+            sink += affineMatrix(p, 1920, 1080)(0, 2);
+        }
+        sec = std::chrono::duration<double>(Clock::now() - t0).count();
+    } while (sec < minTimeSec);
+    volatile float keep = sink; (void)keep;
+
+    MicroResult r;
+    r.kernel = "affineMatrix"; r.param = "-"; r.variant = "warm";
+    r.iters = (int)std::min<long long>(calls, 0x7fffffff);
+    r.nsPerCall = sec * 1e9 / (double)calls;
+    return r;
+}
+
+static bool parseSizes(const std::string& s, std::vector<std::pair<int, int>>& out) {
+    out.clear();
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        int w = 0, h = 0;
+        if (std::sscanf(item.c_str(), "%dx%d", &w, &h) != 2 || w <= 0 || h <= 0) return false;
+        out.push_back({ w, h });
+    }
+    return !out.empty();
+}
+
+static bool parseInts(const std::string& s, std::vector<int>& out) {
+    out.clear();
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        const int v = std::atoi(item.c_str());
+        if (v <= 0) return false;
+        out.push_back(v);
+    }
+    return !out.empty();
+}
+
+// Per-pixel reference for warpAffineBGR: output pixel (x, y) samples the source at
+// M * (x + 0.5, y + 0.5) with double positions and weights, taps outside read as black
+static void warpReference(const cv::Mat& src, cv::Mat& dst, const cv::Matx33f& M) {
+    dst.create(src.size(), CV_8UC3);
+    for (int y = 0; y < dst.rows; ++y) {
+        uchar* d = dst.ptr<uchar>(y);
+        for (int x = 0; x < dst.cols; ++x, d += 3) {
+            const double u = M(0, 0) * (x + 0.5) + (double)M(0, 1) * (y + 0.5) + M(0, 2) - 0.5;
+            const double v = M(1, 0) * (x + 0.5) + (double)M(1, 1) * (y + 0.5) + M(1, 2) - 0.5;
+            const double fu = std::floor(u), fv = std::floor(v);
+            const int x0 = (int)std::max(-2.0, std::min(fu, (double)src.cols));
+            const int y0 = (int)std::max(-2.0, std::min(fv, (double)src.rows));
+            const double ax = u - fu, ay = v - fv;
+            const double w[4] = { (1 - ax) * (1 - ay), ax * (1 - ay), (1 - ax) * ay, ax * ay };
+            double acc[3] = { 0, 0, 0 };
+            for (int k = 0; k < 4; ++k) {
+                const int xx = x0 + (k & 1), yy = y0 + (k >> 1);
+                if (xx < 0 || yy < 0 || xx >= src.cols || yy >= src.rows) continue;
+                const uchar* s = src.ptr<uchar>(yy) + 3 * xx;
+                for (int c = 0; c < 3; ++c) acc[c] += w[k] * s[c];
+            }
+            for (int c = 0; c < 3; ++c) d[c] = (uchar)std::lround(acc[c]);
+        }
+    }
+}
+
+// warpAffineBGR against warpReference at odd sizes (rows wider than the 64-pixel re-anchoring
+// block, spans clipped on every side) for every plan kind. Returns the number of failed cases.
+static int runWarpCheck() {
+    struct WarpCase { const char* name; AffineParams p; };
+    std::vector<WarpCase> cases;
+    auto add = [&](const char* name, float theta, float scale, float tx, float ty) {
+        AffineParams p; p.thetaDeg = theta; p.scale = scale; p.tx = tx; p.ty = ty;
+        cases.push_back({ name, p });
+    };
+    add("identity", 0.f, 1.f, 0.f, 0.f);
+    add("translate", 0.f, 1.f, 17.f, -9.f);
+    add("subpixel", 0.f, 1.f, 3.25f, -0.75f);
+    add("rotate", 8.f, 1.15f, 60.f, 40.f);
+    add("rotate-steep", 137.f, 0.8f, -11.5f, 6.f);
+    add("scale-down", 0.f, 2.6f, 0.f, 0.f);
+    add("scale-down-rot", -23.f, 3.3f, 5.f, 2.f);
+    add("scale-up", 0.f, 0.37f, 0.f, 0.f);
+    add("quarter", 90.f, 1.f, 0.f, 0.f);
+    add("quarter-shift", 90.f, 1.f, 0.5f, 0.f);
+    add("three-quarter", 270.f, 1.f, 0.f, 0.f);
+    add("half", 180.f, 1.f, 2.f, 0.f);
+    add("near-quarter", 90.05f, 1.f, 0.f, 0.f);
+    add("offscreen", 31.f, 1.f, 5000.f, 0.f);
+
+    const std::pair<int, int> sizes[] = { {1, 1}, {3, 5}, {37, 23}, {129, 67}, {333, 199}, {641, 479} };
+    int failed = 0;
+    for (auto sz : sizes) {
+        cv::Mat src(sz.second, sz.first, CV_8UC3), got, ref;
+        cv::randu(src, cv::Scalar::all(0), cv::Scalar::all(255));
+        for (const WarpCase& c : cases) {
+            const cv::Matx33f M = affineMatrix(c.p, src.cols, src.rows);
+            warpAffineBGR(src, got, M);
+            warpReference(src, ref, M);
+            const double maxDiff = cv::norm(got, ref, cv::NORM_INF);
+            const bool ok = maxDiff <= 1.0;
+            failed += ok ? 0 : 1;
+            char line[160];
+            std::snprintf(line, sizeof(line), "warp %-15s %4dx%-4d %-8s max diff %3d  %s", c.name,
+                src.cols, src.rows, warpKindName(AffineWarp(M, src.cols, src.rows).kind()), (int)maxDiff,
+                ok ? "ok" : "FAIL");
+            std::cout << line << std::endl;
+        }
+    }
+    std::cout << "[Check] " << failed << " failed" << std::endl;
+    return failed;
+}
+
+static int runMicrobench(const MicroConfig& cfg) {
+    std::vector<uchar> flushBuf(cfg.flushBytes, 1);
+    std::vector<MicroResult> rows;
+    auto add = [&](const MicroResult& r) { printResult(r); rows.push_back(r); };
+
+    FilterParams fp; fp.keepBGR = { 20, 20, 200 }; fp.thresh = 60;
+    AffineParams rotate; rotate.tx = 60.f; rotate.ty = 40.f; rotate.scale = 1.15f; rotate.thetaDeg = 8.f;
+    AffineParams shift; shift.tx = 17.f; shift.ty = -9.f;
+    AffineParams quarter; quarter.thetaDeg = 90.f;
+
+    // The graphs the application's CPU mode processes, next to the literal kernels above them:
+    // each goes through planFilterGraph and the cell / fused pass kernels
+    const FilterStage warpStage = FilterStage::warp(rotate), pixStage = FilterStage::pixelate(8),
+        sinStage = FilterStage::sinCity(fp.keepBGR, fp.thresh);
+    std::vector<FilterGraph> graphs(4);
+    graphs[0].then(warpStage);
+    graphs[1].then(pixStage);
+    graphs[2].then(sinStage);
+    graphs[3].then(warpStage).then(sinStage).then(pixStage);
+
+    for (auto sz : cfg.sizes) {
+        cv::Mat src(sz.second, sz.first, CV_8UC3);
+        cv::randu(src, cv::Scalar::all(0), cv::Scalar::all(255));
+
+        for (bool cold : { false, true }) {
+            for (int b : cfg.blocks) {
+                FilterParams p = fp; p.pixelBlock = b;
+                add(runFrameCase("Pixelate", "block=" + std::to_string(b), cold, src,
+                    [&](cv::Mat& m) { applyCpuFilter(m, FilterType::Pixelate, p); }, cfg, flushBuf));
+            }
+            add(runFrameCase("SinCity", "thresh=60", cold, src,
+                [&](cv::Mat& m) { applyCpuFilter(m, FilterType::SinCity, fp); }, cfg, flushBuf));
+            add(runFrameCase("warpCpuAffine", "rotate", cold, src,
+                [&](cv::Mat& m) { warpCpuAffine(m, rotate); }, cfg, flushBuf));
+            add(runFrameCase("warpCpuAffine", "translate", cold, src,
+                [&](cv::Mat& m) { warpCpuAffine(m, shift); }, cfg, flushBuf));
+            add(runFrameCase("warpCpuAffine", "quarter", cold, src,
+                [&](cv::Mat& m) { warpCpuAffine(m, quarter); }, cfg, flushBuf));
+            cv::Mat out;
+            for (const FilterGraph& g : graphs)
+                add(runFrameCase("processCpuFrame", g.name(), cold, src,
+                    [&](cv::Mat& m) { processCpuFrame(m, out, g); }, cfg, flushBuf));
+
+            // CPU side of a frame upload: the BGR->RGB swizzle the GL_RGB path needed, and the
+            // copy into a staging slot that the GL_BGR PBO path does instead
+            cv::Mat rgb, staging;
+            add(runFrameCase("upload", "bgr2rgb", cold, src,
+                [&](cv::Mat& m) { cv::cvtColor(m, rgb, cv::COLOR_BGR2RGB); }, cfg, flushBuf));
+            add(runFrameCase("upload", "stage-copy", cold, src,
+                [&](cv::Mat& m) { m.copyTo(staging); }, cfg, flushBuf));
+        }
+    }
+
+    MicroResult am = runAffineMatrixCase(cfg.minTimeSec);
+    std::cout << "affineMatrix     " << am.nsPerCall << " ns/call (n=" << am.iters << ")" << std::endl;
+    rows.push_back(am);
+
+    if (!cfg.csv.empty()) {
+        writeCsv(rows, cfg.csv);
+        std::cout << "[Results] " << cfg.csv << std::endl;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    MicroConfig cfg;
+    ThreadPoolConfig poolCfg;
+    bool check = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (a == "--sizes" && hasValue) {
+            if (!parseSizes(argv[++i], cfg.sizes)) { std::cerr << "--sizes takes WxH[,WxH...]\n"; return -1; }
+        }
+        else if (a == "--blocks" && hasValue) {
+            if (!parseInts(argv[++i], cfg.blocks)) { std::cerr << "--blocks takes N[,N...]\n"; return -1; }
+        }
+        else if (a == "--min-time" && hasValue) cfg.minTimeSec = std::atof(argv[++i]);
+        else if (a == "--flush-mb" && hasValue)  cfg.flushBytes = (size_t)std::max(1, std::atoi(argv[++i])) << 20;
+        else if (a == "--threads" && hasValue)   poolCfg.threads = std::atoi(argv[++i]);
+        else if (a == "--csv" && hasValue)       cfg.csv = argv[++i];
+        else if (a == "--check")                 check = true;
+        else { std::cerr << "Unknown option " << a << "\n"; return -1; }
+    }
+    configureCpuThreadPool(poolCfg);
+    std::cout << "[CPU] " << cpuThreadPool().threads() << " thread(s) | kernels "
+        << cpuIsaName(pixelKernels().isa) << " | cold flush " << (cfg.flushBytes >> 20) << " MiB" << std::endl;
+
+    try {
+        if (check) return runWarpCheck() == 0 ? 0 : 1;
+        return runMicrobench(cfg);
+    }
+    catch (const cv::Exception& e) {
+        std::cerr << "[OpenCV EXCEPTION] " << e.what() << std::endl;
+        return -1;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "[STD EXCEPTION] " << e.what() << std::endl;
+        return -1;
+    }
+}
@@ -0,0 +1,338 @@
+#include "bench_matrix.hpp"
+#include "cv_filters.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+static std::string trim(const std::string& s) {
+    size_t b = 0, e = s.size();
+    while (b < e && std::isspace((unsigned char)s[b])) ++b;
+    while (e > b && std::isspace((unsigned char)s[e - 1])) --e;
+    return s.substr(b, e - b);
+}
+
+static std::string lower(std::string s) {
+    for (char& c : s) c = (char)std::tolower((unsigned char)c);
+    return s;
+}
+
+static std::vector<std::string> split(const std::string& s, char sep) {
+    std::vector<std::string> out;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, sep)) {
+        item = trim(item);
+        if (!item.empty()) out.push_back(item);
+    }
+    return out;
+}
+
+static bool parseInt(const std::string& s, int& out) {
+    char* end = nullptr;
+    long v = std::strtol(s.c_str(), &end, 10);
+    if (s.empty() || *end) return false;
+    out = (int)v;
+    return true;
+}
+
+static bool parseDouble(const std::string& s, double& out) {
+    char* end = nullptr;
+    double v = std::strtod(s.c_str(), &end);
+    if (s.empty() || *end) return false;
+    out = v;
+    return true;
+}
+
+static bool parseResolution(const std::string& s, std::pair<int, int>& out) {
+    static const std::map<std::string, std::pair<int, int>> named = {
+        { "480p", { 640, 480 } }, { "720p", { 1280, 720 } }, { "1080p", { 1920, 1080 } },
+        { "1440p", { 2560, 1440 } }, { "4k", { 3840, 2160 } }, { "2160p", { 3840, 2160 } },
+        { "8k", { 7680, 4320 } }, { "4320p", { 7680, 4320 } }
+    };
+    const std::string l = lower(s);
+    auto it = named.find(l);
+    if (it != named.end()) { out = it->second; return true; }
+    const size_t x = l.find('x');
+    int w = 0, h = 0;
+    if (x == std::string::npos || !parseInt(l.substr(0, x), w) || !parseInt(l.substr(x + 1), h)) return false;
+    if (w <= 0 || h <= 0) return false;
+    out = { w, h };
+    return true;
+}
+
+static bool parseChain(const std::string& s, FilterChain& out) {
+    out.clear();
+    for (const std::string& name : split(s, '>')) {
+        bool found = false;
+        for (FilterType t : { FilterType::None, FilterType::Pixelate, FilterType::SinCity })
+            if (lower(filterName(t)) == lower(name)) { out.push_back(t); found = true; break; }
+        if (!found) return false;
+    }
+    return !out.empty();
+}
+
+static bool parseSwitch(const std::string& s, bool& out) {
+    const std::string l = lower(s);
+    if (l == "on" || l == "true" || l == "1")  { out = true; return true; }
+    if (l == "off" || l == "false" || l == "0") { out = false; return true; }
+    return false;
+}
+
+bool setBenchOption(BenchMatrix& m, const std::string& rawKey, const std::string& value, std::string& err) {
+    const std::string key = lower(trim(rawKey));
+    const std::vector<std::string> items = split(value, ',');
+    auto bad = [&](const std::string& item) {
+        err = "bad value '" + item + "' for " + key;
+        return false;
+    };
+    auto single = [&](auto parse, auto& out) {
+        if (items.size() != 1) return bad(value);
+        return parse(items[0], out) ? true : bad(items[0]);
+    };
+    if (items.empty() && key != "baseline") { err = "no value for " + key; return false; }
+
+    if (key == "resolutions") {
+        std::vector<std::pair<int, int>> v(items.size());
+        for (size_t i = 0; i < items.size(); ++i) if (!parseResolution(items[i], v[i])) return bad(items[i]);
+        m.resolutions = v;
+    }
+    else if (key == "filters") {
+        std::vector<FilterChain> v(items.size());
+        for (size_t i = 0; i < items.size(); ++i) if (!parseChain(items[i], v[i])) return bad(items[i]);
+        m.filters = v;
+    }
+    else if (key == "transforms") {
+        std::vector<bool> v;
+        for (const std::string& it : items) { bool b; if (!parseSwitch(it, b)) return bad(it); v.push_back(b); }
+        m.transforms = v;
+    }
+    else if (key == "modes") {
+        std::vector<bool> v;
+        for (const std::string& it : items) {
+            const std::string l = lower(it);
+            if (l != "cpu" && l != "gpu") return bad(it);
+            v.push_back(l == "gpu");
+        }
+        m.gpuModes = v;
+    }
+    else if (key == "threads") {
+        std::vector<int> v(items.size());
+        for (size_t i = 0; i < items.size(); ++i) if (!parseInt(items[i], v[i]) || v[i] < 0) return bad(items[i]);
+        m.threads = v;
+    }
+    else if (key == "repetitions") {
+        if (!single(parseInt, m.repetitions)) return false;
+        if (m.repetitions < 1) return bad(value);
+    }
+    else if (key == "warmup") {
+        if (!single(parseDouble, m.warmupSec)) return false;
+        if (m.warmupSec < 0.0) return bad(value);
+    }
+    else if (key == "duration") {
+        if (!single(parseDouble, m.sampleSec)) return false;
+        if (m.sampleSec <= 0.0) return bad(value);
+    }
+    else if (key == "baseline") {
+        m.baseline = trim(value);
+    }
+    else if (key == "tolerance") {
+        if (!single(parseDouble, m.tolerance)) return false;
+        if (m.tolerance < 0.0) return bad(value);
+    }
+    else if (key == "confidence") {
+        if (!single(parseDouble, m.confidence)) return false;
+        if (m.confidence <= 0.0 || m.confidence >= 1.0) return bad(value);
+    }
+    else if (key == "source") {
+        const std::string spec = trim(value);
+        const std::string l = lower(spec);
+        if (l == "corpus" || l == "live") {
+            m.source.kind = SourceKind::Synthetic;
+            m.source.live = l == "live";
+        }
+        else {
+            std::string perr;
+            if (!parseFrameSource(spec, m.source, perr)) { err = perr; return false; }
+            if (m.source.kind == SourceKind::Camera) return bad(spec);
+        }
+    }
+    else if (key == "content") {
+        if (items.size() != 1) return bad(value);
+        const std::string l = lower(items[0]);
+        if (l != "noise" && l != "scene") return bad(items[0]);
+        m.source.corpus.content = l == "scene" ? CorpusContent::Scene : CorpusContent::Noise;
+    }
+    else if (key == "corpus_frames") {
+        if (!single(parseInt, m.source.corpus.frames)) return false;
+        if (m.source.corpus.frames < 1) return bad(value);
+    }
+    else if (key == "seed") {
+        int seed = 0;
+        if (!single(parseInt, seed)) return false;
+        if (seed < 0) return bad(value);
+        m.source.corpus.seed = (unsigned)seed;
+    }
+    else if (key == "yuv") {
+        if (!single(parseSwitch, m.yuv)) return false;
+    }
+    else {
+        err = "unknown matrix key '" + key + "'";
+        return false;
+    }
+    return true;
+}
+
+bool setBenchOption(BenchMatrix& m, const std::string& assignment, std::string& err) {
+    const size_t eq = assignment.find('=');
+    if (eq == std::string::npos) { err = "expected key=value, got '" + assignment + "'"; return false; }
+    return setBenchOption(m, assignment.substr(0, eq), assignment.substr(eq + 1), err);
+}
+
+bool loadBenchMatrix(const std::string& path, BenchMatrix& m, std::string& err) {
+    std::ifstream f(path);
+    if (!f.is_open()) { err = "cannot open " + path; return false; }
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(f, line)) {
+        ++lineNo;
+        const size_t hash = line.find('#');
+        if (hash != std::string::npos) line.resize(hash);
+        if (trim(line).empty()) continue;
+        if (!setBenchOption(m, line, err)) {
+            err = path + ":" + std::to_string(lineNo) + ": " + err;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool validateBenchMatrix(const BenchMatrix& m, std::string& err) {
+    if (!m.baseline.empty() && m.repetitions < 2) {
+        err = "baseline needs repetitions >= 2 (the comparison is over run means), got " + std::to_string(m.repetitions);
+        return false;
+    }
+    return true;
+}
+
+// -------------------- Baseline comparison --------------------
+
+FpsSample cellFps(const std::vector<FpsSample>& runs) {
+    std::vector<double> means;
+    for (const FpsSample& r : runs) if (r.n > 0) means.push_back(r.mean);
+    FpsSample c;
+    if (means.empty()) return c;
+    c.n = (long long)means.size();
+    for (double m : means) c.mean += m;
+    c.mean /= (double)c.n;
+    if (c.n < 2) return c;
+    double ss = 0.0;
+    for (double m : means) ss += (m - c.mean) * (m - c.mean);
+    c.stddev = std::sqrt(ss / (double)(c.n - 1));
+    return c;
+}
+
+std::string benchKey(const std::string& mode, const std::string& filter,
+    const std::string& transform, const std::string& resolution) {
+    return mode + "|" + filter + "|" + transform + "|" + resolution;
+}
+
+bool loadBaselineCsv(const std::string& path, std::vector<BaselineRow>& rows, std::string& err) {
+    std::ifstream f(path);
+    if (!f.is_open()) { err = "cannot open " + path; return false; }
+    std::string line;
+    if (!std::getline(f, line)) { err = path + " is empty"; return false; }
+    if (line.size() >= 3 && (unsigned char)line[0] == 0xEF) line = line.substr(3);    // UTF-8 BOM
+
+    std::map<std::string, size_t> col;
+    std::vector<std::string> header = split(line, ',');
+    for (size_t i = 0; i < header.size(); ++i) col[header[i]] = i;
+    for (const char* need : { "mode", "filter", "transform", "resolution", "avg_fps", "std_fps", "samples" })
+        if (!col.count(need)) { err = path + ": no '" + need + "' column"; return false; }
+    const bool hasThreads = col.count("threads") != 0;
+
+    // Pool repeated rows of one cell
+    std::map<std::pair<std::string, int>, std::vector<FpsSample>> cells;
+    std::vector<std::pair<std::string, int>> order;
+    while (std::getline(f, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (trim(line).empty()) continue;
+        std::vector<std::string> v;
+        std::stringstream ss(line);
+        std::string item;
+        while (std::getline(ss, item, ',')) v.push_back(trim(item));
+        if (v.size() < header.size()) continue;
+
+        FpsSample s;
+        int threads = -1;
+        int n = 0;
+        if (!parseDouble(v[col["avg_fps"]], s.mean) || !parseDouble(v[col["std_fps"]], s.stddev)
+            || !parseInt(v[col["samples"]], n)) continue;
+        s.n = n;
+        if (hasThreads && !parseInt(v[col["threads"]], threads)) threads = -1;
+
+        auto id = std::make_pair(benchKey(v[col["mode"]], v[col["filter"]], v[col["transform"]], v[col["resolution"]]), threads);
+        if (!cells.count(id)) order.push_back(id);
+        cells[id].push_back(s);
+    }
+
+    rows.clear();
+    for (const auto& id : order) {
+        BaselineRow r;
+        r.key = id.first;
+        r.threads = id.second;
+        r.fps = cellFps(cells[id]);
+        rows.push_back(r);
+    }
+    return true;
+}
+
+// P(|T| < x) for Student's t with dof degrees of freedom (Simpson's rule on the density);
+// the normal distribution for large dof
+static double centralMass(double x, double dof) {
+    if (dof > 1000.0) return std::erf(x / std::sqrt(2.0));
+    const double c = std::exp(std::lgamma(0.5 * (dof + 1.0)) - std::lgamma(0.5 * dof)) / std::sqrt(dof * std::acos(-1.0));
+    auto pdf = [&](double t) { return c * std::pow(1.0 + t * t / dof, -0.5 * (dof + 1.0)); };
+    const int n = 2000;
+    const double h = x / n;
+    double sum = pdf(0.0) + pdf(x);
+    for (int i = 1; i < n; ++i) sum += (i & 1 ? 4.0 : 2.0) * pdf(i * h);
+    return 2.0 * sum * h / 3.0;
+}
+
+// Two-sided critical value for the confidence level, by bisection
+static double criticalValue(double confidence, double dof) {
+    double lo = 0.0, hi = 1000.0;
+    for (int i = 0; i < 60; ++i) {
+        const double mid = 0.5 * (lo + hi);
+        if (centralMass(mid, dof) < confidence) lo = mid; else hi = mid;
+    }
+    return 0.5 * (lo + hi);
+}
+
+FpsComparison compareFps(const FpsSample& baseline, const FpsSample& current,
+    double confidence, double tolerance) {
+    FpsComparison c;
+    if (baseline.mean <= 0.0 || baseline.n == 0 || current.n == 0) return c;
+    c.change = current.mean / baseline.mean - 1.0;
+    c.lo = c.hi = c.change;
+    if (baseline.n < 2 || current.n < 2) return c;
+
+    // Standard error of the difference of the two means and its Welch-Satterthwaite degrees
+    // of freedom
+    const double vb = baseline.stddev * baseline.stddev / (double)baseline.n;
+    const double vc = current.stddev * current.stddev / (double)current.n;
+    const double se = std::sqrt(vb + vc) / baseline.mean;
+    double dof = 1e9;
+    const double den = vb * vb / (double)(baseline.n - 1) + vc * vc / (double)(current.n - 1);
+    if (den > 0.0) dof = std::max(1.0, (vb + vc) * (vb + vc) / den);
+    const double z = criticalValue(confidence, dof);
+    c.interval = true;
+    c.lo = c.change - z * se;
+    c.hi = c.change + z * se;
+    c.regression = c.hi < -tolerance;
+    c.improvement = c.lo > tolerance;
+    return c;
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <string>
+#include <utility>
+#include <vector>
+#include "filter_graph.hpp"
+#include "frame_source.hpp"
+
+// Test matrix of the benchmarks (--bench, --bench-headless). Read from a config file of
+// "key = value" lines and/or --matrix key=value options; list values are comma separated:
+//
+//   resolutions = 640x480, 1080p, 4K, 8K     # WxH or 720p / 1080p / 1440p / 4K / 8K
+//   filters     = None, Pixelate, SinCity>Pixelate
+//   transforms  = off, on
+//   modes       = cpu, gpu                   # GL benchmark only
+//   threads     = 1, 4, 0                    # CPU pool sizes to sweep, 0 = all cores
+//   repetitions = 3                          # at least 2 with a baseline
+//   warmup      = 1                          # seconds per run
+//   duration    = 5
+//   baseline    = src/perf_summary_Release.csv
+//   tolerance   = 0.05                       # slowdown that counts as a regression
+//   confidence  = 0.95
+//   source      = corpus                     # corpus: frames generated before timing; live: in the loop;
+//                                            # or a file (clip.y4m, clip.bgr:WxH, clip.mp4) at its own size
+//   content     = noise                      # corpus frames: noise or scene
+//   corpus_frames = 8
+//   seed        = 1
+//   yuv         = off                        # on: I420 files (y4m) stay I420 instead of being converted
+//                                            # to BGR when read (GPU: plane upload, CPU: processCpuFrameI420)
+struct BenchMatrix {
+    std::vector<std::pair<int, int>> resolutions = { {640, 480}, {1280, 720}, {1920, 1080} };
+    std::vector<FilterChain> filters = {
+        { FilterType::None }, { FilterType::Pixelate }, { FilterType::SinCity },
+        { FilterType::SinCity, FilterType::Pixelate }
+    };
+    std::vector<bool> transforms = { false, true };
+    std::vector<bool> gpuModes = { false, true };
+    std::vector<int> threads;           // empty = keep the pool configured by --threads
+    int repetitions = 1;
+    double warmupSec = 1.0, sampleSec = 5.0;
+    std::string baseline;               // CSV of an earlier run to compare against, "" = none
+    double tolerance = 0.05;
+    double confidence = 0.95;
+    // Synthetic (corpus, or live: generated inside the timed loop, the old behavior) at each
+    // resolution, or a file replayed at its own size instead of the resolutions list
+    SourceConfig source{ SourceKind::Synthetic };
+    bool yuv = false;
+};
+
+// Set one key; false (and err) on an unknown key or a malformed value
+bool setBenchOption(BenchMatrix& m, const std::string& key, const std::string& value, std::string& err);
+// "key=value" as given to --matrix
+bool setBenchOption(BenchMatrix& m, const std::string& assignment, std::string& err);
+// Apply every line of a config file ('#' starts a comment)
+bool loadBenchMatrix(const std::string& path, BenchMatrix& m, std::string& err);
+// Checks across keys, once every option is applied: a baseline needs repetitions >= 2
+bool validateBenchMatrix(const BenchMatrix& m, std::string& err);
+
+// -------------------- Baseline comparison --------------------
+
+// FPS samples of one matrix cell: mean, standard deviation and count
+struct FpsSample {
+    double mean = 0.0, stddev = 0.0;
+    long long n = 0;
+};
+
+// FPS of a cell from its repetitions: the run means are the samples. Frames of one run are
+// correlated, so their spread understates run-to-run noise; a single run gives n = 1 and no
+// spread at all.
+FpsSample cellFps(const std::vector<FpsSample>& runs);
+
+struct BaselineRow {
+    std::string key;                    // benchKey()
+    int threads = -1;                   // -1: not recorded (older CSVs)
+    FpsSample fps;
+};
+
+// "GPU|SinCity>Pixelate|On|1920x1080"
+std::string benchKey(const std::string& mode, const std::string& filter,
+    const std::string& transform, const std::string& resolution);
+
+// Rows of a perf_summary CSV (columns looked up by header name; rows of the same cell and
+// thread count, i.e. repetitions, are combined with cellFps)
+bool loadBaselineCsv(const std::string& path, std::vector<BaselineRow>& rows, std::string& err);
+
+// Relative FPS change (current / baseline - 1) with its confidence interval [lo, hi] (Welch,
+// Student t critical value, so few repetitions give a wide interval). The cell regressed if
+// even the optimistic end of the interval is a slowdown beyond tolerance, improved if the
+// pessimistic end is a speedup beyond it. A side with fewer than two runs has no interval:
+// only the change is reported (lo == hi == change) and the cell is neither.
+struct FpsComparison {
+    double change = 0.0, lo = 0.0, hi = 0.0;
+    bool interval = false;
+    bool regression = false, improvement = false;
+};
+FpsComparison compareFps(const FpsSample& baseline, const FpsSample& current,
+    double confidence, double tolerance);
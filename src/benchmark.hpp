@@ -0,0 +1,13 @@
+#pragma once
+#include "gl_context.hpp"
+#include "bench_matrix.hpp"
+
+// GL benchmark: runs the CPU/GPU test matrix and writes perf_summary_<build>.csv / .json.
+// With an offscreen backend (egl / osmesa) it renders into an FBO instead of a window
+// and writes perf_summary_<build>_<backend>.csv / .json with the same columns.
+// Returns 1 if the matrix has a baseline and a cell regressed against it.
+int run_benchmark_mode(GlBackend backend = GlBackend::Window, const BenchMatrix& matrix = {});
+
+// Headless benchmark: CPU path only, no GLFW window or GL context; adds per-stage
+// latency columns and writes perf_summary_<build>_headless.csv / .json
+int run_headless_benchmark_mode(const BenchMatrix& matrix = {});
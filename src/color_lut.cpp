@@ -0,0 +1,135 @@
+#include "color_lut.hpp"
+#include <algorithm>
+#include <cmath>
+
+// Lattice entries are value * 257 (0..65535); tetrahedral weights are Q8 and sum to 256
+static constexpr int kEntryScale = 257;
+static constexpr int kFracOne = 256;
+static constexpr int kOutDiv = kEntryScale * kFracOne;
+
+enum : uint8_t { kCellGrade = 0, kCellKeep = 1, kCellExact = 2 };
+
+// Lattice position of point i: integer, so transforms that are linear in the color (identity,
+// luma, channel mixing) come out of the interpolation exact up to rounding
+static int latticePos(int i, int n) { return (255 * i + (n - 1) / 2) / (n - 1); }
+
+ColorLut3D::ColorLut3D(std::shared_ptr<const ColorTransform> f, int size)
+    : n_(size), f_(std::move(f))
+{
+    CV_Assert(f_ && n_ >= 2 && n_ <= 256);
+    const int n = n_, c = n - 1;
+
+    std::vector<int> pos(n);
+    for (int i = 0; i < n; ++i) pos[i] = latticePos(i, n);
+
+    lattice_.resize((size_t)n * n * n * 4);
+    uint16_t* e = lattice_.data();
+    for (int b = 0; b < n; ++b)
+        for (int g = 0; g < n; ++g)
+            for (int r = 0; r < n; ++r, e += 4) {
+                const cv::Vec3b o = f_->grade(pos[b], pos[g], pos[r]);
+                const float k = f_->keep(pos[b], pos[g], pos[r]);
+                e[0] = (uint16_t)(o[0] * kEntryScale);
+                e[1] = (uint16_t)(o[1] * kEntryScale);
+                e[2] = (uint16_t)(o[2] * kEntryScale);
+                e[3] = (uint16_t)std::min(65535.f, std::max(0.f, std::round(kKeepZero + k * kKeepScale)));
+            }
+
+    cells_.resize((size_t)c * c * c);
+    uint8_t* x = cells_.data();
+    for (int b = 0; b < c; ++b)
+        for (int g = 0; g < c; ++g)
+            for (int r = 0; r < c; ++r, ++x) {
+                const int sign = f_->keepSign({ pos[b], pos[g], pos[r] }, { pos[b + 1], pos[g + 1], pos[r + 1] });
+                *x = sign > 0 ? kCellKeep : sign < 0 ? kCellGrade : kCellExact;
+            }
+
+    for (int v = 0, i = 0; v < 256; ++v) {
+        while (i < c - 1 && pos[i + 1] <= v) ++i;
+        const int w = pos[i + 1] - pos[i];
+        cell_[v] = (uint16_t)i;
+        frac_[v] = (uint16_t)(((v - pos[i]) * kFracOne + w / 2) / w);
+    }
+}
+
+void ColorLut3D::apply(uchar* p, int count) const {
+    const int n = n_, c = n - 1;
+    const uint16_t* L = lattice_.data();
+    const uint8_t* X = cells_.data();
+    const int sR = 4, sG = 4 * n, sB = 4 * n * n;
+
+    for (int k = 0; k < count; ++k, p += 3) {
+        const int b = p[0], g = p[1], r = p[2];
+        const int cb = cell_[b], cg = cell_[g], cr = cell_[r];
+        const uint8_t cell = X[((size_t)cb * c + cg) * c + cr];
+        if (cell == kCellKeep) continue;
+        if (cell == kCellExact) {
+            const cv::Vec3b o = f_->eval(b, g, r);
+            p[0] = o[0]; p[1] = o[1]; p[2] = o[2];
+            continue;
+        }
+        const int fb = frac_[b], fg = frac_[g], fr = frac_[r];
+
+        // Tetrahedral interpolation: walk from the base corner to the far corner along the
+        // axes in order of decreasing fraction; 4 corners instead of trilinear's 8
+        int s1, s2, w0, w1, w2, w3;
+        if (fr >= fg) {
+            if (fg >= fb)      { s1 = sR; s2 = sR + sG; w0 = kFracOne - fr; w1 = fr - fg; w2 = fg - fb; w3 = fb; }
+            else if (fr >= fb) { s1 = sR; s2 = sR + sB; w0 = kFracOne - fr; w1 = fr - fb; w2 = fb - fg; w3 = fg; }
+            else               { s1 = sB; s2 = sB + sR; w0 = kFracOne - fb; w1 = fb - fr; w2 = fr - fg; w3 = fg; }
+        }
+        else {
+            if (fr >= fb)      { s1 = sG; s2 = sG + sR; w0 = kFracOne - fg; w1 = fg - fr; w2 = fr - fb; w3 = fb; }
+            else if (fg >= fb) { s1 = sG; s2 = sG + sB; w0 = kFracOne - fg; w1 = fg - fb; w2 = fb - fr; w3 = fr; }
+            else               { s1 = sB; s2 = sB + sG; w0 = kFracOne - fb; w1 = fb - fg; w2 = fg - fr; w3 = fr; }
+        }
+        const uint16_t* e0 = L + ((size_t)cb * n + cg) * sG + (size_t)cr * sR;
+        const uint16_t* e1 = e0 + s1;
+        const uint16_t* e2 = e0 + s2;
+        const uint16_t* e3 = e0 + sR + sG + sB;
+        for (int ch = 0; ch < 3; ++ch) {
+            const int acc = w0 * e0[ch] + w1 * e1[ch] + w2 * e2[ch] + w3 * e3[ch];
+            p[ch] = (uchar)((acc + kOutDiv / 2) / kOutDiv);
+        }
+    }
+}
+
+// -------------------- Cache --------------------
+
+std::shared_ptr<const ColorLut3D> ColorLutCache::get(const ColorLutKey& key,
+    const std::function<std::shared_ptr<const ColorTransform>()>& make)
+{
+    auto find = [&]() -> std::shared_ptr<const ColorLut3D> {
+        for (size_t i = 0; i < entries_.size(); ++i) {
+            if (!(entries_[i].key == key)) continue;
+            Entry hit = entries_[i];
+            entries_.erase(entries_.begin() + (ptrdiff_t)i);
+            entries_.insert(entries_.begin(), hit);
+            return hit.lut;
+        }
+        return nullptr;
+    };
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        if (auto lut = find()) return lut;
+    }
+
+    auto built = std::make_shared<const ColorLut3D>(make(), key.size);
+
+    std::lock_guard<std::mutex> lk(m_);
+    if (auto lut = find()) return lut;              // another thread built it meanwhile
+    entries_.insert(entries_.begin(), Entry{ key, built });
+    if (entries_.size() > capacity_) entries_.resize(capacity_);
+    ++builds_;
+    return built;
+}
+
+uint64_t ColorLutCache::builds() const {
+    std::lock_guard<std::mutex> lk(m_);
+    return builds_;
+}
+
+ColorLutCache& colorLutCache() {
+    static ColorLutCache cache;
+    return cache;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Pointwise BGR8 -> BGR8 color transform, the input of ColorLut3D. Split like a secondary
+// color correction: a qualifier picks the colors that pass through unchanged, everything else
+// gets the graded color. Both parts are smooth, so they survive interpolation; the hard
+// keep / grade edge is only taken when the interpolated qualifier is thresholded.
+struct ColorTransform {
+    virtual ~ColorTransform() = default;
+
+    // Graded color. Must be smooth (no thresholds) over the whole cube: it is interpolated.
+    virtual cv::Vec3b grade(int b, int g, int r) const = 0;
+
+    // Qualifier as a signed distance in color levels: > 0 passes the input through, <= 0 grades
+    virtual float keep(int b, int g, int r) const { (void)b; (void)g; (void)r; return -1.f; }
+
+    // Sign of keep() over the BGR box [lo, hi]: +1 all kept, -1 all graded, 0 mixed
+    virtual int keepSign(const cv::Vec3i& lo, const cv::Vec3i& hi) const { (void)lo; (void)hi; return -1; }
+
+    // Exact output for one color
+    cv::Vec3b eval(int b, int g, int r) const {
+        return keep(b, g, r) > 0.f ? cv::Vec3b((uchar)b, (uchar)g, (uchar)r) : grade(b, g, r);
+    }
+};
+
+// size^3 lattice over the BGR cube (lattice point i sits at 255 * i / (size - 1) on each axis),
+// looked up with tetrahedral interpolation on the CPU and trilinear filtering as a 3D texture
+// on the GPU. Entries are 16-bit BGRA: the graded color (255 -> 65535) and the qualifier
+// (kKeepZero + keep() * kKeepScale), so they upload as GL_RGBA16 unchanged.
+class ColorLut3D {
+public:
+    static constexpr int kDefaultSize = 33;
+    static constexpr int kKeepZero = 32768;         // alpha of keep() == 0; kept iff alpha > kKeepZero
+    static constexpr int kKeepScale = 64;           // alpha units per color level
+
+    explicit ColorLut3D(std::shared_ptr<const ColorTransform> f, int size = kDefaultSize);
+
+    int size() const { return n_; }
+
+    // Lattice as size^3 BGRA16 entries, r fastest then g then b (GL_TEXTURE_3D s/t/p = R/G/B)
+    const uint16_t* data() const { return lattice_.data(); }
+
+    // In place on n interleaved BGR pixels. Cells entirely kept are skipped, cells the qualifier
+    // edge passes through are evaluated exactly, the rest is interpolated.
+    void apply(uchar* bgr, int n) const;
+
+private:
+    int n_;
+    std::vector<uint16_t> lattice_;                 // 4 x uint16 per lattice point
+    std::vector<uint8_t> cells_;                    // per cell: kCellGrade / kCellKeep / kCellExact
+    std::array<uint16_t, 256> cell_{}, frac_{};     // per-axis lattice cell and Q8 position in it
+    std::shared_ptr<const ColorTransform> f_;       // evaluated directly in mixed cells
+};
+
+// Identifies one LUT: which transform (kind) with which parameters at which lattice size
+struct ColorLutKey {
+    int kind = 0;
+    int size = ColorLut3D::kDefaultSize;
+    std::array<int, 4> params{};
+    bool operator==(const ColorLutKey& o) const { return kind == o.kind && size == o.size && params == o.params; }
+};
+
+// Built LUTs by key, so a table is built once per parameter set and reused every frame
+// (by the CPU kernels and the GPU upload alike) until the parameters change. Keeps the few
+// most recently used tables; thread-safe.
+class ColorLutCache {
+public:
+    explicit ColorLutCache(size_t capacity = 8) : capacity_(capacity) {}
+
+    // Cached LUT for key, or one built from make() (called without the lock held)
+    std::shared_ptr<const ColorLut3D> get(const ColorLutKey& key,
+        const std::function<std::shared_ptr<const ColorTransform>()>& make);
+
+    uint64_t builds() const;
+
+private:
+    struct Entry { ColorLutKey key; std::shared_ptr<const ColorLut3D> lut; };
+    mutable std::mutex m_;
+    std::vector<Entry> entries_;                    // most recently used first
+    size_t capacity_;
+    uint64_t builds_ = 0;
+};
+
+ColorLutCache& colorLutCache();
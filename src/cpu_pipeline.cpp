@@ -0,0 +1,454 @@
+#include "cpu_pipeline.hpp"
+#include "thread_pool.hpp"
+#include "pixel_kernels.hpp"
+#include "warp_engine.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// One step of a pass's output -> input mapping, in pixel-center coordinates
+// (pixel (i, j) spans [i, i + 1) x [j, j + 1), its center is (i + 0.5, j + 0.5))
+struct CoordOp {
+    bool snap = false;
+    cv::Matx33f M;                  // affine step (affineMatrix convention)
+    float sx = 1.f, sy = 1.f;       // snap: pixelate grid, cells per row / column
+    float w = 1.f, h = 1.f;         // snap: frame size the grid divides
+};
+
+// Resample stages from the output back to the input: the last stage of the graph is applied
+// first. Consecutive warps are folded into one matrix.
+static std::vector<CoordOp> coordOps(const FilterGraph& g, const FusedPass& p, int W, int H) {
+    std::vector<CoordOp> ops;
+    for (auto it = p.resample.rbegin(); it != p.resample.rend(); ++it) {
+        const FilterStage& s = g.stages[*it];
+        if (s.op == StageOp::Warp) {
+            const cv::Matx33f M = affineMatrix(s.affine, W, H);
+            if (!ops.empty() && !ops.back().snap) { ops.back().M = M * ops.back().M; continue; }
+            CoordOp o; o.M = M;
+            ops.push_back(o);
+        }
+        else {
+            // Same grid as the Pixelate filter: (W / b) x (H / b) cells of (nearly) b x b pixels
+            CoordOp o; o.snap = true;
+            o.sx = (float)std::max(1, W / s.block); o.sy = (float)std::max(1, H / s.block);
+            o.w = (float)W; o.h = (float)H;
+            ops.push_back(o);
+        }
+    }
+    return ops;
+}
+
+static inline void mapPoint(const std::vector<CoordOp>& ops, size_t first, float& x, float& y) {
+    for (size_t k = first; k < ops.size(); ++k) {
+        const CoordOp& o = ops[k];
+        if (o.snap) {
+            // Pixel i (the one containing the point) lies in cell floor(i * sx / W); move to
+            // that cell's center
+            x = (std::floor(std::floor(x) * o.sx / o.w) + 0.5f) * o.w / o.sx;
+            y = (std::floor(std::floor(y) * o.sy / o.h) + 0.5f) * o.h / o.sy;
+        }
+        else {
+            const float u = o.M(0, 0) * x + o.M(0, 1) * y + o.M(0, 2);
+            const float v = o.M(1, 0) * x + o.M(1, 1) * y + o.M(1, 2);
+            x = u; y = v;
+        }
+    }
+}
+
+// -------------------- Pass kernels --------------------
+// A fused pass runs through a kernel instantiated for its shape: how the output maps to the
+// source (Map), which pointwise stages follow (Color) and, for pixelate passes, the block
+// size (B). Everything that is fixed for the frame is a template parameter, so the per-pixel
+// and per-cell loops carry no stage switches; processCpuFrame picks the kernel when it plans
+// the graph (cpuFramePlan), runCpuPass once per call.
+
+struct PassCtx {
+    const FilterGraph& g;
+    const FusedPass& p;
+    const cv::Mat& src;
+    cv::Mat& dst;
+    const std::vector<CoordOp>& ops;
+    const std::vector<cv::Rect>& rois;  // disjoint output regions to (re)compute
+};
+
+// Regions split into row bands of about `rows` rows, one thread-pool task each
+static std::vector<cv::Rect> regionBands(const std::vector<cv::Rect>& rois, int rows) {
+    std::vector<cv::Rect> bands;
+    for (const cv::Rect& r : rois)
+        for (int y = r.y; y < r.y + r.height; y += rows)
+            bands.emplace_back(r.x, y, r.width, std::min(rows, r.y + r.height - y));
+    return bands;
+}
+
+// Output pixel center -> source position, from ops[first] on
+struct MapIdentity {
+    MapIdentity(const PassCtx&, size_t) {}
+    void point(float&, float&) const {}
+    void row(const cv::Mat& src, int y, int x0, int x1, uchar* d) const {
+        std::memcpy(d + 3 * x0, src.ptr<uchar>(y) + 3 * x0, (size_t)(x1 - x0) * 3);
+    }
+};
+
+struct MapAffine {
+    cv::Matx33f M;
+    AffineWarp warp;
+    MapAffine(const PassCtx& c, size_t first) : M(c.ops[first].M), warp(M, c.src.cols, c.src.rows) {}
+    void point(float& x, float& y) const {
+        const float u = M(0, 0) * x + M(0, 1) * y + M(0, 2);
+        const float v = M(1, 0) * x + M(1, 1) * y + M(1, 2);
+        x = u; y = v;
+    }
+    void row(const cv::Mat& src, int y, int x0, int x1, uchar* d) const { warp.row(src, y, d, x0, x1); }
+};
+
+struct MapGeneric {
+    const std::vector<CoordOp>& ops;
+    size_t first;
+    MapGeneric(const PassCtx& c, size_t f) : ops(c.ops), first(f) {}
+    void point(float& x, float& y) const { mapPoint(ops, first, x, y); }
+    void row(const cv::Mat& src, int y, int x0, int x1, uchar* d) const {
+        for (int x = x0; x < x1; ++x) {
+            float u = x + 0.5f, v = y + 0.5f;
+            mapPoint(ops, first, u, v);
+            sampleBilinearBGR(src, u - 0.5f, v - 0.5f, d + 3 * x);
+        }
+    }
+};
+
+// Pointwise stages on a row of n samples
+struct ColorNone {
+    explicit ColorNone(const PassCtx&) {}
+    void row(uchar*, int) const {}
+};
+
+// A lone SinCity stage: the exact SIMD kernel instead of the table
+struct ColorSinCity {
+    cv::Vec3b keepBGR;
+    int thresh;
+    explicit ColorSinCity(const PassCtx& c)
+        : keepBGR(c.g.stages[c.p.pointwise[0]].keepBGR), thresh(c.g.stages[c.p.pointwise[0]].thresh) {}
+    void row(uchar* bgr, int n) const { sinCityRow(bgr, n, keepBGR, thresh); }
+};
+
+// Any other pointwise stages: one cached 3D LUT lookup per stage (ColorLut3D::apply), the
+// tables resolved once per pass
+struct ColorChain {
+    std::vector<std::shared_ptr<const ColorLut3D>> luts;
+    explicit ColorChain(const PassCtx& c) {
+        for (int i : c.p.pointwise) luts.push_back(stageLut(c.g.stages[i]));
+    }
+    void row(uchar* bgr, int n) const {
+        for (const auto& lut : luts) lut->apply(bgr, n);
+    }
+};
+
+template <class Map, class Color>
+static void fusedPass(const PassCtx& c) {
+    const Map map(c, 0);
+    const Color color(c);
+    const std::vector<cv::Rect> bands = regionBands(c.rois, bandRows((size_t)c.src.cols * 3));
+    cpuThreadPool().parallelFor(0, (int)bands.size(), 1, [&](int b0, int b1) {
+        for (int b = b0; b < b1; ++b) {
+            const cv::Rect& r = bands[b];
+            for (int y = r.y; y < r.y + r.height; ++y) {
+                uchar* d = c.dst.ptr<uchar>(y);
+                map.row(c.src, y, r.x, r.x + r.width, d);
+                // Pointwise stages on the freshly written row while it is still in L1
+                color.row(d + 3 * r.x, r.width);
+            }
+        }
+    });
+}
+
+// Write cells [i0, i1] of cell row j of the pixelate grid into the first output row of its
+// block row (pixelKernels().expandCellsBGR) and replicate them with row copies. B > 0: B x B
+// blocks that tile the frame exactly; B == 0: any grid, output pixel (x, y) belongs to cell
+// (x*sx/W, y*sy/H) as with INTER_NEAREST, always written full width.
+template <int B>
+static void splatCellRow(const uchar* c, int sx, int sy, int j, int i0, int i1, cv::Mat& dst) {
+    const int W = dst.cols, H = dst.rows;
+    const int y = B > 0 ? j * B : (j * H + sy - 1) / sy;
+    const int yEnd = B > 0 ? y + B : ((j + 1) * H + sy - 1) / sy;
+    const int x = B > 0 ? i0 * B : 0;
+    const int n = B > 0 ? (i1 + 1 - i0) * B : W;
+    uchar* row0 = dst.ptr<uchar>(y) + 3 * x;
+    if (B > 0) pixelKernels().expandCellsBGR(row0, c + 3 * i0, i1 + 1 - i0, n);
+    else       pixelKernels().expandCellsBGR(row0, c, sx, W);
+    for (int yy = y + 1; yy < yEnd; ++yy)
+        std::memcpy(dst.ptr<uchar>(yy) + 3 * x, row0, (size_t)n * 3);
+}
+
+// The pass is constant over each cell of the leading snap (ops[0]): one tap per cell at its
+// center, pointwise stages on the row of cell samples, then splat (~1/b^2 the work of a
+// per-pixel pass). Regions widen to whole cells; each cell row is owned by one task.
+template <int B, class Map, class Color>
+static void cellPass(const PassCtx& c) {
+    const Map map(c, 1);
+    const Color color(c);
+    const int W = c.src.cols, H = c.src.rows;
+    const int sx = (int)c.ops[0].sx, sy = (int)c.ops[0].sy;
+    const float fx = (float)W / sx, fy = (float)H / sy;
+
+    // Cells [lo, hi] needed in every cell row (hi < lo: none)
+    std::vector<int> lo(sy, sx), hi(sy, -1);
+    for (const cv::Rect& r : c.rois) {
+        const int j0 = r.y * sy / H, j1 = (r.y + r.height - 1) * sy / H;
+        const int i0 = B > 0 ? r.x / B : 0, i1 = B > 0 ? (r.x + r.width - 1) / B : sx - 1;
+        for (int j = j0; j <= j1; ++j) { lo[j] = std::min(lo[j], i0); hi[j] = std::max(hi[j], i1); }
+    }
+
+    cv::Mat cells(sy, sx, CV_8UC3);
+    cpuThreadPool().parallelFor(0, sy, std::max(1, bandRows((size_t)W * 3) * sy / H), [&](int j0, int j1) {
+        for (int j = j0; j < j1; ++j) {
+            if (hi[j] < lo[j]) continue;
+            uchar* cr = cells.ptr<uchar>(j);
+            for (int i = lo[j]; i <= hi[j]; ++i) {
+                float qx = (i + 0.5f) * fx, qy = (j + 0.5f) * fy;
+                map.point(qx, qy);
+                sampleBilinearBGR(c.src, qx - 0.5f, qy - 0.5f, cr + 3 * i);
+            }
+            color.row(cr + 3 * lo[j], hi[j] + 1 - lo[j]);
+            splatCellRow<B>(cr, sx, sy, j, lo[j], hi[j], c.dst);
+        }
+    });
+}
+
+using PassKernel = void (*)(const PassCtx&);
+
+enum class MapKind { Identity, Affine, Generic };
+enum class ColorKind { None, SinCity, Chain };
+
+template <int B, class Color>
+static PassKernel pickMap(MapKind m, bool cells) {
+    switch (m) {
+    case MapKind::Identity: return cells ? cellPass<B, MapIdentity, Color> : fusedPass<MapIdentity, Color>;
+    case MapKind::Affine:   return cells ? cellPass<B, MapAffine, Color>   : fusedPass<MapAffine, Color>;
+    default:                return cells ? cellPass<B, MapGeneric, Color>  : fusedPass<MapGeneric, Color>;
+    }
+}
+
+template <int B>
+static PassKernel pickColor(ColorKind k, MapKind m, bool cells) {
+    switch (k) {
+    case ColorKind::None:    return pickMap<B, ColorNone>(m, cells);
+    case ColorKind::SinCity: return pickMap<B, ColorSinCity>(m, cells);
+    default:                 return pickMap<B, ColorChain>(m, cells);
+    }
+}
+
+// ops: coordOps(g, p, W, H) of a W x H frame
+static PassKernel selectPassKernel(const FilterGraph& g, const FusedPass& p, const std::vector<CoordOp>& ops,
+    int W, int H)
+{
+    // Mapping after the leading snap of a pixelate pass, or the whole mapping otherwise
+    const size_t first = p.cellGrid ? 1 : 0;
+    const size_t rest = ops.size() - first;
+    const MapKind m = rest == 0 ? MapKind::Identity
+        : rest == 1 && !ops[first].snap ? MapKind::Affine : MapKind::Generic;
+
+    const ColorKind k = p.pointwise.empty() ? ColorKind::None
+        : p.pointwise.size() == 1 && g.stages[p.pointwise[0]].op == StageOp::SinCity ? ColorKind::SinCity
+        : ColorKind::Chain;
+
+    // Power-of-two blocks that tile the frame get fixed-width splats
+    int B = 0;
+    if (p.cellGrid) {
+        const int block = g.stages[p.resample.back()].block;
+        if (W % block == 0 && H % block == 0) B = block;
+    }
+    switch (B) {
+    case 2:  return pickColor<2>(k, m, true);
+    case 4:  return pickColor<4>(k, m, true);
+    case 8:  return pickColor<8>(k, m, true);
+    case 16: return pickColor<16>(k, m, true);
+    case 32: return pickColor<32>(k, m, true);
+    default: return pickColor<0>(k, m, p.cellGrid);
+    }
+}
+
+static void runFusedPass(const FilterGraph& g, const FusedPass& p, const cv::Mat& src, cv::Mat& dst,
+    const std::vector<cv::Rect>& rois)
+{
+    const std::vector<CoordOp> ops = coordOps(g, p, src.cols, src.rows);
+    const PassCtx c{ g, p, src, dst, ops, rois };
+    selectPassKernel(g, p, ops, src.cols, src.rows)(c);
+}
+
+// Each region is filtered from a source window grown by the kernel radius, so results match
+// the full-frame filter (BORDER_REPLICATE only ever applies at the frame edges)
+static void runNeighborhoodPass(const FilterStage& s, const cv::Mat& src, cv::Mat& dst,
+    const std::vector<cv::Rect>& rois)
+{
+    switch (s.op) {
+    case StageOp::BoxBlur: {
+        const int k = 2 * s.radius + 1;
+        const cv::Rect frame(0, 0, src.cols, src.rows);
+        cv::Mat tmp;
+        for (const cv::Rect& r : rois) {
+            const cv::Rect ext = cv::Rect(r.x - s.radius, r.y - s.radius, r.width + 2 * s.radius,
+                r.height + 2 * s.radius) & frame;
+            cv::blur(src(ext), tmp, cv::Size(k, k), cv::Point(-1, -1), cv::BORDER_REPLICATE);
+            cv::Mat out = dst(r);
+            tmp(cv::Rect(r.x - ext.x, r.y - ext.y, r.width, r.height)).copyTo(out);
+        }
+        break;
+    }
+    default: CV_Error(cv::Error::StsBadArg, "not a neighborhood stage: " + s.name());
+    }
+}
+
+void runCpuPass(const FilterGraph& graph, const FusedPass& pass, const cv::Mat& src, cv::Mat& dst,
+    const std::vector<cv::Rect>& rois)
+{
+    CV_Assert(src.type() == CV_8UC3 && dst.type() == CV_8UC3 && dst.size() == src.size() && dst.data != src.data);
+    if (rois.empty()) return;
+    if (pass.neighborhood >= 0) runNeighborhoodPass(graph.stages[pass.neighborhood], src, dst, rois);
+    else                        runFusedPass(graph, pass, src, dst, rois);
+}
+
+cv::Rect cpuPassFootprint(const FilterGraph& graph, const FusedPass& pass, const cv::Rect& r, cv::Size size) {
+    const cv::Rect frame(0, 0, size.width, size.height);
+    if (r.empty()) return cv::Rect();
+    if (pass.neighborhood >= 0) {
+        const int k = graph.stages[pass.neighborhood].radius;
+        return cv::Rect(r.x - k, r.y - k, r.width + 2 * k, r.height + 2 * k) & frame;
+    }
+    const std::vector<CoordOp> ops = coordOps(graph, pass, size.width, size.height);
+    if (ops.empty()) return r & frame;
+
+    // Box of the pixel centers pushed through the mapping: snaps are monotone, affine steps
+    // map the box onto a parallelogram whose bounding box is kept
+    float x0 = r.x + 0.5f, y0 = r.y + 0.5f, x1 = r.x + r.width - 0.5f, y1 = r.y + r.height - 0.5f;
+    for (const CoordOp& o : ops) {
+        if (o.snap) {
+            const std::vector<CoordOp> one{ o };
+            mapPoint(one, 0, x0, y0);
+            mapPoint(one, 0, x1, y1);
+            continue;
+        }
+        float xs[4] = { x0, x1, x0, x1 }, ys[4] = { y0, y0, y1, y1 };
+        x0 = y0 = HUGE_VALF; x1 = y1 = -HUGE_VALF;
+        for (int i = 0; i < 4; ++i) {
+            const float u = o.M(0, 0) * xs[i] + o.M(0, 1) * ys[i] + o.M(0, 2);
+            const float v = o.M(1, 0) * xs[i] + o.M(1, 1) * ys[i] + o.M(1, 2);
+            x0 = std::min(x0, u); x1 = std::max(x1, u);
+            y0 = std::min(y0, v); y1 = std::max(y1, v);
+        }
+    }
+    // Bilinear taps around the sample positions, one pixel of slack for the rounding of the
+    // fixed-point warp and the float mapping
+    const float lim = 4.f * (size.width + size.height);
+    x0 = std::max(x0, -lim); y0 = std::max(y0, -lim); x1 = std::min(x1, lim); y1 = std::min(y1, lim);
+    const int tx0 = (int)std::floor(x0 - 0.5f) - 1, ty0 = (int)std::floor(y0 - 0.5f) - 1;
+    const int tx1 = (int)std::floor(x1 - 0.5f) + 2, ty1 = (int)std::floor(y1 - 0.5f) + 2;
+    return cv::Rect(tx0, ty0, tx1 - tx0 + 1, ty1 - ty0 + 1) & frame;
+}
+
+// A pixelate pass with no further mapping samples its input only around the cell centers: two
+// rows per cell row (the bilinear taps of cellPass). The pass before it only has to produce
+// those rows, e.g. SinCity>Pixelate runs SinCity on 2 / b of the frame.
+static bool readsCellRowsOnly(const FusedPass& p) {
+    return p.neighborhood < 0 && p.cellGrid && p.resample.size() == 1;
+}
+
+static std::vector<cv::Rect> cellTapRows(const FilterGraph& g, const FusedPass& p, int W, int H) {
+    const int sy = std::max(1, H / g.stages[p.resample[0]].block);
+    const float fy = (float)H / sy;
+    std::vector<cv::Rect> rows;
+    for (int j = 0; j < sy; ++j) {
+        // One more row either way where the tap row could round differently in cellPass
+        const float q = (j + 0.5f) * fy - 0.5f;
+        const int t = (int)std::floor(q), edge = q - t < 1e-3f || q - t > 1.f - 1e-3f;
+        const int y0 = std::max(t - edge, 0), y1 = std::min(t + 1 + edge, H - 1);
+        if (!rows.empty() && y0 <= rows.back().y + rows.back().height)
+            rows.back().height = std::max(rows.back().height, y1 + 1 - rows.back().y);
+        else
+            rows.emplace_back(0, y0, W, y1 + 1 - y0);
+    }
+    return rows;
+}
+
+// processCpuFrame's plan of one graph at one frame size: the passes, and per pass its mapping,
+// its kernel and the output regions it computes. Rebuilt only when the graph or the size
+// changes (a mode switch), not per frame.
+struct CpuFramePlan {
+    FilterGraph graph;
+    cv::Size size;
+    FilterPlan plan;
+    std::vector<std::vector<CoordOp>> ops;      // coordOps per pass
+    std::vector<PassKernel> kernels;            // nullptr for neighborhood passes
+    std::vector<std::vector<cv::Rect>> rois;    // the whole frame, or the rows the next pass reads
+};
+
+// One plan per thread: a caller processes the same graph frame after frame
+static const CpuFramePlan& cpuFramePlan(const FilterGraph& graph, cv::Size size) {
+    thread_local CpuFramePlan cache;
+    thread_local bool valid = false;
+    if (valid && cache.size == size && cache.graph == graph) return cache;
+
+    valid = false;
+    const int W = size.width, H = size.height;
+    cache.graph = graph;
+    cache.size = size;
+    cache.plan = planFilterGraph(graph, W, H);
+    const size_t n = cache.plan.passes.size();
+    cache.ops.assign(n, std::vector<CoordOp>());
+    cache.kernels.assign(n, nullptr);
+    cache.rois.assign(n, std::vector<cv::Rect>{ cv::Rect(0, 0, W, H) });
+    for (size_t k = 0; k < n; ++k) {
+        const FusedPass& p = cache.plan.passes[k];
+        if (p.neighborhood < 0) {
+            cache.ops[k] = coordOps(cache.graph, p, W, H);
+            cache.kernels[k] = selectPassKernel(cache.graph, p, cache.ops[k], W, H);
+        }
+        if (k + 1 < n && readsCellRowsOnly(cache.plan.passes[k + 1]))
+            cache.rois[k] = cellTapRows(cache.graph, cache.plan.passes[k + 1], W, H);
+    }
+    valid = true;
+    return cache;
+}
+
+void processCpuFrame(const cv::Mat& src, cv::Mat& dst, const FilterGraph& graph) {
+    if (src.empty()) { dst.release(); return; }
+    CV_Assert(src.type() == CV_8UC3);
+
+    const CpuFramePlan& fp = cpuFramePlan(graph, src.size());
+    if (fp.plan.passes.empty()) { dst = src; return; }
+
+    // Every pass writes a separate output buffer; intermediates alternate between two frames
+    if (dst.data == src.data) dst.release();
+    cv::Mat tmp[2];
+    const cv::Mat* in = &src;
+    for (size_t k = 0; k < fp.plan.passes.size(); ++k) {
+        const FusedPass& p = fp.plan.passes[k];
+        cv::Mat& out = k + 1 == fp.plan.passes.size() ? dst : tmp[k & 1];
+        out.create(src.rows, src.cols, CV_8UC3);
+        if (p.neighborhood >= 0) {
+            runNeighborhoodPass(fp.graph.stages[p.neighborhood], *in, out, fp.rois[k]);
+        }
+        else {
+            const PassCtx c{ fp.graph, p, *in, out, fp.ops[k], fp.rois[k] };
+            fp.kernels[k](c);
+        }
+        in = &out;
+    }
+}
+
+void processCpuFrameI420(const cv::Mat& i420, cv::Mat& dst, const FilterGraph& graph) {
+    if (i420.empty()) { dst.release(); return; }
+    CV_Assert(i420.type() == CV_8UC1 && i420.rows % 3 == 0);
+
+    const FilterPlan& plan = cpuFramePlan(graph, cv::Size(i420.cols, i420.rows * 2 / 3)).plan;
+    if (plan.passes.size() == 1 && plan.passes[0].neighborhood < 0 && plan.passes[0].resample.empty()
+        && plan.passes[0].pointwise.size() == 1) {
+        const FilterStage& s = graph.stages[plan.passes[0].pointwise[0]];
+        if (s.op == StageOp::SinCity) {
+            if (dst.data == i420.data) dst.release();
+            sinCityI420(i420, dst, s.keepBGR, s.thresh);
+            return;
+        }
+    }
+    cv::Mat bgr;
+    cv::cvtColor(i420, bgr, cv::COLOR_YUV2BGR_I420);
+    processCpuFrame(bgr, dst, graph);
+}
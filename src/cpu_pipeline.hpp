@@ -0,0 +1,30 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include "filter_graph.hpp"
+
+// CPU executor of a filter graph, pass by pass as planned by planFilterGraph. A fused pass has
+// the same dataflow as the generated GPU shader: every output pixel is mapped through the
+// resample stages, bilinearly sampled from the pass input and run through the pointwise
+// stages before it is written, row band by row band on the thread pool. Passes that start
+// with a pixelate snap sample one point per cell and splat it. Neighborhood stages run on
+// the materialized output of the previous pass. Each fused pass runs through a kernel
+// instantiated for its mapping, pointwise stages and pixelate block size (cpu_pipeline.cpp).
+// The plan and the kernels are kept per thread for the last graph and frame size, so they are
+// only rebuilt when either changes. dst is (re)allocated as needed; if the plan is empty it
+// simply shares src.
+void processCpuFrame(const cv::Mat& src, cv::Mat& dst, const FilterGraph& graph);
+
+// processCpuFrame of an I420 frame (CV_8UC1, h * 3/2 rows) into a BGR8 dst. A graph that plans
+// to a lone SinCity runs sinCityI420 on the planes; any other graph converts to BGR first.
+void processCpuFrameI420(const cv::Mat& i420, cv::Mat& dst, const FilterGraph& graph);
+
+// One planned pass restricted to the given disjoint output regions of dst, which must already
+// be allocated with src's size and not alias it; pixels outside the regions are left alone
+// (pixelate cells straddling a region may be rewritten whole). Region results are identical
+// to the full-frame pass.
+void runCpuPass(const FilterGraph& graph, const FusedPass& pass, const cv::Mat& src, cv::Mat& dst,
+    const std::vector<cv::Rect>& rois);
+
+// Conservative bounding box of the src pixels runCpuPass reads to produce region r of a frame
+// of the given size (clipped to the frame)
+cv::Rect cpuPassFootprint(const FilterGraph& graph, const FusedPass& pass, const cv::Rect& r, cv::Size size);
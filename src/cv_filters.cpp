@@ -1,4 +1,7 @@
 #include "cv_filters.hpp"
+#include "thread_pool.hpp"
+#include "pixel_kernels.hpp"
+#include <cmath>
 
 static void pixelateCPU(cv::Mat& img, int block) {
     if (img.empty() || block <= 1) return;
@@ -13,29 +16,130 @@ static void pixelateCPU(cv::Mat& img, int block) {
     cv::resize(small, img, img.size(), 0, 0, cv::INTER_NEAREST);
 }
 
-static void sinCityCPU(cv::Mat& img, cv::Vec3b keepBGR, int thresh) {
-    CV_Assert(img.channels() == 3);
-    cv::Mat gray; cv::cvtColor(img, gray, cv::COLOR_BGR2GRAY);
-    cv::Mat bw; cv::cvtColor(gray, bw, cv::COLOR_GRAY2BGR);
-
-    cv::Mat diff;
-    cv::Mat keep(img.size(), CV_8UC1, cv::Scalar(0));
-
-    // Compute color difference from keepBGR
-    for (int y = 0; y < img.rows; ++y) {
-        const cv::Vec3b* src = img.ptr<cv::Vec3b>(y);
-        uchar* kdst = keep.ptr<uchar>(y);
-        for (int x = 0; x < img.cols; ++x) {
-            int db = int(src[x][0]) - int(keepBGR[0]);
-            int dg = int(src[x][1]) - int(keepBGR[1]);
-            int dr = int(src[x][2]) - int(keepBGR[2]);
-            int d = int(std::sqrt(double(db * db + dg * dg + dr * dr)));
-            kdst[x] = (d <= thresh) ? 255 : 0;
+// ---------------- SinCity ----------------
+// One fused pass per pixel: squared BGR distance to keepBGR (integer, no sqrt) decides
+// between the original color and its luma, written back in place (pixelKernels().sinCitySpan).
+//   int(sqrt(d2)) <= thresh  <=>  d2 < (thresh + 1)^2,  so the mask matches the old float path.
+// Luma uses OpenCV 4's Q15 BGR2GRAY weights, so the gray branch is identical to cvtColor.
+static void sinCitySpan(uchar* p, int n, const SinCityKey& k) {
+    pixelKernels().sinCitySpan(p, n, k);
+}
+
+static SinCityKey makeSinCityKey(cv::Vec3b keepBGR, int thresh) {
+    SinCityKey k;
+    k.b = keepBGR[0]; k.g = keepBGR[1]; k.r = keepBGR[2];
+    k.lim = thresh < 0 ? 0 : (thresh + 1) * (thresh + 1);
+    return k;
+}
+
+// SinCity as a ColorTransform: the grade is the luma (linear, so it interpolates exactly up to
+// rounding) and the qualifier is the signed distance to the keep sphere. Integer colors have
+// integer d2, so keep > 0 <=> d2 < lim, the same mask as the sinCitySpan kernels.
+struct SinCityTransform : ColorTransform {
+    SinCityKey k;
+    float radius;                                   // between sqrt(lim - 1) and sqrt(lim)
+    explicit SinCityTransform(const SinCityKey& key) : k(key), radius(std::sqrt(std::max(0.f, k.lim - 0.5f))) {}
+
+    cv::Vec3b grade(int b, int g, int r) const override {
+        const uchar y = (uchar)((b * kGrayB + g * kGrayG + r * kGrayR + (1 << (kGrayShift - 1))) >> kGrayShift);
+        return { y, y, y };
+    }
+
+    float keep(int b, int g, int r) const override {
+        const int db = b - k.b, dg = g - k.g, dr = r - k.r;
+        return radius - std::sqrt((float)(db * db + dg * dg + dr * dr));
+    }
+
+    int keepSign(const cv::Vec3i& lo, const cv::Vec3i& hi) const override {
+        const int key[3] = { k.b, k.g, k.r };
+        int near2 = 0, far2 = 0;
+        for (int i = 0; i < 3; ++i) {
+            const int dn = key[i] < lo[i] ? lo[i] - key[i] : key[i] > hi[i] ? key[i] - hi[i] : 0;
+            const int df = std::max(std::abs(key[i] - lo[i]), std::abs(key[i] - hi[i]));
+            near2 += dn * dn; far2 += df * df;
         }
+        return far2 < k.lim ? 1 : near2 >= k.lim ? -1 : 0;
+    }
+};
+
+std::shared_ptr<const ColorLut3D> pointwiseLut(FilterType type, const FilterParams& params) {
+    if (type != FilterType::SinCity) return nullptr;
+    ColorLutKey key;
+    key.kind = (int)FilterType::SinCity;
+    key.params = { params.keepBGR[0], params.keepBGR[1], params.keepBGR[2], params.thresh };
+    return colorLutCache().get(key, [&] {
+        return std::make_shared<const SinCityTransform>(makeSinCityKey(params.keepBGR, params.thresh));
+    });
+}
+
+void sinCityRow(uchar* bgr, int n, cv::Vec3b keepBGR, int thresh) {
+    sinCitySpan(bgr, n, makeSinCityKey(keepBGR, thresh));
+}
+
+static void sinCityCPU(cv::Mat& img, cv::Vec3b keepBGR, int thresh) {
+    CV_Assert(img.type() == CV_8UC3);
+    const SinCityKey k = makeSinCityKey(keepBGR, thresh);
+
+    // Continuous frames are split into equal spans, otherwise into row bands
+    const size_t rowBytes = (size_t)img.cols * 3;
+    if (img.isContinuous()) {
+        const int total = img.rows * img.cols;
+        const int span = (int)(bandRows(rowBytes) * img.cols);
+        cpuThreadPool().parallelFor(0, total, span, [&](int b, int e) {
+            sinCitySpan(img.data + (size_t)b * 3, e - b, k);
+        });
+        return;
     }
-    // Keep color where pixels are close to the target color; otherwise use grayscale
-    img.copyTo(bw, keep);
-    img = bw;
+    cpuThreadPool().parallelFor(0, img.rows, bandRows(rowBytes), [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y)
+            sinCitySpan(img.ptr<uchar>(y), img.cols, k);
+    });
+}
+
+// BT.601 limited range YUV -> RGB in Q20, OpenCV's ITUR_BT_601_* constants, so the colors
+// match cvtColor(COLOR_YUV2BGR_I420) exactly
+constexpr int kYuvShift = 20;
+constexpr int kYuvCY = 1220542, kYuvCUB = 2116026, kYuvCUG = -409993, kYuvCVG = -852492, kYuvCVR = 1673527;
+
+static inline uchar clampToByte(int v) { return (uchar)(v < 0 ? 0 : v > 255 ? 255 : v); }
+
+void sinCityI420(const cv::Mat& i420, cv::Mat& bgr, cv::Vec3b keepBGR, int thresh) {
+    CV_Assert(i420.type() == CV_8UC1 && i420.rows % 3 == 0 && i420.cols % 2 == 0);
+    const int w = i420.cols, h = i420.rows * 2 / 3;
+    CV_Assert(h % 2 == 0);
+    const cv::Mat src = i420.isContinuous() ? i420 : i420.clone();
+    bgr.create(h, w, CV_8UC3);
+    const SinCityKey k = makeSinCityKey(keepBGR, thresh);
+    const uchar* planeY = src.data;
+    const uchar* planeU = planeY + (size_t)w * h;
+    const uchar* planeV = planeU + (size_t)(w / 2) * (h / 2);
+
+    // Row pairs share a chroma row; the chroma terms are computed once per 2x2 block
+    cpuThreadPool().parallelFor(0, h / 2, std::max(1, bandRows((size_t)w * 3) / 2), [&](int c0, int c1) {
+        for (int cy = c0; cy < c1; ++cy) {
+            const uchar* u = planeU + (size_t)cy * (w / 2);
+            const uchar* v = planeV + (size_t)cy * (w / 2);
+            for (int dy = 0; dy < 2; ++dy) {
+                const int y = 2 * cy + dy;
+                const uchar* py = planeY + (size_t)y * w;
+                uchar* out = bgr.ptr<uchar>(y);
+                for (int x = 0; x < w; x += 2) {
+                    const int uu = u[x >> 1] - 128, vv = v[x >> 1] - 128;
+                    const int cb = kYuvCUB * uu, cg = kYuvCVG * vv + kYuvCUG * uu, cr = kYuvCVR * vv;
+                    for (int i = x; i < x + 2; ++i) {
+                        const int l = std::max(0, py[i] - 16) * kYuvCY + (1 << (kYuvShift - 1));
+                        const int b = clampToByte((l + cb) >> kYuvShift);
+                        const int g = clampToByte((l + cg) >> kYuvShift);
+                        const int r = clampToByte((l + cr) >> kYuvShift);
+                        const int db = b - k.b, dg = g - k.g, dr = r - k.r;
+                        uchar* p = out + 3 * i;
+                        if (db * db + dg * dg + dr * dr < k.lim) { p[0] = (uchar)b; p[1] = (uchar)g; p[2] = (uchar)r; }
+                        else p[0] = p[1] = p[2] = clampToByte(l >> kYuvShift);
+                    }
+                }
+            }
+        }
+    });
 }
 
 void applyCpuFilter(cv::Mat& img, FilterType type, const FilterParams& params) {
@@ -1,6 +1,7 @@
 #pragma once
 #include <opencv2/opencv.hpp>
 #include <string>
+#include "color_lut.hpp"
 
 enum class FilterType {
     None = 0,
@@ -15,4 +16,21 @@ struct FilterParams {
 };
 
 void applyCpuFilter(cv::Mat& img, FilterType type, const FilterParams& params);
+
+// Cached 3D LUT (color_lut.hpp) for filters that are a pure function of the pixel color
+// (SinCity), or nullptr for the others. Built on first use per parameter set. The GPU path
+// samples it as a 3D texture and the CPU pass kernels look up pointwise chains in it
+// (ColorLut3D::apply); a lone SinCity stage keeps its SIMD kernel (sinCityRow) on the CPU,
+// which is exact and faster than a per-pixel table walk.
+std::shared_ptr<const ColorLut3D> pointwiseLut(FilterType type, const FilterParams& params);
+
+// SinCity on n interleaved BGR pixels, in place. Shared by applyCpuFilter and the fused
+// warp + filter pass (cpu_pipeline.cpp), which runs it on each row while it is in cache.
+void sinCityRow(uchar* bgr, int n, cv::Vec3b keepBGR, int thresh);
+
+// SinCity straight from an I420 frame (CV_8UC1, h * 3/2 rows) into bgr, which is (re)allocated
+// as a w x h BGR8 frame: one pass instead of cvtColor(COLOR_YUV2BGR_I420) + SinCity. The keep
+// test sees cvtColor's color; the gray branch reads the luma from Y directly, which differs from
+// the luma of the converted color only by rounding, and where a saturated color clips.
+void sinCityI420(const cv::Mat& i420, cv::Mat& bgr, cv::Vec3b keepBGR, int thresh);
 std::string filterName(FilterType t);
@@ -1,28 +1,36 @@
 #include "cv_geom.hpp"
+#include "warp_engine.hpp"
+#include <algorithm>
 #include <cmath>
 
-static cv::Matx23f makeAffine23(const AffineParams& p, int w, int h) {
-    // Use the image center as the rotation and scaling origin
-    float cx = w * 0.5f;
-    float cy = h * 0.5f;
-    // Rotation and scaling
-    cv::Matx23f R = cv::getRotationMatrix2D(cv::Point2f(cx, cy), p.thetaDeg, p.scale);
-    // Translation
-    R(0, 2) += p.tx;
-    R(1, 2) += p.ty;
-    return R;
-}
-
 void warpCpuAffine(cv::Mat& img, const AffineParams& p) {
-    if (p.scale == 1.f && std::abs(p.thetaDeg) < 1e-4 && std::abs(p.tx) < 1e-4 && std::abs(p.ty) < 1e-4)
-        return;
+    const cv::Matx33f M = affineMatrix(p, img.cols, img.rows);
+    if (isIdentityAffine(M)) return;
     cv::Mat out;
-    cv::Matx23f A = makeAffine23(p, img.cols, img.rows);
-    cv::warpAffine(img, out, A, img.size(),
-        cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar(0, 0, 0));
+    warpAffineBGR(img, out, M);
     img = out;
 }
 
+void sampleBilinearBGR(const cv::Mat& src, float x, float y, uchar* out) {
+    const int x0 = (int)std::floor(x), y0 = (int)std::floor(y);
+    const float ax = x - x0, ay = y - y0;
+    const float w[4] = { (1.f - ax) * (1.f - ay), ax * (1.f - ay), (1.f - ax) * ay, ax * ay };
+    float acc[3] = { 0.f, 0.f, 0.f };
+    for (int k = 0; k < 4; ++k) {
+        const int xx = x0 + (k & 1), yy = y0 + (k >> 1);
+        if (xx < 0 || yy < 0 || xx >= src.cols || yy >= src.rows) continue;
+        const uchar* s = src.ptr<uchar>(yy) + 3 * xx;
+        acc[0] += w[k] * s[0]; acc[1] += w[k] * s[1]; acc[2] += w[k] * s[2];
+    }
+    for (int c = 0; c < 3; ++c) out[c] = cv::saturate_cast<uchar>(acc[c]);
+}
+
+bool isIdentityAffine(const cv::Matx33f& M) {
+    const float eps = 1e-4f;
+    return std::abs(M(0, 0) - 1.f) < eps && std::abs(M(0, 1)) < eps && std::abs(M(0, 2)) < eps
+        && std::abs(M(1, 0)) < eps && std::abs(M(1, 1) - 1.f) < eps && std::abs(M(1, 2)) < eps;
+}
+
 cv::Matx33f affineMatrix(const AffineParams& p, int w, int h) {
     float cx = w * 0.5f;
     float cy = h * 0.5f;
@@ -8,7 +8,21 @@ struct AffineParams {
     float thetaDeg = 0.f; // תǣȣ
 };
 
+// In-place warp through AffineWarp (warp_engine.hpp), i.e. warpAffineBGR(affineMatrix(p)): the
+// same image as the pipeline's Warp stage and the GPU shader for the same params (scale > 1
+// zooms out). Integer translations and quarter turns are pure copies
 void warpCpuAffine(cv::Mat& img, const AffineParams& p);
 
+// The functions below take M as an output -> source mapping in pixel coordinates
+// (affineMatrix), the convention the GPU shaders use: output pixel (x, y) shows the
+// source at M * (x + 0.5, y + 0.5). Samples outside the source are black.
+
+// Bilinear sample of an 8UC3 image at (x, y) in integer-centered coordinates (pixel (i, j) at
+// (i, j)); taps outside the image read as black, as with cv::warpAffine + BORDER_CONSTANT
+void sampleBilinearBGR(const cv::Mat& src, float x, float y, uchar* out);
+
+// True if M maps every pixel onto itself
+bool isIdentityAffine(const cv::Matx33f& M);
+
 //  3x3  GPU uniform
 cv::Matx33f affineMatrix(const AffineParams& p, int width, int height);
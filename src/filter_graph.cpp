@@ -0,0 +1,146 @@
+#include "filter_graph.hpp"
+#include <algorithm>
+
+StageKind FilterStage::kind() const {
+    switch (op) {
+    case StageOp::Warp:     return StageKind::Resample;
+    case StageOp::Pixelate: return StageKind::Resample;
+    case StageOp::SinCity:  return StageKind::Pointwise;
+    case StageOp::BoxBlur:  return StageKind::Neighborhood;
+    }
+    return StageKind::Neighborhood;
+}
+
+std::string FilterStage::name() const {
+    switch (op) {
+    case StageOp::Warp:     return "Warp";
+    case StageOp::Pixelate: return "Pixelate";
+    case StageOp::SinCity:  return "SinCity";
+    case StageOp::BoxBlur:  return "BoxBlur";
+    }
+    return "Unknown";
+}
+
+FilterStage FilterStage::warp(const AffineParams& ap) {
+    FilterStage s; s.op = StageOp::Warp; s.affine = ap; return s;
+}
+FilterStage FilterStage::pixelate(int block) {
+    FilterStage s; s.op = StageOp::Pixelate; s.block = block; return s;
+}
+FilterStage FilterStage::sinCity(cv::Vec3b keepBGR, int thresh) {
+    FilterStage s; s.op = StageOp::SinCity; s.keepBGR = keepBGR; s.thresh = thresh; return s;
+}
+FilterStage FilterStage::boxBlur(int radius) {
+    FilterStage s; s.op = StageOp::BoxBlur; s.radius = radius; return s;
+}
+
+bool operator==(const FilterStage& a, const FilterStage& b) {
+    return a.op == b.op
+        && a.affine.tx == b.affine.tx && a.affine.ty == b.affine.ty
+        && a.affine.scale == b.affine.scale && a.affine.thetaDeg == b.affine.thetaDeg
+        && a.block == b.block && a.keepBGR == b.keepBGR && a.thresh == b.thresh && a.radius == b.radius;
+}
+
+std::shared_ptr<const ColorLut3D> stageLut(const FilterStage& s) {
+    switch (s.op) {
+    case StageOp::SinCity: {
+        FilterParams fp;
+        fp.keepBGR = s.keepBGR;
+        fp.thresh = s.thresh;
+        return pointwiseLut(FilterType::SinCity, fp);
+    }
+    default: CV_Error(cv::Error::StsBadArg, "not a pointwise stage: " + s.name());
+    }
+}
+
+std::string FilterGraph::name() const {
+    if (stages.empty()) return "None";
+    std::string n;
+    for (const auto& s : stages) n += (n.empty() ? "" : ">") + s.name();
+    return n;
+}
+
+std::string chainName(const FilterChain& chain) {
+    if (chain.empty()) return filterName(FilterType::None);
+    std::string n;
+    for (FilterType f : chain) n += (n.empty() ? "" : ">") + filterName(f);
+    return n;
+}
+
+FilterGraph buildFilterGraph(const FilterChain& chain, const FilterParams& fp, const AffineParams& ap) {
+    FilterGraph g;
+    g.then(FilterStage::warp(ap));
+    for (FilterType f : chain) {
+        switch (f) {
+        case FilterType::None:     break;
+        case FilterType::Pixelate: g.then(FilterStage::pixelate(fp.pixelBlock)); break;
+        case FilterType::SinCity:  g.then(FilterStage::sinCity(fp.keepBGR, fp.thresh)); break;
+        }
+    }
+    return g;
+}
+
+std::string FusedPass::signature(const FilterGraph& g) const {
+    if (neighborhood >= 0) return "N:" + g.stages[neighborhood].name();
+    std::string s = "R:";
+    for (int i : resample) s += g.stages[i].name() + ",";
+    s += "|P:";
+    for (int i : pointwise) s += g.stages[i].name() + ",";
+    return s;
+}
+
+std::string FilterPlan::describe(const FilterGraph& g) const {
+    std::string d;
+    for (const auto& p : passes) {
+        std::vector<int> idx = p.resample;
+        if (p.neighborhood >= 0) idx.push_back(p.neighborhood);
+        idx.insert(idx.end(), p.pointwise.begin(), p.pointwise.end());
+        std::sort(idx.begin(), idx.end());
+        d += "[";
+        for (size_t k = 0; k < idx.size(); ++k) d += (k ? "+" : "") + g.stages[idx[k]].name();
+        d += "]";
+    }
+    return d.empty() ? "[]" : d;
+}
+
+static bool isNoOp(const FilterStage& s, int w, int h) {
+    switch (s.op) {
+    case StageOp::Warp:     return isIdentityAffine(affineMatrix(s.affine, w, h));
+    case StageOp::Pixelate: return s.block <= 1;
+    case StageOp::SinCity:  return false;
+    case StageOp::BoxBlur:  return s.radius < 1;
+    }
+    return false;
+}
+
+FilterPlan planFilterGraph(const FilterGraph& g, int width, int height) {
+    FilterPlan plan;
+    FusedPass cur;
+    auto flush = [&] {
+        if (cur.resample.empty() && cur.pointwise.empty()) return;
+        // The mapping is applied from the last resample stage back to the first
+        cur.cellGrid = !cur.resample.empty() && g.stages[cur.resample.back()].op == StageOp::Pixelate;
+        plan.passes.push_back(cur);
+        cur = FusedPass{};
+    };
+
+    for (int i = 0; i < (int)g.stages.size(); ++i) {
+        const FilterStage& s = g.stages[i];
+        if (isNoOp(s, width, height)) continue;
+        switch (s.kind()) {
+        case StageKind::Pointwise: cur.pointwise.push_back(i); break;
+        case StageKind::Resample:
+            if (!cur.pointwise.empty()) flush();
+            cur.resample.push_back(i);
+            break;
+        case StageKind::Neighborhood: {
+            flush();
+            FusedPass n; n.neighborhood = i;
+            plan.passes.push_back(n);
+            break;
+        }
+        }
+    }
+    flush();
+    return plan;
+}
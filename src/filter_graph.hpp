@@ -0,0 +1,84 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+#include "cv_filters.hpp"
+#include "cv_geom.hpp"
+
+// How a stage reads its input, which decides what it can be fused with
+enum class StageKind {
+    Pointwise,      // output pixel = f(input pixel color)                    SinCity
+    Resample,       // output pixel = input sampled at a mapped position       Warp, Pixelate
+    Neighborhood    // output pixel = f(input pixels around it)                BoxBlur
+};
+
+enum class StageOp { Warp, Pixelate, SinCity, BoxBlur };
+
+struct FilterStage {
+    StageOp op = StageOp::Warp;
+    AffineParams affine;                    // Warp
+    int block = 8;                          // Pixelate: block size in output pixels
+    cv::Vec3b keepBGR = { 20, 20, 200 };    // SinCity
+    int thresh = 60;                        // SinCity
+    int radius = 1;                         // BoxBlur: (2 * radius + 1)^2 box, edges replicated
+
+    StageKind kind() const;
+    std::string name() const;
+
+    static FilterStage warp(const AffineParams& ap);
+    static FilterStage pixelate(int block);
+    static FilterStage sinCity(cv::Vec3b keepBGR, int thresh);
+    static FilterStage boxBlur(int radius);
+};
+
+// Same op with the same parameters (all fields compared, so results are identical)
+bool operator==(const FilterStage& a, const FilterStage& b);
+inline bool operator!=(const FilterStage& a, const FilterStage& b) { return !(a == b); }
+
+// Linear chain of stages, applied input first
+struct FilterGraph {
+    std::vector<FilterStage> stages;
+
+    FilterGraph& then(const FilterStage& s) { stages.push_back(s); return *this; }
+    std::string name() const;               // "Warp>SinCity>Pixelate", "None" if empty
+
+    bool operator==(const FilterGraph& o) const { return stages == o.stages; }
+    bool operator!=(const FilterGraph& o) const { return !(*this == o); }
+};
+
+// Cached 3D LUT of a pointwise stage (pointwiseLut): built once per parameter set, sampled by
+// the GPU passes and looked up by the CPU chain kernels
+std::shared_ptr<const ColorLut3D> stageLut(const FilterStage& s);
+
+// Filter selection of the UI and the benchmark: filters in order, after the optional warp
+using FilterChain = std::vector<FilterType>;
+std::string chainName(const FilterChain& chain);   // "SinCity>Pixelate"; a single filter keeps filterName()
+FilterGraph buildFilterGraph(const FilterChain& chain, const FilterParams& fp, const AffineParams& ap);
+
+// One pass over the frame. The resample stages compose into a single output -> input mapping
+// that is sampled once (bilinear), then the pointwise stages run on that sample in graph order.
+// Like concatenated warp / color kernels in other GPU image graphs, this skips the rounding and
+// re-interpolation of intermediate frames. All resample stages of a pass precede its pointwise
+// stages in the graph: a nonlinear color stage does not commute with interpolation.
+struct FusedPass {
+    int neighborhood = -1;                  // stage that runs alone on the materialized input, or -1
+    std::vector<int> resample;              // stage indices, graph order
+    std::vector<int> pointwise;             // stage indices, graph order
+    bool cellGrid = false;                  // first mapping from the output is a pixelate snap:
+                                            // the pass is constant per cell, evaluate once per cell
+
+    // Structure only (ops, not parameters): passes with the same signature share a GPU program
+    std::string signature(const FilterGraph& g) const;
+};
+
+struct FilterPlan {
+    std::vector<FusedPass> passes;          // empty: output = input
+
+    std::string describe(const FilterGraph& g) const;   // "[Warp+SinCity+Pixelate]", "[]" if empty
+};
+
+// Drop no-op stages (identity warp, block <= 1, radius < 1), then fuse every run of resample
+// stages followed by pointwise stages into one pass. A resample stage after a pointwise stage
+// starts a new pass (it interpolates the pointwise output); each neighborhood stage is a pass
+// of its own.
+FilterPlan planFilterGraph(const FilterGraph& g, int width, int height);
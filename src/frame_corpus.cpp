@@ -0,0 +1,120 @@
+#include "frame_corpus.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+const char* corpusContentName(CorpusContent c) {
+    return c == CorpusContent::Scene ? "scene" : "noise";
+}
+
+void generateSyntheticFrame(cv::Mat& img, int w, int h, unsigned seedTick) {
+    img.create(h, w, CV_8UC3);
+    cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(255));
+    // Add a simple shape/gradient overlay to prevent overly ideal randomness that helps GPU caching too much
+    int cx = (seedTick * 37) % w;
+    int cy = (seedTick * 53) % h;
+    cv::circle(img, { cx, cy }, std::max(8, std::min(w, h) / 12), cv::Scalar(20, 20, 220), -1);
+    cv::putText(img, std::to_string(seedTick % 10000), { 10, 30 }, cv::FONT_HERSHEY_SIMPLEX, 0.8, { 240,240,240 }, 2);
+}
+
+// Same picture as generateSyntheticFrame, with the noise drawn from a seeded generator
+static void drawNoiseFrame(cv::Mat& img, int w, int h, cv::RNG& rng, unsigned tick) {
+    rng.fill(img, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(255));
+    int cx = (tick * 37) % w;
+    int cy = (tick * 53) % h;
+    cv::circle(img, { cx, cy }, std::max(8, std::min(w, h) / 12), cv::Scalar(20, 20, 220), -1);
+    cv::putText(img, std::to_string(tick % 10000), { 10, 30 }, cv::FONT_HERSHEY_SIMPLEX, 0.8, { 240,240,240 }, 2);
+}
+
+static void fillGradient(cv::Mat& img, int y0, int y1, const cv::Scalar& a, const cv::Scalar& b) {
+    for (int y = y0; y < y1; ++y) {
+        const double t = y1 - y0 > 1 ? (double)(y - y0) / (y1 - y0 - 1) : 0.0;
+        img.row(y).setTo(a * (1.0 - t) + b * t);
+    }
+}
+
+static cv::Scalar randomColor(cv::RNG& rng, int lo, int hi) {
+    return cv::Scalar(rng.uniform(lo, hi), rng.uniform(lo, hi), rng.uniform(lo, hi));
+}
+
+// Large flat and smoothly shaded areas with hard edges, closer to camera footage than noise:
+// the layout depends on the seed only, the shapes drift a few pixels per frame index
+static void drawSceneFrame(cv::Mat& img, int w, int h, unsigned seed, unsigned index) {
+    cv::RNG layout(0x5CE7E000ull ^ ((uint64_t)seed << 20));
+    const int horizon = h * layout.uniform(40, 65) / 100;
+    fillGradient(img, 0, horizon, randomColor(layout, 150, 250), randomColor(layout, 90, 180));
+    fillGradient(img, horizon, h, randomColor(layout, 40, 110), randomColor(layout, 10, 60));
+
+    const int unit = std::max(4, std::min(w, h) / 16);
+    const int shapes = 6 + layout.uniform(0, 5);
+    for (int i = 0; i < shapes; ++i) {
+        const int size = unit * layout.uniform(1, 4);
+        const int x0 = layout.uniform(0, w), y0 = layout.uniform(0, h);
+        const int vx = layout.uniform(-6, 7), vy = layout.uniform(-2, 3);
+        // Every third shape red, so the SinCity color key has something to keep
+        const cv::Scalar color = i % 3 == 0 ? cv::Scalar(layout.uniform(10, 40), layout.uniform(10, 40), layout.uniform(180, 240))
+                                            : randomColor(layout, 0, 256);
+        const int x = ((x0 + vx * (int)index) % (w + size) + (w + size)) % (w + size) - size / 2;
+        const int y = ((y0 + vy * (int)index) % (h + size) + (h + size)) % (h + size) - size / 2;
+        if (layout.uniform(0, 2)) cv::circle(img, { x, y }, size / 2, color, -1, cv::LINE_AA);
+        else cv::rectangle(img, cv::Rect(x - size / 2, y - size / 3, size, size * 2 / 3), color, -1);
+    }
+    cv::putText(img, std::to_string(index), { 10, 30 }, cv::FONT_HERSHEY_SIMPLEX, 0.8, { 240,240,240 }, 2);
+
+    // Sensor noise of +-6 levels
+    cv::RNG grain(((uint64_t)seed << 32) | index);
+    cv::Mat noise(h, w, CV_8UC3);
+    grain.fill(noise, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(13));
+    cv::add(img, noise, img);
+    cv::subtract(img, cv::Scalar::all(6), img);
+}
+
+void generateCorpusFrame(cv::Mat& img, int w, int h, CorpusContent content, unsigned seed, unsigned index) {
+    img.create(h, w, CV_8UC3);
+    if (content == CorpusContent::Scene) {
+        drawSceneFrame(img, w, h, seed, index);
+    }
+    else {
+        cv::RNG rng(((uint64_t)seed << 32) | index);
+        drawNoiseFrame(img, w, h, rng, index + 1);
+    }
+}
+
+int FrameCorpus::generate(const CorpusConfig& cfg, int w, int h) {
+    const size_t frameBytes = (size_t)w * h * 3;
+    const int n = (int)std::max<size_t>(1, std::min<size_t>((size_t)std::max(cfg.frames, 1), cfg.maxBytes / frameBytes));
+    if (size() == n && frameSize() == cv::Size(w, h) && cfg_.seed == cfg.seed && cfg_.content == cfg.content) {
+        cursor_ = 0;
+        return n;
+    }
+
+    const auto t0 = std::chrono::steady_clock::now();
+    cfg_ = cfg;
+    frames_.assign(n, cv::Mat());
+    for (int i = 0; i < n; ++i) generateCorpusFrame(frames_[i], w, h, cfg.content, cfg.seed, (unsigned)i);
+    cursor_ = 0;
+    genMs_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    return n;
+}
+
+void FrameCorpus::clear() {
+    frames_.clear();
+    cursor_ = 0;
+    genMs_ = 0.0;
+}
+
+const cv::Mat& FrameCorpus::next() {
+    const cv::Mat& f = frames_[cursor_];
+    if (++cursor_ == frames_.size()) cursor_ = 0;
+    return f;
+}
+
+std::string FrameCorpus::summary() const {
+    if (frames_.empty()) return "empty";
+    const cv::Size s = frameSize();
+    const size_t bytes = (size_t)s.area() * 3 * frames_.size();
+    return std::to_string(frames_.size()) + " x " + std::to_string(s.width) + "x" + std::to_string(s.height)
+        + " " + corpusContentName(cfg_.content) + " frames (" + std::to_string(bytes >> 20) + " MiB, seed "
+        + std::to_string(cfg_.seed) + ") in " + std::to_string((int)std::round(genMs_)) + " ms";
+}
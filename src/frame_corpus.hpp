@@ -0,0 +1,59 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+enum class CorpusContent {
+    Noise,      // uniform noise with a moving disc and a frame counter (the old live generator)
+    Scene       // smooth sky / ground gradients, drifting solid shapes and mild sensor noise
+};
+
+struct CorpusConfig {
+    int      frames = 8;                // ring length; frames are cycled in order
+    unsigned seed = 1;                  // same seed, size and content -> identical frames
+    CorpusContent content = CorpusContent::Noise;
+    size_t   maxBytes = size_t(1) << 30;    // fewer frames are generated if the ring would exceed this
+};
+
+const char* corpusContentName(CorpusContent c);
+
+// Fill img with a random w x h BGR 8UC3 image; each frame varies slightly to avoid cache
+// optimization. img is reused when it already has the right size. Draws from cv::theRNG(),
+// so it is not reproducible across runs.
+void generateSyntheticFrame(cv::Mat& img, int w, int h, unsigned seedTick);
+
+// Deterministic BGR 8UC3 frame number index of a corpus
+void generateCorpusFrame(cv::Mat& img, int w, int h, CorpusContent content, unsigned seed, unsigned index);
+
+// Ring of frames generated up front, so a benchmark loop gets its input for the cost of a
+// pointer instead of running the generator inside the timed region. The frames are immutable
+// once generated: next() hands out const references and callers process into their own output.
+// Cycling few small frames keeps them in cache; pick frames * frame size above the last-level
+// cache to see the memory traffic of a live source.
+class FrameCorpus {
+public:
+    // Generate the ring for w x h (if it already holds exactly that, only rewind to the first
+    // frame); returns the number of frames, which is below cfg.frames when maxBytes caps it
+    int generate(const CorpusConfig& cfg, int w, int h);
+    void clear();
+
+    const cv::Mat& next();              // frames in order, wrapping around
+    void rewind() { cursor_ = 0; }      // next() starts over at the first frame
+    int size() const { return (int)frames_.size(); }
+    bool empty() const { return frames_.empty(); }
+    cv::Size frameSize() const { return frames_.empty() ? cv::Size() : frames_[0].size(); }
+
+    // Wall time of the last generate() that produced frames, total and per frame
+    double generateMs() const { return genMs_; }
+    double generateMsPerFrame() const { return frames_.empty() ? 0.0 : genMs_ / frames_.size(); }
+
+    // "8 x 1920x1080 scene frames (47 MiB, seed 1) in 182 ms"
+    std::string summary() const;
+
+private:
+    CorpusConfig cfg_;
+    std::vector<cv::Mat> frames_;
+    size_t cursor_ = 0;
+    double genMs_ = 0.0;
+};
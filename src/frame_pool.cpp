@@ -0,0 +1,175 @@
+#include "frame_pool.hpp"
+#include <new>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+static constexpr size_t kAlign = 64;
+static constexpr size_t kPage = 4 << 10;
+static constexpr size_t kHugePage = 2 << 20;
+
+static size_t roundUp(size_t v, size_t a) { return (v + a - 1) / a * a; }
+
+FramePool::FramePool(const FramePoolConfig& cfg) : cfg_(cfg) {}
+
+FramePool::~FramePool() { trim(); }
+
+// 0 = not pooled; otherwise the rounded byte size the block is allocated and keyed with
+size_t FramePool::sizeClass(size_t bytes) const {
+    if (bytes < cfg_.minPooledBytes) return 0;
+#if defined(__linux__)
+    if (cfg_.hugePages && bytes >= kHugePage) return roundUp(bytes, kHugePage);
+#endif
+    return roundUp(bytes, kPage);
+}
+
+uchar* FramePool::mapNew(size_t cls) const {
+#if defined(__linux__)
+    if (cfg_.hugePages && cls % kHugePage == 0) {
+        // Explicit huge pages first (needs vm.nr_hugepages), then THP on a normal mapping
+        void* p = mmap(nullptr, cls, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+        if (p != MAP_FAILED) {
+            std::lock_guard<std::mutex> lk(m_);
+            hugetlb_[(uchar*)p] = true;
+            hugeBytes_ += cls;
+            return (uchar*)p;
+        }
+        p = mmap(nullptr, cls, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+        madvise(p, cls, MADV_HUGEPAGE);
+#endif
+        std::lock_guard<std::mutex> lk(m_);
+        hugetlb_[(uchar*)p] = false;
+        return (uchar*)p;
+    }
+#endif
+    return (uchar*)::operator new(cls, std::align_val_t(kAlign));
+}
+
+void FramePool::unmap(uchar* p, size_t cls) const {
+#if defined(__linux__)
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        auto it = hugetlb_.find(p);
+        if (it != hugetlb_.end()) {
+            if (it->second) hugeBytes_ -= cls;
+            hugetlb_.erase(it);
+            munmap(p, cls);
+            return;
+        }
+    }
+#endif
+    ::operator delete(p, std::align_val_t(kAlign));
+}
+
+uchar* FramePool::acquire(size_t bytes) const {
+    const size_t cls = sizeClass(bytes);
+    if (cls == 0) return (uchar*)cv::fastMalloc(bytes);
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        auto it = free_.find(cls);
+        if (it != free_.end() && !it->second.empty()) {
+            uchar* p = it->second.back();
+            it->second.pop_back();
+            cachedBytes_ -= cls;
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return p;
+        }
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return mapNew(cls);
+}
+
+void FramePool::recycle(uchar* p, size_t bytes) const {
+    const size_t cls = sizeClass(bytes);
+    if (cls == 0) { cv::fastFree(p); return; }
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        auto& list = free_[cls];
+        if ((int)list.size() < cfg_.maxCachedPerSize) {
+            list.push_back(p);
+            cachedBytes_ += cls;
+            return;
+        }
+    }
+    unmap(p, cls);
+}
+
+// Same bookkeeping as OpenCV's StdMatAllocator, with the buffer taken from the pool
+cv::UMatData* FramePool::allocate(int dims, const int* sizes, int type, void* data0, size_t* step,
+    cv::AccessFlag /*flags*/, cv::UMatUsageFlags /*usageFlags*/) const
+{
+    size_t total = CV_ELEM_SIZE(type);
+    for (int i = dims - 1; i >= 0; i--) {
+        if (step) {
+            if (data0 && step[i] != CV_AUTOSTEP) {
+                CV_Assert(total <= step[i]);
+                total = step[i];
+            }
+            else
+                step[i] = total;
+        }
+        total *= sizes[i];
+    }
+
+    uchar* data = data0 ? (uchar*)data0 : acquire(total);
+    cv::UMatData* u = new cv::UMatData(this);
+    u->data = u->origdata = data;
+    u->size = total;
+    if (data0) u->flags |= cv::UMatData::USER_ALLOCATED;
+    return u;
+}
+
+bool FramePool::allocate(cv::UMatData* u, cv::AccessFlag, cv::UMatUsageFlags) const {
+    return u != nullptr;
+}
+
+void FramePool::deallocate(cv::UMatData* u) const {
+    if (!u) return;
+    CV_Assert(u->urefcount == 0 && u->refcount == 0);
+    if (!(u->flags & cv::UMatData::USER_ALLOCATED)) {
+        recycle(u->origdata, u->size);
+        u->origdata = nullptr;
+    }
+    delete u;
+}
+
+FramePoolStats FramePool::stats() const {
+    FramePoolStats s;
+    s.hits = hits_.load(std::memory_order_relaxed);
+    s.misses = misses_.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lk(m_);
+    s.cachedBytes = cachedBytes_;
+    s.hugeBytes = hugeBytes_;
+    return s;
+}
+
+void FramePool::trim() {
+    std::unordered_map<size_t, std::vector<uchar*>> drop;
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        drop.swap(free_);
+        cachedBytes_ = 0;
+    }
+    for (auto& kv : drop)
+        for (uchar* p : kv.second) unmap(p, kv.first);
+}
+
+// -------------------- Process-wide pool --------------------
+
+static std::atomic<FramePool*> g_framePool{ nullptr };
+
+FramePool& installFramePool(const FramePoolConfig& cfg) {
+    static std::mutex installMutex;
+    std::lock_guard<std::mutex> lk(installMutex);
+    if (FramePool* p = g_framePool.load()) return *p;
+    FramePool* p = new FramePool(cfg);          // intentionally leaked, see header
+    cv::Mat::setDefaultAllocator(p);
+    g_framePool.store(p);
+    return *p;
+}
+
+FramePool* framePool() { return g_framePool.load(); }
@@ -0,0 +1,63 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+struct FramePoolConfig {
+    bool   hugePages = true;            // back buffers >= 2 MiB with huge pages (Linux)
+    size_t minPooledBytes = 64 << 10;   // smaller buffers use the normal heap
+    int    maxCachedPerSize = 8;        // free buffers kept per size class
+};
+
+struct FramePoolStats {
+    uint64_t hits = 0, misses = 0;      // pooled allocations served from / not from the free lists
+    size_t cachedBytes = 0;             // bytes sitting in the free lists
+    size_t hugeBytes = 0;               // bytes currently mapped with MAP_HUGETLB
+};
+
+// cv::MatAllocator that recycles frame-sized buffers. Freed buffers go to a free list keyed
+// by their rounded byte size, so the per-frame Mats of a steady stream (capture, warp output,
+// RGB staging, ...) keep reusing the same memory instead of hitting malloc and page-faulting
+// fresh pages every frame. Buffers are 64-byte aligned; buffers of 2 MiB and more are mmap'ed,
+// with MAP_HUGETLB if available and transparent huge pages (MADV_HUGEPAGE) otherwise.
+class FramePool : public cv::MatAllocator {
+public:
+    explicit FramePool(const FramePoolConfig& cfg = {});
+    ~FramePool() override;
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+        cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override;
+    bool allocate(cv::UMatData* u, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const override;
+    void deallocate(cv::UMatData* u) const override;
+
+    FramePoolStats stats() const;
+    const FramePoolConfig& config() const { return cfg_; }
+    void trim();                        // release every cached buffer
+
+private:
+    size_t sizeClass(size_t bytes) const;
+    uchar* acquire(size_t bytes) const;
+    void recycle(uchar* p, size_t bytes) const;
+    uchar* mapNew(size_t cls) const;
+    void unmap(uchar* p, size_t cls) const;
+
+    FramePoolConfig cfg_;
+    mutable std::mutex m_;
+    mutable std::unordered_map<size_t, std::vector<uchar*>> free_;
+    mutable std::unordered_map<uchar*, bool> hugetlb_;   // mmap'ed blocks -> MAP_HUGETLB?
+    mutable size_t cachedBytes_ = 0, hugeBytes_ = 0;
+    mutable std::atomic<uint64_t> hits_{ 0 }, misses_{ 0 };
+};
+
+// Make the pool OpenCV's default allocator, so every cv::Mat created afterwards (camera
+// frames, kernel outputs, cvtColor results) is recycled. Call once at startup, before any
+// frame is allocated; later calls return the pool installed first. The pool is never freed,
+// since Mats allocated from it may outlive main().
+FramePool& installFramePool(const FramePoolConfig& cfg = {});
+
+// Installed pool, or nullptr if installFramePool() was never called
+FramePool* framePool();
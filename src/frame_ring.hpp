@@ -0,0 +1,88 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// Bounded single-producer / single-consumer lock-free ring used to hand frames between the
+// capture, processing and render threads. Exactly one thread may call the producer side
+// (tryPush / pushOrDrop) and exactly one the consumer side (tryPop / popLatest).
+template<typename T, size_t N>
+class SpscRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing capacity must be a power of two");
+public:
+    // Producer: false if the ring is full (v is left untouched)
+    bool tryPush(T&& v) {
+        const size_t h = head_.load(std::memory_order_relaxed);
+        if (h - tailCache_ == N) {
+            tailCache_ = tail_.load(std::memory_order_acquire);
+            if (h - tailCache_ == N) return false;
+        }
+        slots_[h & (N - 1)] = std::move(v);
+        head_.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer: push, or drop v if the consumer is N items behind
+    bool pushOrDrop(T&& v) {
+        if (tryPush(std::move(v))) return true;
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Consumer: oldest item, false if empty
+    bool tryPop(T& out) {
+        const size_t t = tail_.load(std::memory_order_relaxed);
+        if (t == headCache_) {
+            headCache_ = head_.load(std::memory_order_acquire);
+            if (t == headCache_) return false;
+        }
+        T& slot = slots_[t & (N - 1)];
+        out = std::move(slot);
+        slot = T();                       // do not keep frame buffers alive inside the ring
+        tail_.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: newest item; older queued items are discarded ("latest frame wins")
+    bool popLatest(T& out) {
+        if (!tryPop(out)) return false;
+        uint64_t skipped = 0;
+        while (tryPop(out)) ++skipped;
+        if (skipped) dropped_.fetch_add(skipped, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Items dropped by either side so far
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    alignas(64) std::atomic<size_t> head_{ 0 };   // written by the producer
+    size_t tailCache_ = 0;                        // producer's view of tail_
+    alignas(64) std::atomic<size_t> tail_{ 0 };   // written by the consumer
+    size_t headCache_ = 0;                        // consumer's view of head_
+    alignas(64) std::atomic<uint64_t> dropped_{ 0 };
+    std::array<T, N> slots_;
+};
+
+// Latest-value cell for parameters written by the UI thread and read by the workers.
+// Every store publishes a new immutable copy, so a reader always sees one consistent set
+// and can keep using it for the whole frame.
+template<typename T>
+class AtomicSnapshot {
+public:
+    explicit AtomicSnapshot(T init = T{}) : p_(std::make_shared<const T>(std::move(init))) {}
+
+    void store(T v) {
+        std::shared_ptr<const T> p = std::make_shared<const T>(std::move(v));
+        std::atomic_store_explicit(&p_, std::move(p), std::memory_order_release);
+    }
+    std::shared_ptr<const T> load() const {
+        return std::atomic_load_explicit(&p_, std::memory_order_acquire);
+    }
+
+private:
+    std::shared_ptr<const T> p_;
+};
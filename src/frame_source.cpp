@@ -0,0 +1,521 @@
+#include "frame_source.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+static double msSince(Clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+static std::string lower(std::string s) {
+    for (char& c : s) c = (char)std::tolower((unsigned char)c);
+    return s;
+}
+
+static bool endsWith(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static bool parseInt(const std::string& s, int& out) {
+    char* end = nullptr;
+    long v = std::strtol(s.c_str(), &end, 10);
+    if (s.empty() || *end) return false;
+    out = (int)v;
+    return true;
+}
+
+static bool parseSize(const std::string& s, int& w, int& h) {
+    const size_t x = lower(s).find('x');
+    if (x == std::string::npos || !parseInt(s.substr(0, x), w) || !parseInt(s.substr(x + 1), h)) return false;
+    return w > 0 && h > 0;
+}
+
+static std::string sizeText(cv::Size s) {
+    return std::to_string(s.width) + "x" + std::to_string(s.height);
+}
+
+const char* frameFormatName(FrameFormat f) {
+    switch (f) {
+    case FrameFormat::I420: return "i420";
+    case FrameFormat::NV12: return "nv12";
+    case FrameFormat::YUYV: return "yuyv";
+    case FrameFormat::Gray: return "gray";
+    default:                return "bgr";
+    }
+}
+
+cv::Size framePixelSize(const cv::Mat& frame, FrameFormat f) {
+    const bool planar = f == FrameFormat::I420 || f == FrameFormat::NV12;
+    return planar ? cv::Size(frame.cols, frame.rows * 2 / 3) : frame.size();
+}
+
+// Capture backends deliver BGRA, gray or YUYV depending on the device: make every frame a
+// continuous BGR8 image
+static void ensureBGR(cv::Mat& img) {
+    if (img.empty()) return;
+    if (img.type() == CV_8UC3) {
+        if (!img.isContinuous()) img = img.clone();
+        return;
+    }
+    cv::Mat out;
+    if (img.type() == CV_8UC4)      cv::cvtColor(img, out, cv::COLOR_BGRA2BGR);
+    else if (img.type() == CV_8UC1) cv::cvtColor(img, out, cv::COLOR_GRAY2BGR);
+    else if (img.type() == CV_8UC2) {
+        try { cv::cvtColor(img, out, cv::COLOR_YUV2BGR_YUY2); }
+        catch (...) { cv::cvtColor(img, out, cv::COLOR_GRAY2BGR); }
+    }
+    else                           img.convertTo(out, CV_8UC3);
+    if (!out.isContinuous()) out = out.clone();
+    img = out;
+}
+
+void frameToBGR(const cv::Mat& frame, FrameFormat f, cv::Mat& bgr) {
+    switch (f) {
+    case FrameFormat::BGR:  bgr = frame; break;
+    case FrameFormat::I420: cv::cvtColor(frame, bgr, cv::COLOR_YUV2BGR_I420); break;
+    case FrameFormat::NV12: cv::cvtColor(frame, bgr, cv::COLOR_YUV2BGR_NV12); break;
+    case FrameFormat::YUYV: cv::cvtColor(frame, bgr, cv::COLOR_YUV2BGR_YUYV); break;
+    case FrameFormat::Gray: cv::cvtColor(frame, bgr, cv::COLOR_GRAY2BGR); break;
+    }
+}
+
+bool FrameSource::readBGR(cv::Mat& bgr) {
+    if (format() == FrameFormat::BGR) return read(bgr);
+    if (!read(native_)) return false;
+    frameToBGR(native_, format(), bgr);
+    return true;
+}
+
+// -------------------- Camera / video file (cv::VideoCapture) --------------------
+
+class CaptureSource : public FrameSource {
+public:
+    bool open(const SourceConfig& cfg, std::string& err) {
+        const auto t0 = Clock::now();
+        cfg_ = cfg;
+        if (cfg.kind == SourceKind::Camera) {
+#if defined(_WIN32)
+            const int api = cv::CAP_DSHOW;     // DSHOW + MJPG is more stable on Windows
+#elif defined(__linux__)
+            const int api = cv::CAP_V4L2;
+#else
+            const int api = cv::CAP_ANY;
+#endif
+            if (cfg.path.empty()) cap_.open(cfg.device, api);
+            else cap_.open(cfg.path, api);
+            if (!cap_.isOpened()) { err = "cannot open camera " + deviceName(); return false; }
+            if (cfg.yuv) format_ = requestRawYuv();
+            if (format_ == FrameFormat::BGR) cap_.set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'));
+            if (cfg.width > 0 && cfg.height > 0) {
+                cap_.set(cv::CAP_PROP_FRAME_WIDTH, cfg.width);
+                cap_.set(cv::CAP_PROP_FRAME_HEIGHT, cfg.height);
+            }
+        }
+        else {
+            cap_.open(cfg.path);
+            if (!cap_.isOpened()) { err = "cannot open video " + cfg.path; return false; }
+            fps_ = std::max(0.0, cap_.get(cv::CAP_PROP_FPS));
+            frames_ = std::max(0, (int)cap_.get(cv::CAP_PROP_FRAME_COUNT));
+        }
+        // The size is that of the first frame: drivers may not honour the requested one
+        if (!cap_.read(first_) || first_.empty()) { err = "no frame from " + deviceName(); return false; }
+        if (format_ != FrameFormat::BGR && !rawLayoutOk(first_)) {
+            // The driver took the mode but hands over something else: decode as usual
+            format_ = FrameFormat::BGR;
+            cap_.set(cv::CAP_PROP_CONVERT_RGB, 1);
+            if (!cap_.read(first_) || first_.empty()) { err = "no frame from " + deviceName(); return false; }
+        }
+        if (format_ == FrameFormat::BGR) ensureBGR(first_);
+        else if (!first_.isContinuous()) first_ = first_.clone();
+        size_ = framePixelSize(first_, format_);
+        setupMs_ = msSince(t0);
+        return true;
+    }
+
+    bool read(cv::Mat& frame) override {
+        if (!first_.empty()) { frame = first_; first_.release(); return true; }
+        if (!cap_.read(frame) || frame.empty()) {
+            if (cfg_.kind != SourceKind::Video || !cfg_.loop) return false;
+            cap_.set(cv::CAP_PROP_POS_FRAMES, 0);
+            if (!cap_.read(frame) || frame.empty()) return false;
+        }
+        if (format_ == FrameFormat::BGR) ensureBGR(frame);
+        else if (!frame.isContinuous()) frame = frame.clone();
+        return true;
+    }
+
+    void rewind() override {
+        if (cfg_.kind != SourceKind::Video) return;
+        first_.release();
+        cap_.set(cv::CAP_PROP_POS_FRAMES, 0);
+    }
+
+    FrameFormat format() const override { return format_; }
+    cv::Size size() const override { return size_; }
+    double fps() const override { return cfg_.kind == SourceKind::Video ? fps_ : 0.0; }
+    int frameCount() const override { return frames_; }
+    double setupMs() const override { return setupMs_; }
+    const char* name() const override { return cfg_.kind == SourceKind::Camera ? "camera" : "video"; }
+
+    std::string describe() const override {
+        std::ostringstream s;
+        s << name() << " " << deviceName() << " " << sizeText(size_);
+        if (cfg_.kind == SourceKind::Camera) s << " " << frameFormatName(format_) << " (" << cap_.getBackendName() << ")";
+        else s << " @ " << fps_ << " fps, " << frames_ << " frames";
+        return s.str();
+    }
+
+private:
+    std::string deviceName() const {
+        return cfg_.kind == SourceKind::Camera && cfg_.path.empty() ? std::to_string(cfg_.device) : cfg_.path;
+    }
+
+    // --yuv: ask V4L2 for an uncompressed YUYV (else NV12) mode and for its buffers without the
+    // RGB conversion; the backend then returns YUYV as CV_8UC2 and NV12 as CV_8UC1 with
+    // h * 3/2 rows. BGR (MJPG, decoded) if the driver offers neither.
+    FrameFormat requestRawYuv() {
+#if defined(__linux__)
+        const std::pair<int, FrameFormat> modes[] = {
+            { cv::VideoWriter::fourcc('Y', 'U', 'Y', 'V'), FrameFormat::YUYV },
+            { cv::VideoWriter::fourcc('N', 'V', '1', '2'), FrameFormat::NV12 }
+        };
+        for (const auto& m : modes) {
+            if (!cap_.set(cv::CAP_PROP_FOURCC, m.first) || (int)cap_.get(cv::CAP_PROP_FOURCC) != m.first) continue;
+            if (!cap_.set(cv::CAP_PROP_CONVERT_RGB, 0)) break;
+            return m.second;
+        }
+#endif
+        return FrameFormat::BGR;
+    }
+
+    bool rawLayoutOk(const cv::Mat& f) const {
+        if (format_ == FrameFormat::YUYV) return f.type() == CV_8UC2 && f.cols % 2 == 0;
+        return f.type() == CV_8UC1 && f.rows % 3 == 0 && f.cols % 2 == 0 && (f.rows * 2 / 3) % 2 == 0;
+    }
+
+    SourceConfig cfg_;
+    cv::VideoCapture cap_;
+    cv::Mat first_;                     // read by open() for the size, returned by the first read()
+    FrameFormat format_ = FrameFormat::BGR;     // YUYV / NV12: camera with cfg.yuv
+    cv::Size size_;
+    double fps_ = 0.0, setupMs_ = 0.0;
+    int frames_ = 0;
+};
+
+// -------------------- Synthetic --------------------
+
+class SyntheticSource : public FrameSource {
+public:
+    bool open(const SourceConfig& cfg, std::string& err) {
+        if (cfg.width <= 0 || cfg.height <= 0) { err = "synthetic source needs a frame size"; return false; }
+        cfg_ = cfg;
+        if (!cfg.live) corpus_.generate(cfg.corpus, cfg.width, cfg.height);
+        return true;
+    }
+
+    bool read(cv::Mat& frame) override {
+        if (cfg_.live) generateSyntheticFrame(frame, cfg_.width, cfg_.height, ++tick_);
+        else frame = corpus_.next();
+        return true;
+    }
+
+    void rewind() override { corpus_.rewind(); }
+
+    cv::Size size() const override { return cv::Size(cfg_.width, cfg_.height); }
+    int frameCount() const override { return corpus_.size(); }
+    double setupMs() const override { return corpus_.generateMs(); }
+    const char* name() const override { return cfg_.live ? "live" : corpusContentName(cfg_.corpus.content); }
+
+    std::string describe() const override {
+        if (cfg_.live) return "synthetic " + sizeText(size()) + ", generated per frame";
+        return "synthetic " + corpus_.summary();
+    }
+
+private:
+    SourceConfig cfg_;
+    FrameCorpus corpus_;
+    unsigned tick_ = 0;
+};
+
+// -------------------- Memory-mapped files --------------------
+
+// Whole file mapped copy-on-write (MAP_PRIVATE / FILE_MAP_COPY): frames are headers into the
+// page cache, and a stray write into one changes a private page instead of faulting or
+// touching the file
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    bool open(const std::string& path, std::string& err) {
+        close();
+#if defined(_WIN32)
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) { err = "cannot open " + path; return false; }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file_, &size) || size.QuadPart == 0) { err = path + " is empty"; close(); return false; }
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+        void* p = mapping_ ? MapViewOfFile(mapping_, FILE_MAP_COPY, 0, 0, 0) : nullptr;
+        if (!p) { err = "cannot map " + path; close(); return false; }
+        data_ = (uchar*)p;
+        size_ = (size_t)size.QuadPart;
+#else
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) { err = "cannot open " + path; return false; }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) { err = path + " is empty"; ::close(fd); return false; }
+        void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) { err = "cannot map " + path; return false; }
+#ifdef MADV_SEQUENTIAL
+        madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);   // replay reads front to back: read ahead
+#endif
+        data_ = (uchar*)p;
+        size_ = (size_t)st.st_size;
+#endif
+        return true;
+    }
+
+    void close() {
+#if defined(_WIN32)
+        if (data_) UnmapViewOfFile(data_);
+        if (mapping_) CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+        mapping_ = nullptr;
+        file_ = INVALID_HANDLE_VALUE;
+#else
+        if (data_) munmap(data_, size_);
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    uchar* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    uchar* data_ = nullptr;
+    size_t size_ = 0;
+#if defined(_WIN32)
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#endif
+};
+
+// Raw BGR and Y4M: an index of frame offsets into the mapping; read() wraps the next one in
+// a cv::Mat header, so replay costs no decode and no copy
+class MappedSource : public FrameSource {
+public:
+    bool open(const SourceConfig& cfg, std::string& err) {
+        const auto t0 = Clock::now();
+        cfg_ = cfg;
+        if (!file_.open(cfg.path, err)) return false;
+        const bool ok = cfg.kind == SourceKind::Y4m ? indexY4m(err) : indexRaw(err);
+        if (!ok) { file_.close(); return false; }
+        setupMs_ = msSince(t0);
+        return true;
+    }
+
+    bool read(cv::Mat& frame) override {
+        if (cursor_ == offsets_.size()) {
+            if (!cfg_.loop) return false;
+            cursor_ = 0;
+        }
+        frame = cv::Mat(rows_, size_.width, format_ == FrameFormat::BGR ? CV_8UC3 : CV_8UC1,
+            file_.data() + offsets_[cursor_++]);
+        return true;
+    }
+
+    void rewind() override { cursor_ = 0; }
+
+    FrameFormat format() const override { return format_; }
+    cv::Size size() const override { return size_; }
+    double fps() const override { return fps_; }
+    int frameCount() const override { return (int)offsets_.size(); }
+    double setupMs() const override { return setupMs_; }
+    const char* name() const override { return cfg_.kind == SourceKind::Y4m ? "y4m" : "raw"; }
+
+    std::string describe() const override {
+        std::ostringstream s;
+        s << name() << " " << cfg_.path << " " << sizeText(size_) << " " << frameFormatName(format_);
+        if (fps_ > 0.0) s << " @ " << fps_ << " fps";
+        s << ", " << offsets_.size() << " frames (mapped " << (file_.size() >> 20) << " MiB)";
+        return s.str();
+    }
+
+private:
+    bool indexRaw(std::string& err) {
+        if (cfg_.width <= 0 || cfg_.height <= 0) { err = "raw BGR input needs its frame size (" + cfg_.path + ":WxH)"; return false; }
+        size_ = cv::Size(cfg_.width, cfg_.height);
+        rows_ = size_.height;
+        format_ = FrameFormat::BGR;
+        const size_t frameBytes = (size_t)size_.area() * 3;
+        for (size_t off = 0; off + frameBytes <= file_.size(); off += frameBytes) offsets_.push_back(off);
+        if (offsets_.empty()) { err = cfg_.path + " is smaller than one " + sizeText(size_) + " BGR frame"; return false; }
+        return true;
+    }
+
+    // YUV4MPEG2 stream header "YUV4MPEG2 W1920 H1080 F30000:1001 Ip A1:1 C420jpeg", then
+    // frames of "FRAME[ params]\n" followed by the planes
+    bool indexY4m(std::string& err) {
+        const char* p = (const char*)file_.data();
+        const size_t n = file_.size();
+        const char* eol = (const char*)std::memchr(p, '\n', std::min<size_t>(n, 4096));
+        const std::string header = eol ? std::string(p, eol) : std::string();
+        if (header.compare(0, 10, "YUV4MPEG2 ") != 0) { err = cfg_.path + " is not a YUV4MPEG2 file"; return false; }
+
+        std::istringstream tokens(header.substr(10));
+        std::string t, colorspace = "420jpeg";
+        int w = 0, h = 0;
+        while (tokens >> t) {
+            if (t[0] == 'W') parseInt(t.substr(1), w);
+            else if (t[0] == 'H') parseInt(t.substr(1), h);
+            else if (t[0] == 'C') colorspace = t.substr(1);
+            else if (t[0] == 'F') {
+                int num = 0, den = 0;
+                const size_t colon = t.find(':');
+                if (colon != std::string::npos && parseInt(t.substr(1, colon - 1), num)
+                    && parseInt(t.substr(colon + 1), den) && den > 0)
+                    fps_ = (double)num / den;
+            }
+        }
+        if (w <= 0 || h <= 0) { err = cfg_.path + ": no frame size in the Y4M header"; return false; }
+        size_ = cv::Size(w, h);
+
+        // The 8-bit 4:2:0 chroma siting variants share the plane layout
+        size_t frameBytes = 0;
+        if (colorspace == "420" || colorspace == "420jpeg" || colorspace == "420paldv" || colorspace == "420mpeg2") {
+            if ((w | h) & 1) { err = cfg_.path + ": 4:2:0 needs an even frame size"; return false; }
+            format_ = FrameFormat::I420;
+            rows_ = h * 3 / 2;
+            frameBytes = (size_t)w * h * 3 / 2;
+        }
+        else if (colorspace == "mono") {
+            format_ = FrameFormat::Gray;
+            rows_ = h;
+            frameBytes = (size_t)w * h;
+        }
+        else {
+            err = cfg_.path + ": Y4M colorspace C" + colorspace + " is not supported (4:2:0 and mono)";
+            return false;
+        }
+
+        size_t pos = (size_t)(eol - p) + 1;
+        while (pos + 5 <= n && std::memcmp(p + pos, "FRAME", 5) == 0) {
+            const char* e = (const char*)std::memchr(p + pos, '\n', n - pos);
+            if (!e) break;
+            const size_t data = (size_t)(e - p) + 1;
+            if (data + frameBytes > n) break;                   // truncated last frame
+            offsets_.push_back(data);
+            pos = data + frameBytes;
+        }
+        if (offsets_.empty()) { err = cfg_.path + ": no complete frame"; return false; }
+        return true;
+    }
+
+    SourceConfig cfg_;
+    MappedFile file_;
+    std::vector<size_t> offsets_;
+    size_t cursor_ = 0;
+    cv::Size size_;
+    int rows_ = 0;                      // Mat rows of one frame (h * 3/2 for I420)
+    FrameFormat format_ = FrameFormat::BGR;
+    double fps_ = 0.0, setupMs_ = 0.0;
+};
+
+// -------------------- Factory / spec parsing --------------------
+
+std::unique_ptr<FrameSource> openFrameSource(const SourceConfig& cfg, std::string& err) {
+    switch (cfg.kind) {
+    case SourceKind::Camera:
+    case SourceKind::Video: {
+        auto s = std::make_unique<CaptureSource>();
+        if (!s->open(cfg, err)) return nullptr;
+        return s;
+    }
+    case SourceKind::Synthetic: {
+        auto s = std::make_unique<SyntheticSource>();
+        if (!s->open(cfg, err)) return nullptr;
+        return s;
+    }
+    case SourceKind::RawBgr:
+    case SourceKind::Y4m: {
+        auto s = std::make_unique<MappedSource>();
+        if (!s->open(cfg, err)) return nullptr;
+        return s;
+    }
+    }
+    err = "unknown source kind";
+    return nullptr;
+}
+
+bool parseFrameSource(const std::string& spec, SourceConfig& cfg, std::string& err) {
+    const std::string l = lower(spec);
+    if (l == "camera" || l.compare(0, 7, "camera:") == 0) {
+        cfg.kind = SourceKind::Camera;
+        cfg.path.clear();
+        cfg.device = 0;
+        if (l.size() > 7 && !parseInt(l.substr(7), cfg.device)) { err = "bad camera index in '" + spec + "'"; return false; }
+        return true;
+    }
+    if (l.compare(0, 10, "/dev/video") == 0) {
+        cfg.kind = SourceKind::Camera;
+        cfg.path = spec;
+        return true;
+    }
+    if (l == "synthetic" || l.compare(0, 10, "synthetic:") == 0) {
+        cfg.kind = SourceKind::Synthetic;
+        cfg.live = false;
+        if (cfg.width <= 0 || cfg.height <= 0) { cfg.width = 1280; cfg.height = 720; }
+        std::stringstream ss(l.size() > 10 ? l.substr(10) : std::string());
+        std::string item;
+        while (std::getline(ss, item, ':')) {
+            int w = 0, h = 0;
+            if (item == "noise")      cfg.corpus.content = CorpusContent::Noise;
+            else if (item == "scene") cfg.corpus.content = CorpusContent::Scene;
+            else if (item == "live")  cfg.live = true;
+            else if (parseSize(item, w, h)) { cfg.width = w; cfg.height = h; }
+            else { err = "bad synthetic option '" + item + "' (noise, scene, live, WxH)"; return false; }
+        }
+        return true;
+    }
+
+    // A file; an optional :WxH suffix gives the frame size of raw files
+    std::string path = spec;
+    int w = 0, h = 0;
+    const size_t colon = spec.rfind(':');
+    if (colon != std::string::npos && parseSize(spec.substr(colon + 1), w, h)) path = spec.substr(0, colon);
+    if (path.empty()) { err = "empty source path"; return false; }
+    const std::string ext = lower(path);
+    cfg.path = path;
+    if (endsWith(ext, ".y4m")) cfg.kind = SourceKind::Y4m;
+    else if (endsWith(ext, ".bgr") || endsWith(ext, ".raw")) {
+        if (w <= 0) { err = "raw BGR input needs its frame size (" + path + ":WxH)"; return false; }
+        cfg.kind = SourceKind::RawBgr;
+    }
+    else cfg.kind = SourceKind::Video;
+    if (w > 0) { cfg.width = w; cfg.height = h; }
+    return true;
+}
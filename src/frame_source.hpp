@@ -0,0 +1,89 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <memory>
+#include <string>
+#include "frame_corpus.hpp"
+
+enum class SourceKind {
+    Camera,     // cv::VideoCapture on a device (V4L2 on Linux, DirectShow on Windows)
+    Synthetic,  // FrameCorpus ring, or generateSyntheticFrame per frame (live)
+    Video,      // any file cv::VideoCapture decodes
+    RawBgr,     // headerless BGR8 frames back to back, memory mapped
+    Y4m         // YUV4MPEG2 (4:2:0 or mono), memory mapped
+};
+
+// Pixel layout of the frames read() returns
+enum class FrameFormat {
+    BGR,        // CV_8UC3
+    I420,       // CV_8UC1, h * 3/2 rows: Y plane, then U and V (COLOR_YUV2BGR_I420 layout)
+    NV12,       // CV_8UC1, h * 3/2 rows: Y plane, then interleaved U V (COLOR_YUV2BGR_NV12 layout)
+    YUYV,       // CV_8UC2, Y0 U Y1 V per pixel pair (COLOR_YUV2BGR_YUYV layout)
+    Gray        // CV_8UC1
+};
+
+struct SourceConfig {
+    SourceConfig() = default;
+    explicit SourceConfig(SourceKind k) : kind(k) {}
+
+    SourceKind kind = SourceKind::Camera;
+    std::string path;                   // file; camera: device path ("" = index)
+    int device = 0;                     // camera index
+    int width = 0, height = 0;          // raw and synthetic: frame size; camera: requested size (0 = default)
+    bool loop = true;                   // files: start over at the end
+    bool live = false;                  // synthetic: generate every frame in read() instead of a corpus
+    CorpusConfig corpus;                // synthetic
+    double pace = -1.0;                 // real-time consumers: frames per second to play files at,
+                                        // -1 = the file's own rate, 0 = as fast as they come
+    bool yuv = false;                   // consumer takes YUV frames as they are (--yuv); cameras
+                                        // (V4L2) then ask for YUYV / NV12 and return the frames
+                                        // undecoded instead of BGR, if the driver offers either
+};
+
+// Parse a source spec: camera[:N], /dev/videoN, synthetic[:noise|scene|live][:WxH],
+// clip.y4m, clip.bgr:WxH (also .raw), or any other path as a video file. Leaves the
+// corpus, pace and yuv settings alone. false (and err) on a malformed spec.
+bool parseFrameSource(const std::string& spec, SourceConfig& cfg, std::string& err);
+
+const char* frameFormatName(FrameFormat f);
+
+// Image size of a frame in format f (an I420 or NV12 Mat has h * 3/2 rows)
+cv::Size framePixelSize(const cv::Mat& frame, FrameFormat f);
+
+// Y'CbCr layouts the GPU path takes as they are (gl_utils.hpp FrameTextures)
+inline bool isYuvFormat(FrameFormat f) {
+    return f == FrameFormat::I420 || f == FrameFormat::NV12 || f == FrameFormat::YUYV;
+}
+
+// A frame in format f as BGR8 (cvtColor; a header copy for BGR)
+void frameToBGR(const cv::Mat& frame, FrameFormat f, cv::Mat& bgr);
+
+// A stream of frames. read() returns each frame in the source's native format, either as
+// a header into memory the source owns (mapped file, corpus ring; valid and unchanged while
+// the source lives, never write into it) or decoded / generated into the caller's Mat, whose
+// buffer is reused when it has the right size. Sources are not thread safe; one thread reads.
+class FrameSource {
+public:
+    virtual ~FrameSource() = default;
+
+    // Next frame; false at the end of a file without loop, or if the device stopped
+    virtual bool read(cv::Mat& frame) = 0;
+    // read() converted to BGR8; zero copy for BGR sources
+    bool readBGR(cv::Mat& bgr);
+    // Back to the first frame (no-op for cameras and live generation)
+    virtual void rewind() {}
+
+    virtual FrameFormat format() const { return FrameFormat::BGR; }
+    virtual cv::Size size() const = 0;
+    virtual double fps() const { return 0.0; }          // nominal rate of a file, 0 = unknown / device paced
+    virtual int frameCount() const { return 0; }        // frames in the file or ring, 0 = unbounded
+    virtual double setupMs() const { return 0.0; }      // time open spent before the first frame (corpus generation, indexing)
+
+    virtual const char* name() const = 0;               // "camera", "scene", "live", "y4m", ...
+    virtual std::string describe() const = 0;           // one line for the log
+
+private:
+    cv::Mat native_;
+};
+
+// nullptr (and err) if the source cannot be opened
+std::unique_ptr<FrameSource> openFrameSource(const SourceConfig& cfg, std::string& err);
@@ -0,0 +1,241 @@
+#include "gl_context.hpp"
+#include <GLFW/glfw3.h>
+#include <iostream>
+#include <vector>
+
+#if defined(VC_HAVE_EGL)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+#endif
+
+#if defined(VC_HAVE_OSMESA)
+#include <GL/osmesa.h>      // after glad, which already provides the GL types
+#endif
+
+const char* glBackendName(GlBackend b) {
+    switch (b) {
+    case GlBackend::Window: return "window";
+    case GlBackend::Egl:    return "egl";
+    case GlBackend::OsMesa: return "osmesa";
+    }
+    return "unknown";
+}
+
+bool parseGlBackend(const std::string& s, GlBackend& out) {
+    if (s == "window") { out = GlBackend::Window; return true; }
+    if (s == "egl")    { out = GlBackend::Egl;    return true; }
+    if (s == "osmesa") { out = GlBackend::OsMesa; return true; }
+    return false;
+}
+
+// -------------------- GLFW window --------------------
+
+class GlfwWindowContext : public GlContext {
+public:
+    ~GlfwWindowContext() override {
+        if (win_) glfwDestroyWindow(win_);
+        glfwTerminate();
+    }
+
+    bool create(int w, int h, const char* title) {
+        if (!glfwInit()) { std::cerr << "glfwInit failed\n"; return false; }
+        win_ = glfwCreateWindow(w, h, title, nullptr, nullptr);
+        if (!win_) { std::cerr << "Create window failed\n"; return false; }
+        glfwMakeContextCurrent(win_);
+        // Disable VSync to avoid frame rate lock by display refresh rate
+        glfwSwapInterval(0);
+        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) { std::cerr << "glad init failed\n"; return false; }
+        return true;
+    }
+
+    GlBackend backend() const override { return GlBackend::Window; }
+    void resize(int w, int h) override { glfwSetWindowSize(win_, w, h); }
+    void beginFrame(int& fbW, int& fbH) override {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glfwGetFramebufferSize(win_, &fbW, &fbH);
+    }
+    void present() override {
+        glfwSwapBuffers(win_);
+        glfwPollEvents();
+    }
+    bool shouldClose() const override { return glfwWindowShouldClose(win_) != 0; }
+
+private:
+    GLFWwindow* win_ = nullptr;
+};
+
+// -------------------- Offscreen (FBO) base --------------------
+
+// Renders into an RGBA8 FBO of the requested size. present() fences the frame and waits for
+// the previous one, like a double-buffered swap chain, so the GL queue cannot run ahead.
+class OffscreenContext : public GlContext {
+public:
+    void resize(int w, int h) override {
+        if (w == w_ && h == h_ && fbo_) return;
+        w_ = w; h_ = h;
+        destroyTarget();
+        glGenRenderbuffers(1, &color_);
+        glBindRenderbuffer(GL_RENDERBUFFER, color_);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glGenFramebuffers(1, &fbo_);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cerr << "[GlContext] offscreen framebuffer incomplete (" << w << "x" << h << ")\n";
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+    void beginFrame(int& fbW, int& fbH) override {
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+        fbW = w_; fbH = h_;
+    }
+    void present() override {
+        GLsync f = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+        if (inFlight_) {
+            while (glClientWaitSync(inFlight_, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull) == GL_TIMEOUT_EXPIRED) {}
+            glDeleteSync(inFlight_);
+        }
+        inFlight_ = f;
+    }
+
+protected:
+    // Call from the derived destructor while the context is still current
+    void destroyTarget() {
+        if (inFlight_) { glDeleteSync(inFlight_); inFlight_ = nullptr; }
+        if (fbo_) { glDeleteFramebuffers(1, &fbo_); fbo_ = 0; }
+        if (color_) { glDeleteRenderbuffers(1, &color_); color_ = 0; }
+    }
+
+    int w_ = 0, h_ = 0;
+    GLuint fbo_ = 0, color_ = 0;
+    GLsync inFlight_ = nullptr;
+};
+
+// -------------------- Surfaceless EGL --------------------
+
+#if defined(VC_HAVE_EGL)
+class EglContext : public OffscreenContext {
+public:
+    ~EglContext() override {
+        if (ctx_ != EGL_NO_CONTEXT) {
+            destroyTarget();
+            eglMakeCurrent(dpy_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            eglDestroyContext(dpy_, ctx_);
+        }
+        if (dpy_ != EGL_NO_DISPLAY) eglTerminate(dpy_);
+    }
+
+    bool create(int w, int h) {
+        // Mesa's surfaceless platform needs neither X11/Wayland nor a DRM node
+        auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay)
+            dpy_ = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (dpy_ == EGL_NO_DISPLAY)
+            dpy_ = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (dpy_ == EGL_NO_DISPLAY || !eglInitialize(dpy_, nullptr, nullptr)) {
+            std::cerr << "[EGL] no display\n"; dpy_ = EGL_NO_DISPLAY; return false;
+        }
+        if (!eglBindAPI(EGL_OPENGL_API)) { std::cerr << "[EGL] desktop GL not supported\n"; return false; }
+
+        EGLConfig cfg = nullptr;
+        const EGLint cfgAttribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+        EGLint n = 0;
+        eglChooseConfig(dpy_, cfgAttribs, &cfg, 1, &n);   // optional with EGL_KHR_no_config_context
+
+        const EGLint ctxAttribs[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 3,
+            EGL_CONTEXT_MINOR_VERSION, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        ctx_ = eglCreateContext(dpy_, n > 0 ? cfg : (EGLConfig)nullptr, EGL_NO_CONTEXT, ctxAttribs);
+        if (ctx_ == EGL_NO_CONTEXT) { std::cerr << "[EGL] eglCreateContext failed\n"; return false; }
+        if (!eglMakeCurrent(dpy_, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx_)) {
+            std::cerr << "[EGL] surfaceless eglMakeCurrent failed\n"; return false;
+        }
+        if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) { std::cerr << "glad init failed\n"; return false; }
+        resize(w, h);
+        return true;
+    }
+
+    GlBackend backend() const override { return GlBackend::Egl; }
+
+private:
+    EGLDisplay dpy_ = EGL_NO_DISPLAY;
+    EGLContext ctx_ = EGL_NO_CONTEXT;
+};
+#endif
+
+// -------------------- OSMesa --------------------
+
+#if defined(VC_HAVE_OSMESA)
+class OsMesaContext : public OffscreenContext {
+public:
+    ~OsMesaContext() override {
+        if (ctx_) {
+            destroyTarget();
+            OSMesaDestroyContext(ctx_);
+        }
+    }
+
+    bool create(int w, int h) {
+        const int attribs[] = {
+            OSMESA_FORMAT, OSMESA_RGBA,
+            OSMESA_DEPTH_BITS, 0,
+            OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+            OSMESA_CONTEXT_MAJOR_VERSION, 3,
+            OSMESA_CONTEXT_MINOR_VERSION, 3,
+            0
+        };
+        ctx_ = OSMesaCreateContextAttribs(attribs, nullptr);
+        if (!ctx_) { std::cerr << "[OSMesa] context creation failed\n"; return false; }
+        // The default framebuffer is only a placeholder; frames go to the FBO
+        placeholder_.assign(16 * 16 * 4, 0);
+        if (!OSMesaMakeCurrent(ctx_, placeholder_.data(), GL_UNSIGNED_BYTE, 16, 16)) {
+            std::cerr << "[OSMesa] OSMesaMakeCurrent failed\n"; return false;
+        }
+        if (!gladLoadGLLoader((GLADloadproc)OSMesaGetProcAddress)) { std::cerr << "glad init failed\n"; return false; }
+        resize(w, h);
+        return true;
+    }
+
+    GlBackend backend() const override { return GlBackend::OsMesa; }
+
+private:
+    OSMesaContext ctx_ = nullptr;
+    std::vector<unsigned char> placeholder_;
+};
+#endif
+
+std::unique_ptr<GlContext> createGlContext(GlBackend backend, int width, int height, const char* title) {
+    switch (backend) {
+    case GlBackend::Window: {
+        auto c = std::make_unique<GlfwWindowContext>();
+        if (c->create(width, height, title)) return c;
+        return nullptr;
+    }
+    case GlBackend::Egl: {
+#if defined(VC_HAVE_EGL)
+        auto c = std::make_unique<EglContext>();
+        if (c->create(width, height)) return c;
+#else
+        std::cerr << "[GlContext] built without EGL support\n";
+#endif
+        return nullptr;
+    }
+    case GlBackend::OsMesa: {
+#if defined(VC_HAVE_OSMESA)
+        auto c = std::make_unique<OsMesaContext>();
+        if (c->create(width, height)) return c;
+#else
+        std::cerr << "[GlContext] built without OSMesa support\n";
+#endif
+        return nullptr;
+    }
+    }
+    return nullptr;
+}
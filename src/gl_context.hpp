@@ -0,0 +1,40 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <glad/glad.h>
+
+// Where the benchmark gets its GL 3.3+ context and draws to
+enum class GlBackend {
+    Window,     // visible GLFW window, default framebuffer, glfwSwapBuffers
+    Egl,        // surfaceless EGL (e.g. Mesa llvmpipe in a container), renders into an FBO
+    OsMesa      // OSMesa software context, renders into an FBO
+};
+
+const char* glBackendName(GlBackend b);
+bool parseGlBackend(const std::string& s, GlBackend& out);   // "window" / "egl" / "osmesa"
+
+// A current GL context plus the framebuffer the pipeline draws into.
+// GpuPipeline::draw and the CPU passthrough draw into whatever beginFrame() bound,
+// so the same draw code runs on screen and offscreen.
+class GlContext {
+public:
+    virtual ~GlContext() = default;
+
+    virtual GlBackend backend() const = 0;
+
+    // Size of the render target (window client area or FBO)
+    virtual void resize(int width, int height) = 0;
+
+    // Bind the render target and return its size in pixels
+    virtual void beginFrame(int& fbW, int& fbH) = 0;
+
+    // End of frame: swap + poll events (window), or flush keeping at most one frame in flight (offscreen)
+    virtual void present() = 0;
+
+    // Window closed by the user (offscreen contexts never close)
+    virtual bool shouldClose() const { return false; }
+};
+
+// Create the context, make it current and load GL entry points through glad.
+// Returns nullptr (after printing the reason) if the backend is unavailable in this build or fails.
+std::unique_ptr<GlContext> createGlContext(GlBackend backend, int width, int height, const char* title);
@@ -1,4 +1,5 @@
 #include "gl_utils.hpp"
+#include "shader_cache.hpp"
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -35,14 +36,25 @@ namespace glutils {
     }
 
     GLuint loadShaderProgram(const std::string& vertexPath, const std::string& fragmentPath) {
-        std::string vsrc = loadFile(vertexPath);
-        std::string fsrc = loadFile(fragmentPath);
+        return linkProgram(loadFile(vertexPath), loadFile(fragmentPath));
+    }
+
+    GLuint linkProgram(const std::string& vsrc, const std::string& fsrc) {
+        return programCache().link(vsrc, fsrc);
+    }
+
+    GLuint buildProgram(const std::string& vsrc, const std::string& fsrc, bool retrievable) {
         GLuint vs = compileShader(GL_VERTEX_SHADER, vsrc);
         GLuint fs = compileShader(GL_FRAGMENT_SHADER, fsrc);
 
         GLuint prog = glCreateProgram();
         glAttachShader(prog, vs);
         glAttachShader(prog, fs);
+#if defined(VC_HAVE_PROGRAM_BINARY)
+        if (retrievable && programBinarySupported()) glProgramParameteri(prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#else
+        (void)retrievable;
+#endif
         glLinkProgram(prog);
 
         GLint ok = 0;
@@ -78,21 +90,81 @@ namespace glutils {
         return tex;
     }
 
+    FrameTextures createFrameTextures(int width, int height, FrameFormat format) {
+        FrameTextures t;
+        t.format = format;
+        switch (format) {
+        case FrameFormat::I420:
+            t.tex = createTexture2D(width, height, GL_RED);
+            t.texU = createTexture2D(width / 2, height / 2, GL_RED);
+            t.texV = createTexture2D(width / 2, height / 2, GL_RED);
+            break;
+        case FrameFormat::NV12:
+            t.tex = createTexture2D(width, height, GL_RED);
+            t.texU = createTexture2D(width / 2, height / 2, GL_RG);
+            break;
+        case FrameFormat::YUYV:
+            t.tex = createTexture2D(width, height, GL_RG);
+            t.texU = createTexture2D(width / 2, height, GL_RGBA);
+            break;
+        default:
+            t.format = FrameFormat::BGR;
+            t.tex = createTexture2D(width, height, GL_RGB);
+            return t;
+        }
+        // Luma in .r; chroma in .r (I420), .rg (NV12) or .ga (YUYV)
+        const GLfloat lumaBorder[4] = { 16.f / 255.f, 128.f / 255.f, 16.f / 255.f, 128.f / 255.f };
+        const GLfloat chromaBorder[4] = { 128.f / 255.f, 128.f / 255.f, 128.f / 255.f, 128.f / 255.f };
+        for (GLuint tex : { t.tex, t.texU, t.texV }) {
+            if (!tex) continue;
+            glBindTexture(GL_TEXTURE_2D, tex);
+            glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, tex == t.tex ? lumaBorder : chromaBorder);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return t;
+    }
+
+    void deleteFrameTextures(FrameTextures& t) {
+        // Unused chroma names are 0, which glDeleteTextures ignores
+        const GLuint tex[3] = { t.tex, t.texU, t.texV };
+        glDeleteTextures(3, tex);
+        t = FrameTextures{};
+    }
+
+    GLuint createTexture3D(int width, int height, int depth, GLenum internalFormat,
+        GLenum format, GLenum type, const void* data) {
+        GLuint tex; glGenTextures(1, &tex);
+        glBindTexture(GL_TEXTURE_3D, tex);
+        glTexImage3D(GL_TEXTURE_3D, 0, internalFormat, width, height, depth, 0, format, type, data);
+
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+        glBindTexture(GL_TEXTURE_3D, 0);
+        return tex;
+    }
+
 
     void uploadFrameToTexture(GLuint texID, const cv::Mat& frame) {
         if (frame.empty()) return;
 
-        cv::Mat rgb;
-        if (frame.channels() == 3)
-            cv::cvtColor(frame, rgb, cv::COLOR_BGR2RGB);
-        else if (frame.channels() == 4)
-            cv::cvtColor(frame, rgb, cv::COLOR_BGRA2RGB);
-        else
-            rgb = frame;
+        // Upload in the Mat's own channel order; no conversion pass on the CPU
+        GLenum fmt;
+        switch (frame.channels()) {
+        case 1:  fmt = GL_RED; break;
+        case 4:  fmt = GL_BGRA; break;
+        default: fmt = GL_BGR; break;
+        }
+        const cv::Mat src = frame.isContinuous() ? frame : frame.clone();
 
         glBindTexture(GL_TEXTURE_2D, texID);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
         glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0,
-            rgb.cols, rgb.rows, GL_RGB, GL_UNSIGNED_BYTE, rgb.data);
+            src.cols, src.rows, fmt, GL_UNSIGNED_BYTE, src.data);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
         glBindTexture(GL_TEXTURE_2D, 0);
     }
 
@@ -2,6 +2,7 @@
 #include <string>
 #include <glad/glad.h>
 #include <opencv2/opencv.hpp>
+#include "frame_source.hpp"
 
 namespace glutils {
 
@@ -14,10 +15,41 @@ namespace glutils {
 	/// ļ·벢ɫ
 	GLuint loadShaderProgram(const std::string& vertexPath, const std::string& fragmentPath);
 
+	/// Compile and link a program from in-memory sources (generated shaders). Goes through the
+	/// program binary cache (shader_cache.hpp), as does loadShaderProgram.
+	GLuint linkProgram(const std::string& vertexSrc, const std::string& fragmentSrc);
+
+	/// Always compile + link; retrievable sets GL_PROGRAM_BINARY_RETRIEVABLE_HINT (GL 4.1)
+	GLuint buildProgram(const std::string& vertexSrc, const std::string& fragmentSrc, bool retrievable);
+
 	/// һյ 2D 
 	GLuint createTexture2D(int width, int height, GLenum format = GL_RGB);
 
-	///  OpenCV Mat ϴе GL Զת RGB
+	/// Texture(s) of a video frame in the layout it arrives in; the shaders convert the YUV
+	/// ones to RGB (gpu_pipeline.hpp):
+	///   BGR   one RGB texture
+	///   I420  Y (GL_RED) at full size, U and V (GL_RED) at half size
+	///   NV12  Y (GL_RED) at full size, interleaved UV (GL_RG) at half size
+	///   YUYV  the same bytes twice: GL_RG at full size (.r = Y) and GL_RGBA at half width
+	///         (Y0 U Y1 V per pixel pair, .g = U, .a = V)
+	struct FrameTextures {
+		GLuint tex = 0;                 ///< BGR frame, or the luma texture
+		GLuint texU = 0, texV = 0;      ///< chroma textures (texV: I420 only), 0 for a BGR frame
+		FrameFormat format = FrameFormat::BGR;
+	};
+
+	/// Linear filtered, clamped to a black border (for YUV: Y = 16, U = V = 128, which is black
+	/// after conversion, so bilinear taps past the edge fade out the same way). format is
+	/// BGR or an isYuvFormat() layout; I420 / NV12 need an even size, YUYV an even width.
+	FrameTextures createFrameTextures(int width, int height, FrameFormat format);
+	void deleteFrameTextures(FrameTextures& t);
+
+	/// 3D texture (e.g. a color LUT) with linear filtering and clamped edges; data may be null
+	GLuint createTexture3D(int width, int height, int depth, GLenum internalFormat,
+		GLenum format, GLenum type, const void* data);
+
+	/// Upload an OpenCV Mat (BGR / BGRA / gray) into an existing texture as-is (GL_BGR etc.).
+	/// Synchronous; per-frame streaming goes through PboUploader (pbo_uploader.hpp).
 	void uploadFrameToTexture(GLuint texID, const cv::Mat& frame);
 
 	/// һȫ QuadVAOڻ
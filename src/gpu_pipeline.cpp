@@ -3,6 +3,7 @@
 
 #include <glm/gtc/type_ptr.hpp>
 #include <opencv2/opencv.hpp>
+#include <algorithm>
 
 // Convert OpenCV 3x3 affine matrix to GLM mat3 (filled in column-major order)
 static glm::mat3 toGLM(const cv::Matx33f& m) {
@@ -13,99 +14,407 @@ static glm::mat3 toGLM(const cv::Matx33f& m) {
     );
 }
 
-bool GpuPipeline::init(const std::string& shaderDir) {
-    try {
-        // Load three shader programs
-        prog_.passProg = glutils::loadShaderProgram(shaderDir + "/passthrough.vert",
-            shaderDir + "/passthrough.frag");
+// -------------------- Shader generation --------------------
+// A draw runs one or more consecutive passes of the plan. The fragment shader is assembled from
+// snippet modules: every pass k becomes `vec3 passK(vec2 p)`, the color of its output at pixel
+// position p (pixel centers at i + 0.5). The first pass of the draw reads the bound texture;
+// a later pass reads pass k - 1 evaluated on demand and rounded to 8 bits, exactly what it
+// would have read back from an RGBA8 intermediate target. Structure and neighborhood radii are
+// compiled in (#define), stage parameters are uniforms.
 
-        prog_.pixelateProg = glutils::loadShaderProgram(shaderDir + "/passthrough.vert",
-            shaderDir + "/filter_pixelate.frag");
+// Taps of the draw's input per fragment above which the next pass gets its own draw instead
+static const long kMaxFusedTaps = 64;
+
+static std::string headerSnippet(FrameFormat input) {
+    return
+        "#version 330 core\n"
+        "in vec2 vUV;\n"
+        "out vec4 FragColor;\n"
+        "uniform sampler2D uTex;\n"
+        + std::string(input == FrameFormat::I420 ? "uniform sampler2D uTexU, uTexV;\n"
+                      : isYuvFormat(input) ? "uniform sampler2D uTexU;\n" : "") +
+        "uniform int uFlip;\n"
+        "vec2 size;\n"
+        "ivec2 isize;\n"
+        "\n"
+        // Pointwise stage as a cached 3D LUT (color_lut.hpp). Lattice point i sits at texel
+        // center (i + 0.5) / n; rgb is the graded color, a a signed keep distance, so the
+        // interpolated qualifier still gives a hard keep / grade edge (ColorLut3D::kKeepZero)
+        "#define KEEP_ZERO (32768.0 / 65535.0)\n"
+        "vec3 applyLut(sampler3D lut, float n, vec3 c) {\n"
+        "    vec4 l = texture(lut, c * ((n - 1.0) / n) + 0.5 / n);\n"
+        "    return l.a > KEEP_ZERO ? c : l.rgb;\n"
+        "}\n"
+        "\n"
+        "vec3 quantize8(vec3 c) { return floor(clamp(c, 0.0, 1.0) * 255.0 + 0.5) / 255.0; }\n"
+        "\n";
+}
 
-        prog_.sincityProg = glutils::loadShaderProgram(shaderDir + "/passthrough.vert",
-            shaderDir + "/filter_sincity.frag");
+// Input of pass k: texel q (in range) and bilinear sample at p, black outside like the
+// CLAMP_TO_BORDER textures. From YUV textures, a texel fetch shares one chroma sample per 2x2
+// (I420, NV12) or 2x1 (YUYV) block like cvtColor; a bilinear sample filters luma and chroma at
+// their own resolutions and converts afterwards, which matches filtering converted colors since
+// the conversion is affine up to the clamp (and the borders are the YUV of black), with chroma
+// interpolated instead of replicated.
+static std::string inputSnippet(size_t k, FrameFormat input) {
+    const std::string K = std::to_string(k);
+    if (k == 0 && isYuvFormat(input)) {
+        // Chroma (u, v) at chroma texel c / normalized position uv, per layout (gl_utils.hpp)
+        std::string chromaFetch, chromaSample;
+        switch (input) {
+        case FrameFormat::I420:
+            chromaFetch = "vec2(texelFetch(uTexU, c, 0).r, texelFetch(uTexV, c, 0).r)";
+            chromaSample = "vec2(texture(uTexU, uv).r, texture(uTexV, uv).r)";
+            break;
+        case FrameFormat::NV12:
+            chromaFetch = "texelFetch(uTexU, c, 0).rg";
+            chromaSample = "texture(uTexU, uv).rg";
+            break;
+        default:
+            chromaFetch = "texelFetch(uTexU, c, 0).ga";
+            chromaSample = "texture(uTexU, uv).ga";
+            break;
+        }
+        const std::string chromaTexel = input == FrameFormat::YUYV ? "ivec2(q.x / 2, q.y)" : "q / 2";
+        return
+            "vec3 yuvToRgb(float y, vec2 c) {\n"
+            "    float l = 1.164383 * max(y - 16.0 / 255.0, 0.0);\n"
+            "    float u = c.x - 128.0 / 255.0, v = c.y - 128.0 / 255.0;\n"
+            "    return clamp(vec3(l + 1.596027 * v, l - 0.391762 * u - 0.812968 * v, l + 2.017232 * u), 0.0, 1.0);\n"
+            "}\n"
+            "vec3 fetch0(ivec2 q) {\n"
+            "    ivec2 c = " + chromaTexel + ";\n"
+            "    return yuvToRgb(texelFetch(uTex, q, 0).r, " + chromaFetch + ");\n"
+            "}\n"
+            "vec3 sample0(vec2 p) {\n"
+            "    vec2 uv = p / size;\n"
+            "    return yuvToRgb(texture(uTex, uv).r, " + chromaSample + ");\n"
+            "}\n";
     }
-    catch (const std::exception& e) {
-        fprintf(stderr, "[GpuPipeline] Shader load error: %s\n", e.what());
-        return false;
+    if (k == 0) {
+        return
+            "vec3 fetch0(ivec2 q) { return texelFetch(uTex, q, 0).rgb; }\n"
+            "vec3 sample0(vec2 p) { return texture(uTex, p / size).rgb; }\n";
     }
+    return
+        "vec3 fetch" + K + "(ivec2 q) {\n"
+        "    if (any(lessThan(q, ivec2(0))) || any(greaterThanEqual(q, isize))) return vec3(0.0);\n"
+        "    return quantize8(pass" + std::to_string(k - 1) + "(vec2(q) + 0.5));\n"
+        "}\n"
+        "vec3 sample" + K + "(vec2 p) {\n"
+        "    vec2 q = p - 0.5;\n"
+        "    ivec2 i = ivec2(floor(q));\n"
+        "    vec2 f = q - vec2(i);\n"
+        "    return mix(mix(fetch" + K + "(i), fetch" + K + "(i + ivec2(1, 0)), f.x),\n"
+        "               mix(fetch" + K + "(i + ivec2(0, 1)), fetch" + K + "(i + ivec2(1, 1)), f.x), f.y);\n"
+        "}\n";
+}
 
-    glUseProgram(prog_.passProg);
-    loc_uTex_pass_ = glGetUniformLocation(prog_.passProg, "uTex");
+// Uniform declarations of one stage slot
+static std::string stageUniforms(const FilterStage& s, int slot) {
+    const std::string j = std::to_string(slot);
+    switch (s.op) {
+    case StageOp::Warp:     return "uniform mat3 uAffine" + j + ";\n";
+    case StageOp::Pixelate: return "uniform vec2 uCells" + j + ";\n";
+    default:                return "uniform sampler3D uLut" + j + ";\nuniform float uLutSize" + j + ";\n";
+    }
+}
 
-    // ---- pixelate  ----
-    glUseProgram(prog_.pixelateProg);
-    loc_uTex_pix_ = glGetUniformLocation(prog_.pixelateProg, "uTex");
-    loc_uTexSize_pix_ = glGetUniformLocation(prog_.pixelateProg, "uTexSize");
-    loc_uBlock_pix_ = glGetUniformLocation(prog_.pixelateProg, "uBlock");
-    loc_uAff_pix_ = glGetUniformLocation(prog_.pixelateProg, "uAffine");
+// Resample stage: move p to where it samples the stage input
+static std::string warpSnippet(int slot) {
+    return "    p = (uAffine" + std::to_string(slot) + " * vec3(p, 1.0)).xy;\n";
+}
 
-    // ---- SinCity   ----
-    glUseProgram(prog_.sincityProg);
-    loc_uTex_sc_ = glGetUniformLocation(prog_.sincityProg, "uTex");
-    loc_uKeep_sc_ = glGetUniformLocation(prog_.sincityProg, "uKeepColor");
-    loc_uThresh_sc_ = glGetUniformLocation(prog_.sincityProg, "uThresh");
-    loc_uAff_sc_ = glGetUniformLocation(prog_.sincityProg, "uAffine");
+// Pixelate: snap p to the center of its cell, through the index of the pixel containing p,
+// which is robust to varying-interpolation error
+static std::string quantizeSnippet(int slot) {
+    const std::string j = std::to_string(slot);
+    return "    p = (floor(floor(p) * uCells" + j + " / size) + 0.5) * size / uCells" + j + ";\n";
+}
 
-    glUseProgram(0);
-    return true;
+static std::string colorSnippet(int slot) {
+    const std::string j = std::to_string(slot);
+    return "    c = applyLut(uLut" + j + ", uLutSize" + j + ", c);\n";
 }
 
-void GpuPipeline::draw(GLuint vao, GLuint tex, int texW, int texH,
-    FilterType filter, const FilterParams& fp,
-    const AffineParams& ap)
-{
-    // Bind input texture to texture unit 0
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, tex);
+// Fused pass: map p through the resample stages (last stage first, as on the CPU), take one
+// bilinear sample, then run the pointwise stages in graph order. Slots are numbered resample
+// stages first, then pointwise stages.
+static std::string fusedPassSnippet(const FilterGraph& g, const FusedPass& p, size_t k, int slot, std::string& decl) {
+    const std::string K = std::to_string(k);
+    const int firstPointwise = slot + (int)p.resample.size();
+    for (size_t j = 0; j < p.resample.size(); ++j) decl += stageUniforms(g.stages[p.resample[j]], slot + (int)j);
+    for (size_t j = 0; j < p.pointwise.size(); ++j) decl += stageUniforms(g.stages[p.pointwise[j]], firstPointwise + (int)j);
+
+    std::string body = "vec3 pass" + K + "(vec2 p) {\n";
+    for (size_t j = p.resample.size(); j-- > 0;) {
+        body += g.stages[p.resample[j]].op == StageOp::Warp ? warpSnippet(slot + (int)j) : quantizeSnippet(slot + (int)j);
+    }
+    body += "    if (p.x < 0.0 || p.y < 0.0 || p.x > size.x || p.y > size.y) return vec3(0.0);\n";
+    // Without resample stages p is a pixel center of the input (the frame size is shared)
+    if (k > 0 && p.resample.empty()) body += "    vec3 c = fetch" + K + "(min(ivec2(floor(p)), isize - 1));\n";
+    else                             body += "    vec3 c = sample" + K + "(p);\n";
+    for (size_t j = 0; j < p.pointwise.size(); ++j) body += colorSnippet(firstPointwise + (int)j);
+    return body + "    return c;\n}\n";
+}
+
+// Neighborhood pass: (2r + 1)^2 box over the input, edges replicated
+static std::string boxBlurSnippet(size_t k, int radius) {
+    const std::string K = std::to_string(k), R = "RADIUS" + K;
+    return
+        "#define " + R + " " + std::to_string(radius) + "\n"
+        "vec3 pass" + K + "(vec2 p) {\n"
+        "    ivec2 q = ivec2(floor(p));\n"
+        "    vec3 acc = vec3(0.0);\n"
+        "    for (int dy = -" + R + "; dy <= " + R + "; ++dy)\n"
+        "        for (int dx = -" + R + "; dx <= " + R + "; ++dx)\n"
+        "            acc += fetch" + K + "(clamp(q + ivec2(dx, dy), ivec2(0), isize - 1));\n"
+        "    return acc / float((2 * " + R + " + 1) * (2 * " + R + " + 1));\n"
+        "}\n";
+}
+
+// Passes [first, last] of the plan as one fragment shader
+static std::string drawSource(const FilterGraph& g, const FilterPlan& plan, size_t first, size_t last, FrameFormat input) {
+    std::string decl, body;
+    int slot = 0;
+    for (size_t k = first; k <= last; ++k) {
+        const FusedPass& p = plan.passes[k];
+        body += inputSnippet(k - first, input);
+        if (p.neighborhood >= 0) {
+            body += boxBlurSnippet(k - first, g.stages[p.neighborhood].radius);
+            continue;
+        }
+        body += fusedPassSnippet(g, p, k - first, slot, decl);
+        slot += (int)(p.resample.size() + p.pointwise.size());
+    }
+    return headerSnippet(input) + decl + "\n" + body +
+        "\n"
+        "void main() {\n"
+        "    isize = textureSize(uTex, 0);\n"
+        "    size = vec2(isize);\n"
+        "    vec2 p = vec2(vUV.x, uFlip != 0 ? 1.0 - vUV.y : vUV.y) * size;\n"
+        "    FragColor = vec4(pass" + std::to_string(last - first) + "(p), 1.0);\n"
+        "}\n";
+}
+
+// Split the plan into draws: a pass joins the current draw while the input taps per fragment
+// (each fused pass re-evaluates its predecessor once per tap) stay within kMaxFusedTaps
+static std::vector<std::pair<size_t, size_t>> drawGroups(const FilterGraph& g, const FilterPlan& plan) {
+    auto taps = [&](const FusedPass& p, bool first) -> long {
+        if (p.neighborhood >= 0) { const long d = 2L * g.stages[p.neighborhood].radius + 1; return d * d; }
+        return first || p.resample.empty() ? 1 : 4;
+    };
+    std::vector<std::pair<size_t, size_t>> groups;
+    size_t first = 0;
+    long cost = taps(plan.passes[0], true);
+    for (size_t k = 1; k < plan.passes.size(); ++k) {
+        const long t = taps(plan.passes[k], false);
+        if (cost * t <= kMaxFusedTaps) { cost *= t; continue; }
+        groups.emplace_back(first, k - 1);
+        first = k;
+        cost = taps(plan.passes[k], true);
+    }
+    groups.emplace_back(first, plan.passes.size() - 1);
+    return groups;
+}
+
+const GpuPipeline::DrawProgram& GpuPipeline::program(const FilterGraph& g, const FilterPlan& plan, size_t first, size_t last, FrameFormat input) {
+    std::string key = input == FrameFormat::BGR ? "" : std::string(frameFormatName(input)) + "|";
+    for (size_t k = first; k <= last; ++k) {
+        const FusedPass& p = plan.passes[k];
+        key += p.signature(g);
+        if (p.neighborhood >= 0) key += ":" + std::to_string(g.stages[p.neighborhood].radius);
+        key += "/";
+    }
+    auto it = programs_.find(key);
+    if (it != programs_.end()) return it->second;
 
-    // Build 3x3 affine matrix in pixel coordinates (consistent with CPU version)
-    const cv::Matx33f M = affineMatrix(ap, texW, texH);
-    const glm::mat3   gM = toGLM(M);
+    DrawProgram dp;
+    dp.prog = glutils::linkProgram(vertSrc_, drawSource(g, plan, first, last, input));
+    dp.uTex = glGetUniformLocation(dp.prog, "uTex");
+    dp.uTexU = glGetUniformLocation(dp.prog, "uTexU");
+    dp.uTexV = glGetUniformLocation(dp.prog, "uTexV");
+    dp.uFlip = glGetUniformLocation(dp.prog, "uFlip");
+    int slot = 0;
+    for (size_t k = first; k <= last; ++k) {
+        const FusedPass& p = plan.passes[k];
+        PassUniforms pu;
+        for (size_t j = 0; j < p.resample.size(); ++j, ++slot) {
+            const std::string s = std::to_string(slot);
+            pu.uAffine.push_back(glGetUniformLocation(dp.prog, ("uAffine" + s).c_str()));
+            pu.uCells.push_back(glGetUniformLocation(dp.prog, ("uCells" + s).c_str()));
+        }
+        for (size_t j = 0; j < p.pointwise.size(); ++j, ++slot) {
+            const std::string s = std::to_string(slot);
+            pu.uLut.push_back(glGetUniformLocation(dp.prog, ("uLut" + s).c_str()));
+            pu.uLutSize.push_back(glGetUniformLocation(dp.prog, ("uLutSize" + s).c_str()));
+        }
+        dp.passes.push_back(pu);
+    }
+    return programs_.emplace(key, dp).first->second;
+}
+
+// -------------------- Pipeline --------------------
+
+bool GpuPipeline::init(const std::string& shaderDir) {
+    try {
+        vertSrc_ = glutils::loadFile(shaderDir + "/passthrough.vert");
+        passProg_ = glutils::linkProgram(vertSrc_, glutils::loadFile(shaderDir + "/passthrough.frag"));
 
-    // Choose program
-    GLuint prog = prog_.passProg;
-    switch (filter) {
-    case FilterType::None:     prog = prog_.passProg;      break;
-    case FilterType::Pixelate: prog = prog_.pixelateProg;  break;
-    case FilterType::SinCity:  prog = prog_.sincityProg;   break;
+        // Programs are generated per pass structure on first use; build the plain ones up front
+        // so a broken driver / shader setup fails here rather than mid-benchmark
+        FilterPlan plain;
+        plain.passes.push_back(FusedPass{});
+        for (FrameFormat input : { FrameFormat::BGR, FrameFormat::I420, FrameFormat::NV12, FrameFormat::YUYV })
+            program(FilterGraph{}, plain, 0, 0, input);
     }
+    catch (const std::exception& e) {
+        fprintf(stderr, "[GpuPipeline] Shader load error: %s\n", e.what());
+        return false;
+    }
+    return true;
+}
 
-    glUseProgram(prog);
+void GpuPipeline::release() {
+    for (auto& kv : programs_) glDeleteProgram(kv.second.prog);
+    programs_.clear();
+    if (passProg_) glDeleteProgram(passProg_);
+    passProg_ = 0;
+    for (auto& l : luts_) glDeleteTextures(1, &l.tex);
+    luts_.clear();
+    glDeleteFramebuffers(2, targetFbo_);
+    glDeleteTextures(2, targetTex_);
+    targetFbo_[0] = targetFbo_[1] = targetTex_[0] = targetTex_[1] = 0;
+    targetW_ = targetH_ = 0;
+}
 
-    // Set uniforms for the selected path
-    if (prog == prog_.passProg) {
+void GpuPipeline::ensureTargets(int w, int h) {
+    if (targetTex_[0] && targetW_ == w && targetH_ == h) return;
+    glDeleteFramebuffers(2, targetFbo_);
+    glDeleteTextures(2, targetTex_);
+    glGenFramebuffers(2, targetFbo_);
+    for (int i = 0; i < 2; ++i) {
+        targetTex_[i] = glutils::createTexture2D(w, h, GL_RGBA);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, targetFbo_[i]);
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, targetTex_[i], 0);
+    }
+    targetW_ = w; targetH_ = h;
+}
 
-        if (loc_uTex_pass_ >= 0) glUniform1i(loc_uTex_pass_, 0);
-        GLint loc_uAff_pass = glGetUniformLocation(prog_.passProg, "uAffine");
-        if (loc_uAff_pass >= 0)  glUniformMatrix3fv(loc_uAff_pass, 1, GL_FALSE, glm::value_ptr(gM));
+GLuint GpuPipeline::lutTexture(const std::shared_ptr<const ColorLut3D>& lut) {
+    for (size_t i = 0; i < luts_.size(); ++i) {
+        if (luts_[i].lut != lut) continue;
+        const LutTexture hit = luts_[i];
+        luts_.erase(luts_.begin() + (ptrdiff_t)i);
+        luts_.insert(luts_.begin(), hit);
+        return hit.tex;
     }
-    else if (prog == prog_.pixelateProg) {
-        if (loc_uTex_pix_ >= 0) glUniform1i(loc_uTex_pix_, 0);
-        if (loc_uTexSize_pix_ >= 0) glUniform2f(loc_uTexSize_pix_, (float)texW, (float)texH);
-        if (loc_uBlock_pix_ >= 0) glUniform1f(loc_uBlock_pix_, (float)std::max(1, fp.pixelBlock));
-        if (loc_uAff_pix_ >= 0) glUniformMatrix3fv(loc_uAff_pix_, 1, GL_FALSE, glm::value_ptr(gM));
+    const int n = lut->size();
+    LutTexture e;
+    e.lut = lut;
+    e.tex = glutils::createTexture3D(n, n, n, GL_RGBA16, GL_BGRA, GL_UNSIGNED_SHORT, lut->data());
+    luts_.insert(luts_.begin(), e);
+    if (luts_.size() > 4) {
+        glDeleteTextures(1, &luts_.back().tex);
+        luts_.pop_back();
     }
-    else if (prog == prog_.sincityProg) {
-        if (loc_uTex_sc_ >= 0) glUniform1i(loc_uTex_sc_, 0);
+    return e.tex;
+}
+
+// Texture units: the draw input on 0, its chroma textures on 1 and 2, LUTs from kFirstLutUnit on
+static const GLenum kFirstLutUnit = 3;
+
+void GpuPipeline::draw(GLuint vao, const glutils::FrameTextures& frame, int texW, int texH, const FilterGraph& graph)
+{
+    FilterPlan plan = planFilterGraph(graph, texW, texH);
+    if (plan.passes.empty()) plan.passes.push_back(FusedPass{});   // plain (flipped) copy
+    const std::vector<std::pair<size_t, size_t>> groups = drawGroups(graph, plan);
 
-        // keep color: BGR(0..255) -> RGB(0..1)
-        const glm::vec3 keepRGB(
-            fp.keepBGR[2] / 255.f,
-            fp.keepBGR[1] / 255.f,
-            fp.keepBGR[0] / 255.f
-        );
-        if (loc_uKeep_sc_ >= 0) glUniform3fv(loc_uKeep_sc_, 1, &keepRGB[0]);
-        if (loc_uThresh_sc_ >= 0) glUniform1f(loc_uThresh_sc_, (float)fp.thresh / 255.f);
-        if (loc_uAff_sc_ >= 0) glUniformMatrix3fv(loc_uAff_sc_, 1, GL_FALSE, glm::value_ptr(gM));
+    // The last draw goes to the caller's framebuffer and viewport
+    GLint outFbo = 0, outViewport[4] = { 0, 0, 0, 0 };
+    if (groups.size() > 1) {
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &outFbo);
+        glGetIntegerv(GL_VIEWPORT, outViewport);
+        ensureTargets(texW, texH);
     }
 
-    // Draw
     glBindVertexArray(vao);
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    glBindVertexArray(0);
+    GLuint in = frame.tex;
+    GLenum lutUnits = 0;
+    for (size_t d = 0; d < groups.size(); ++d) {
+        const bool last = d + 1 == groups.size();
+        if (last) {
+            if (groups.size() > 1) {
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)outFbo);
+                glViewport(outViewport[0], outViewport[1], outViewport[2], outViewport[3]);
+            }
+        }
+        else {
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, targetFbo_[d & 1]);
+            glViewport(0, 0, texW, texH);
+        }
+
+        // Only the first draw reads the frame; intermediate targets are RGBA
+        const FrameFormat input = d == 0 ? frame.format : FrameFormat::BGR;
+        const DrawProgram& dp = program(graph, plan, groups[d].first, groups[d].second, input);
+        glUseProgram(dp.prog);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, in);
+        if (dp.uTex >= 0) glUniform1i(dp.uTex, 0);
+        if (isYuvFormat(input)) {
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, frame.texU);
+            glActiveTexture(GL_TEXTURE2);
+            glBindTexture(GL_TEXTURE_2D, frame.texV);
+            if (dp.uTexU >= 0) glUniform1i(dp.uTexU, 1);
+            if (dp.uTexV >= 0) glUniform1i(dp.uTexV, 2);
+        }
+        // Intermediate targets keep the image's top-down row order; only the final draw flips
+        if (dp.uFlip >= 0) glUniform1i(dp.uFlip, last ? 1 : 0);
+
+        GLenum unit = 0;
+        for (size_t k = groups[d].first; k <= groups[d].second; ++k) {
+            const FusedPass& p = plan.passes[k];
+            const PassUniforms& pu = dp.passes[k - groups[d].first];
+            for (size_t j = 0; j < p.resample.size(); ++j) {
+                const FilterStage& s = graph.stages[p.resample[j]];
+                if (s.op == StageOp::Warp) {
+                    // 3x3 affine matrix in pixel coordinates (consistent with the CPU version)
+                    const glm::mat3 gM = toGLM(affineMatrix(s.affine, texW, texH));
+                    if (pu.uAffine[j] >= 0) glUniformMatrix3fv(pu.uAffine[j], 1, GL_FALSE, glm::value_ptr(gM));
+                }
+                else if (pu.uCells[j] >= 0) {
+                    glUniform2f(pu.uCells[j], (float)std::max(1, texW / s.block), (float)std::max(1, texH / s.block));
+                }
+            }
+            for (size_t j = 0; j < p.pointwise.size(); ++j, ++unit) {
+                const std::shared_ptr<const ColorLut3D> lut = stageLut(graph.stages[p.pointwise[j]]);
+                glActiveTexture(GL_TEXTURE0 + kFirstLutUnit + unit);
+                glBindTexture(GL_TEXTURE_3D, lutTexture(lut));
+                if (pu.uLut[j] >= 0) glUniform1i(pu.uLut[j], (GLint)(kFirstLutUnit + unit));
+                if (pu.uLutSize[j] >= 0) glUniform1f(pu.uLutSize[j], (float)lut->size());
+            }
+        }
+        lutUnits = std::max(lutUnits, unit);
+
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        if (!last) in = targetTex_[d & 1];
+    }
 
     // Cleanup bindings
+    for (GLenum j = 0; j < lutUnits; ++j) {
+        glActiveTexture(GL_TEXTURE0 + kFirstLutUnit + j);
+        glBindTexture(GL_TEXTURE_3D, 0);
+    }
+    if (isYuvFormat(frame.format)) {
+        for (GLenum j : { GL_TEXTURE1, GL_TEXTURE2 }) {
+            glActiveTexture(j);
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
+    }
+    glActiveTexture(GL_TEXTURE0);
+    glBindVertexArray(0);
     glUseProgram(0);
     glBindTexture(GL_TEXTURE_2D, 0);
 }
@@ -1,30 +1,58 @@
 #pragma once
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
-#include "cv_filters.hpp"
-#include "cv_geom.hpp"
-
-struct GpuPrograms {
-    GLuint passProg = 0;        // ֱͨɫ
-    GLuint pixelateProg = 0;    // GPU ػ
-    GLuint sincityProg = 0;     // GPU SinCity
-};
+#include "filter_graph.hpp"
+#include "gl_utils.hpp"
 
+// GPU executor of a filter graph. The passes of planFilterGraph() run as fullscreen draws
+// with fragment shaders assembled from snippet modules per pass structure
+// (FusedPass::signature) and cached, so a fused Warp + SinCity + Pixelate chain costs a single
+// texture read per fragment. Consecutive passes share one draw, a pass re-evaluating its
+// predecessor per tap, as long as that stays cheap (a warp + box blur + SinCity chain is one
+// draw); otherwise intermediate results render into two ping-pong RGBA8 targets. The last draw
+// goes to the framebuffer and viewport bound by the caller. An I420, NV12 or YUYV frame is read
+// from its textures and converted to RGB in the first draw's input fetch (BT.601 limited range,
+// like cvtColor's COLOR_YUV2BGR_*), so it needs no conversion pass on the CPU.
 class GpuPipeline {
 public:
     bool init(const std::string& shaderDir);
-    void draw(GLuint vao, GLuint tex, int texW, int texH,
-        FilterType filter, const FilterParams& fp,
-        const AffineParams& ap);
+    void draw(GLuint vao, const glutils::FrameTextures& frame, int texW, int texH, const FilterGraph& graph);
+    void draw(GLuint vao, GLuint tex, int texW, int texH, const FilterGraph& graph) {
+        draw(vao, glutils::FrameTextures{ tex }, texW, texH, graph);
+    }
+    // shaders/passthrough.{vert,frag} (uTex, uAffine), shared with the callers' own overlay draws
+    GLuint passthroughProgram() const { return passProg_; }
+    // Delete the programs, LUT textures and pass targets; call while the GL context is still current
+    void release();
 
 private:
-    GpuPrograms prog_;
-    GLint loc_uTex_pass_ = -1;
+    struct PassUniforms {
+        std::vector<GLint> uAffine, uCells;     // per resample slot (FusedPass::resample order)
+        std::vector<GLint> uLut, uLutSize;      // per pointwise slot
+    };
+    struct DrawProgram {
+        GLuint prog = 0;
+        GLint uTex = -1, uTexU = -1, uTexV = -1, uFlip = -1;
+        std::vector<PassUniforms> passes;       // per pass of the draw
+    };
+    // Program running passes [first, last] of plan in one draw, generated and linked on first
+    // use; input: layout of the draw input (FrameTextures::format, BGR for the RGBA targets)
+    const DrawProgram& program(const FilterGraph& g, const FilterPlan& plan, size_t first, size_t last, FrameFormat input);
+    std::string vertSrc_;
+    GLuint passProg_ = 0;
+    std::unordered_map<std::string, DrawProgram> programs_;     // by input, pass signatures + radii
 
-    // Pixelate uniforms
-    GLint loc_uTex_pix_ = -1, loc_uTexSize_pix_ = -1, loc_uBlock_pix_ = -1, loc_uAff_pix_ = -1;
+    // Ping-pong targets for intermediate passes, (re)allocated on size change
+    void ensureTargets(int w, int h);
+    GLuint targetTex_[2] = { 0, 0 }, targetFbo_[2] = { 0, 0 };
+    int targetW_ = 0, targetH_ = 0;
 
-    // SinCity uniforms
-    GLint loc_uTex_sc_ = -1, loc_uKeep_sc_ = -1, loc_uThresh_sc_ = -1, loc_uAff_sc_ = -1;
+    // 3D textures of recently used LUTs, most recent first; a LUT is uploaded once, not per frame
+    GLuint lutTexture(const std::shared_ptr<const ColorLut3D>& lut);
+    struct LutTexture { std::shared_ptr<const ColorLut3D> lut; GLuint tex = 0; };
+    std::vector<LutTexture> luts_;
 };
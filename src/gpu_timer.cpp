@@ -0,0 +1,105 @@
+#include "gpu_timer.hpp"
+#include <algorithm>
+
+namespace glutils {
+
+	void GpuTimer::init(int frames) {
+		release();
+		GLint bits = 0;
+		glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+		while (glGetError() != GL_NO_ERROR) {}     // older contexts reject the query
+		active_ = bits > 0;
+		frames_.assign(std::max(frames, 2), Frame{});
+		cur_ = 0;
+	}
+
+	void GpuTimer::release() {
+		if (!all_.empty()) glDeleteQueries((GLsizei)all_.size(), all_.data());
+		all_.clear();
+		free_.clear();
+		frames_.clear();
+		open_.clear();
+		cur_ = 0;
+		active_ = false;
+	}
+
+	GLuint GpuTimer::query() {
+		if (free_.empty()) {
+			GLuint q = 0;
+			glGenQueries(1, &q);
+			all_.push_back(q);
+			return q;
+		}
+		GLuint q = free_.back();
+		free_.pop_back();
+		return q;
+	}
+
+	void GpuTimer::recycle(Frame& f) {
+		for (const Span& s : f.spans) {
+			free_.push_back(s.q0);
+			if (s.q1) free_.push_back(s.q1);
+		}
+		f.spans.clear();
+		f.last = 0;
+	}
+
+	bool GpuTimer::collect(Frame& f, bool wait) {
+		if (f.spans.empty()) return true;
+		// Timestamps complete in submission order: the newest query of the frame decides
+		GLint ready = 0;
+		glGetQueryObjectiv(f.last, GL_QUERY_RESULT_AVAILABLE, &ready);
+		if (!ready && !wait) return false;
+		for (const Span& s : f.spans) {
+			if (!s.q1) continue;       // never ended
+			GLuint64 t0 = 0, t1 = 0;
+			glGetQueryObjectui64v(s.q0, GL_QUERY_RESULT, &t0);
+			glGetQueryObjectui64v(s.q1, GL_QUERY_RESULT, &t1);
+			s.stage->recordNs(t1 > t0 ? (uint64_t)(t1 - t0) : 0);
+		}
+		recycle(f);
+		return true;
+	}
+
+	void GpuTimer::beginFrame() {
+		if (!active_) return;
+		open_.clear();
+		const int n = (int)frames_.size();
+		// Oldest first, so the stages see frames in order
+		for (int i = 1; i < n; ++i) collect(frames_[(cur_ + i) % n], false);
+		cur_ = (cur_ + 1) % n;
+		Frame& f = frames_[cur_];
+		if (!collect(f, false)) {
+			dropped_ += f.spans.size();
+			recycle(f);
+		}
+	}
+
+	void GpuTimer::begin(StageStat& stage) {
+		if (!active_) return;
+		Span s;
+		s.q0 = query();
+		s.stage = &stage;
+		glQueryCounter(s.q0, GL_TIMESTAMP);
+		frames_[cur_].last = s.q0;
+		open_.push_back(frames_[cur_].spans.size());
+		frames_[cur_].spans.push_back(s);
+	}
+
+	void GpuTimer::end() {
+		if (!active_ || open_.empty()) return;
+		Span& s = frames_[cur_].spans[open_.back()];
+		open_.pop_back();
+		s.q1 = query();
+		glQueryCounter(s.q1, GL_TIMESTAMP);
+		frames_[cur_].last = s.q1;
+	}
+
+	void GpuTimer::finish() {
+		if (!active_) return;
+		while (!open_.empty()) end();
+		const int n = (int)frames_.size();
+		for (int i = 1; i <= n; ++i) collect(frames_[(cur_ + i) % n], true);
+	}
+
+}
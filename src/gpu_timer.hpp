@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include "timing.hpp"
+
+namespace glutils {
+
+	/// GPU-side timing of GL command ranges with GL_TIMESTAMP queries (GL 3.3).
+	/// begin() / end() put a timestamp query before and after the commands of a scope and
+	/// record the difference into a StageStat, so a stage shows what the GPU spent on it
+	/// (upload DMA, shader work) rather than how long the driver calls took on the CPU.
+	/// Queries of a frame go to a ring of `frames` slots and are only read once the GL reports
+	/// them available, normally a frame or two later; nothing waits on the GPU. Results still
+	/// pending when their slot comes round again are dropped and counted. Scopes may nest.
+	/// Inactive (every call a no-op) if the context has no timer queries.
+	class GpuTimer {
+	public:
+		GpuTimer() = default;
+		GpuTimer(const GpuTimer&) = delete;
+		GpuTimer& operator=(const GpuTimer&) = delete;
+
+		/// Needs a current GL context
+		void init(int frames = 4);
+		/// Delete the queries; call while the context is still current
+		void release();
+		bool active() const { return active_; }
+
+		/// Start the next frame slot, recording every earlier result that is available
+		void beginFrame();
+		void begin(StageStat& stage);
+		void end();
+
+		/// Block until every issued query is done and record it (end of a benchmark run)
+		void finish();
+
+		uint64_t dropped() const { return dropped_; }
+
+	private:
+		struct Span { GLuint q0 = 0, q1 = 0; StageStat* stage = nullptr; };
+		struct Frame { std::vector<Span> spans; GLuint last = 0; };   // last: newest query issued
+		GLuint query();
+		bool collect(Frame& f, bool wait);
+		void recycle(Frame& f);
+
+		bool active_ = false;
+		std::vector<Frame> frames_;
+		int cur_ = 0;
+		std::vector<size_t> open_;     // spans of the current frame begun but not ended
+		std::vector<GLuint> free_;     // idle query objects
+		std::vector<GLuint> all_;
+		uint64_t dropped_ = 0;
+	};
+
+	/// RAII scope for GpuTimer::begin / end
+	class GpuScope {
+	public:
+		GpuScope(GpuTimer& timer, StageStat& stage) : timer_(timer) { timer_.begin(stage); }
+		~GpuScope() { timer_.end(); }
+		GpuScope(const GpuScope&) = delete;
+		GpuScope& operator=(const GpuScope&) = delete;
+
+	private:
+		GpuTimer& timer_;
+	};
+
+}
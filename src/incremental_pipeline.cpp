@@ -0,0 +1,145 @@
+#include "incremental_pipeline.hpp"
+#include "cpu_pipeline.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+IncrementalCpuPipeline::IncrementalCpuPipeline(const IncrementalConfig& cfg) : cfg_(cfg) {
+    cfg_.tile = std::max(8, cfg_.tile);
+}
+
+void IncrementalCpuPipeline::reset() {
+    valid_ = false;
+    in_.release();
+    out_.clear();
+    reach_.clear();
+    dirty_.clear();
+    dirtyFraction_ = 0.0;
+}
+
+void IncrementalCpuPipeline::rebuild(const cv::Mat& src, const FilterGraph& graph) {
+    const int T = cfg_.tile;
+    graph_ = graph;
+    size_ = src.size();
+    plan_ = planFilterGraph(graph_, size_.width, size_.height);
+    tx_ = (size_.width + T - 1) / T;
+    ty_ = (size_.height + T - 1) / T;
+    in_ = src.clone();
+
+    out_.assign(plan_.passes.size(), cv::Mat());
+    reach_.assign(plan_.passes.size(), std::vector<cv::Rect>());
+    const cv::Rect frame(0, 0, size_.width, size_.height);
+    for (size_t k = 0; k < plan_.passes.size(); ++k) {
+        out_[k].create(size_.height, size_.width, CV_8UC3);
+        std::vector<cv::Rect>& reach = reach_[k];
+        reach.resize((size_t)tx_ * ty_);
+        for (int j = 0; j < ty_; ++j) {
+            for (int i = 0; i < tx_; ++i) {
+                const cv::Rect fp = cpuPassFootprint(graph_, plan_.passes[k], cv::Rect(i * T, j * T, T, T) & frame, size_);
+                if (fp.empty()) continue;
+                const int i0 = fp.x / T, j0 = fp.y / T;
+                const int i1 = (fp.x + fp.width - 1) / T, j1 = (fp.y + fp.height - 1) / T;
+                reach[(size_t)j * tx_ + i] = cv::Rect(i0, j0, i1 - i0 + 1, j1 - j0 + 1);
+            }
+        }
+    }
+    valid_ = true;
+}
+
+// Compare src with the accepted input tile by tile; changed tiles are copied into in_
+void IncrementalCpuPipeline::markChangedTiles(const cv::Mat& src, std::vector<uchar>& mask) {
+    const int T = cfg_.tile, W = size_.width, H = size_.height;
+    mask.assign((size_t)tx_ * ty_, 0);
+    cpuThreadPool().parallelFor(0, ty_, 1, [&](int j0, int j1) {
+        for (int j = j0; j < j1; ++j) {
+            const int y0 = j * T, y1 = std::min(H, y0 + T);
+            for (int i = 0; i < tx_; ++i) {
+                const int x0 = i * T, n = 3 * (std::min(W, x0 + T) - x0);
+                bool changed = false;
+                if (cfg_.noise <= 0.0) {
+                    for (int y = y0; y < y1 && !changed; ++y)
+                        changed = std::memcmp(src.ptr<uchar>(y) + 3 * x0, in_.ptr<uchar>(y) + 3 * x0, (size_t)n) != 0;
+                }
+                else {
+                    long long sad = 0;
+                    for (int y = y0; y < y1; ++y) {
+                        const uchar* a = src.ptr<uchar>(y) + 3 * x0;
+                        const uchar* b = in_.ptr<uchar>(y) + 3 * x0;
+                        int row = 0;
+                        for (int x = 0; x < n; ++x) row += std::abs(a[x] - b[x]);
+                        sad += row;
+                    }
+                    changed = (double)sad > cfg_.noise * n * (y1 - y0);
+                }
+                if (!changed) continue;
+                mask[(size_t)j * tx_ + i] = 1;
+                for (int y = y0; y < y1; ++y)
+                    std::memcpy(in_.ptr<uchar>(y) + 3 * x0, src.ptr<uchar>(y) + 3 * x0, (size_t)n);
+            }
+        }
+    });
+}
+
+// Runs of dirty tiles along each tile row, clipped to the frame
+void IncrementalCpuPipeline::tileRects(const std::vector<uchar>& mask, std::vector<cv::Rect>& rects) const {
+    const int T = cfg_.tile;
+    const cv::Rect frame(0, 0, size_.width, size_.height);
+    rects.clear();
+    for (int j = 0; j < ty_; ++j) {
+        const uchar* m = &mask[(size_t)j * tx_];
+        for (int i = 0; i < tx_;) {
+            if (!m[i]) { ++i; continue; }
+            int e = i + 1;
+            while (e < tx_ && m[e]) ++e;
+            rects.push_back(cv::Rect(i * T, j * T, (e - i) * T, T) & frame);
+            i = e;
+        }
+    }
+}
+
+const cv::Mat& IncrementalCpuPipeline::process(const cv::Mat& src, const FilterGraph& graph) {
+    if (src.empty()) { reset(); return in_; }
+    CV_Assert(src.type() == CV_8UC3);
+
+    std::vector<uchar> mask;
+    const bool full = !valid_ || src.size() != size_ || graph != graph_;
+    if (full) {
+        rebuild(src, graph);
+        mask.assign((size_t)tx_ * ty_, 1);
+    }
+    else {
+        markChangedTiles(src, mask);
+    }
+
+    // Output tile t of a pass is dirty if any input tile in reach_[k][t] is: box sums over a
+    // summed-area table of the input mask
+    std::vector<int> sat((size_t)(tx_ + 1) * (ty_ + 1));
+    std::vector<uchar> next;
+    std::vector<cv::Rect> rects;
+    const cv::Mat* in = &in_;
+    for (size_t k = 0; k < plan_.passes.size(); ++k) {
+        if (!full) {
+            for (int j = 0; j < ty_; ++j)
+                for (int i = 0; i < tx_; ++i)
+                    sat[(size_t)(j + 1) * (tx_ + 1) + i + 1] = mask[(size_t)j * tx_ + i]
+                        + sat[(size_t)j * (tx_ + 1) + i + 1] + sat[(size_t)(j + 1) * (tx_ + 1) + i] - sat[(size_t)j * (tx_ + 1) + i];
+            next.assign(mask.size(), 0);
+            for (size_t t = 0; t < next.size(); ++t) {
+                const cv::Rect& r = reach_[k][t];
+                if (r.empty()) continue;
+                const int x0 = r.x, y0 = r.y, x1 = r.x + r.width, y1 = r.y + r.height;
+                next[t] = sat[(size_t)y1 * (tx_ + 1) + x1] - sat[(size_t)y0 * (tx_ + 1) + x1]
+                    - sat[(size_t)y1 * (tx_ + 1) + x0] + sat[(size_t)y0 * (tx_ + 1) + x0] > 0;
+            }
+            mask.swap(next);
+        }
+        tileRects(mask, rects);
+        runCpuPass(graph_, plan_.passes[k], *in, out_[k], rects);
+        in = &out_[k];
+    }
+
+    tileRects(mask, dirty_);
+    dirtyFraction_ = (double)std::count(mask.begin(), mask.end(), (uchar)1) / mask.size();
+    return *in;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include "filter_graph.hpp"
+
+struct IncrementalConfig {
+    int    tile = 64;                   // dirty-tracking granularity, pixels
+    double noise = 0.0;                 // a tile changed if its mean absolute difference per
+                                        // channel exceeds this; 0 = any changed byte
+};
+
+// processCpuFrame for streams where most of the frame stays put (static camera, screen
+// capture). The input is compared tile by tile with the last accepted frame; only changed
+// tiles are copied in, and every planned pass recomputes just the output tiles whose
+// footprint (cpuPassFootprint) touches a tile its input changed, into buffers kept from the
+// previous frame. A new frame size or graph reprocesses everything. With noise == 0 the output
+// is identical to processCpuFrame; with noise > 0 sub-threshold changes are held back until
+// they add up past the threshold.
+class IncrementalCpuPipeline {
+public:
+    explicit IncrementalCpuPipeline(const IncrementalConfig& cfg = {});
+
+    // Filtered frame, valid until the next call (the buffer is reused and updated in place)
+    const cv::Mat& process(const cv::Mat& src, const FilterGraph& graph);
+
+    // Output regions the last process() rewrote: disjoint, tile aligned, clipped to the frame
+    const std::vector<cv::Rect>& dirtyRects() const { return dirty_; }
+    double dirtyFraction() const { return dirtyFraction_; }
+
+    void reset();                       // next frame is processed in full
+
+private:
+    void rebuild(const cv::Mat& src, const FilterGraph& graph);
+    void markChangedTiles(const cv::Mat& src, std::vector<uchar>& mask);
+    void tileRects(const std::vector<uchar>& mask, std::vector<cv::Rect>& rects) const;
+
+    IncrementalConfig cfg_;
+    FilterGraph graph_;
+    FilterPlan plan_;
+    cv::Size size_;
+    int tx_ = 0, ty_ = 0;               // tile grid
+    bool valid_ = false;
+    cv::Mat in_;                        // last accepted input
+    std::vector<cv::Mat> out_;          // per pass output
+    std::vector<std::vector<cv::Rect>> reach_;  // per pass and output tile: input tiles read
+                                        // (x, y, width, height in tile units)
+    std::vector<cv::Rect> dirty_;
+    double dirtyFraction_ = 0.0;
+};
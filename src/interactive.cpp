@@ -1,8 +1,20 @@
 #include "gl_utils.hpp"
+#include "pbo_uploader.hpp"
+#include "pbo_readback.hpp"
+#include "gpu_timer.hpp"
+#include "shader_cache.hpp"
 #include "gpu_pipeline.hpp"
 #include "cv_filters.hpp"
 #include "cv_geom.hpp"
+#include "cpu_pipeline.hpp"
+#include "incremental_pipeline.hpp"
+#include "thread_pool.hpp"
+#include "frame_ring.hpp"
+#include "frame_pool.hpp"
 #include "timing.hpp"
+#include "benchmark.hpp"
+#include "video_recorder.hpp"
+#include "frame_source.hpp"
 
 #include <opencv2/opencv.hpp>
 #include <glad/glad.h>
@@ -10,47 +22,126 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <exception>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 // ------------------ Utility Functions ------------------
-static void ensureBGR(cv::Mat& img) {
-    if (img.empty()) return;
-    if (img.type() == CV_8UC3) {
-        if (!img.isContinuous()) img = img.clone();
-        return;
-    }
-    cv::Mat out;
-    if (img.type() == CV_8UC4)      cv::cvtColor(img, out, cv::COLOR_BGRA2BGR);
-    else if (img.type() == CV_8UC1) cv::cvtColor(img, out, cv::COLOR_GRAY2BGR);
-    else if (img.type() == CV_8UC2) {
-        try { cv::cvtColor(img, out, cv::COLOR_YUV2BGR_YUY2); }
-        catch (...) { cv::cvtColor(img, out, cv::COLOR_GRAY2BGR); }
-    }
-    else                           img.convertTo(out, CV_8UC3);
-    if (!out.isContinuous()) out = out.clone();
-    img = out;
-}
-
-static std::string filterName(FilterType f) {
-    switch (f) {
-    case FilterType::None:     return "None";
-    case FilterType::Pixelate: return "Pixelate";
-    case FilterType::SinCity:  return "SinCity";
-    default:                   return "Unknown";
-    }
+static std::string fmtMs(double us) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.1f", us * 1e-3);
+    return buf;
 }
 
-static void setTitle(GLFWwindow* w, bool gpu, FilterType f, bool T, double fps) {
+static void setTitle(GLFWwindow* w, bool gpu, const FilterChain& f, bool T, double fps,
+    const StageTimings& tm, uint64_t dropped, const VideoRecorder* rec, uint64_t readbackDropped) {
+    StageSummary fr = tm.summary("frame");
+    StageSummary lat = tm.summary("latency");
     std::string s = std::string("[Interactive] ")
         + "Mode=" + (gpu ? "GPU" : "CPU")
-        + " | Filter=" + filterName(f)
+        + " | Filter=" + chainName(f)
         + " | Transform=" + (T ? "ON" : "OFF")
-        + " | FPS=" + std::to_string((int)std::round(fps));
+        + " | FPS=" + std::to_string((int)std::round(fps))
+        + " | frame p50/p99/max=" + fmtMs(fr.p50_us) + "/" + fmtMs(fr.p99_us) + "/" + fmtMs(fr.max_us) + "ms"
+        + " | p99 cap/proc/upl/draw/swap="
+        + fmtMs(tm.summary("capture").p99_us) + "/" + fmtMs(tm.summary("process").p99_us) + "/"
+        + fmtMs(tm.summary("upload").p99_us) + "/" + fmtMs(tm.summary("render").p99_us) + "/"
+        + fmtMs(tm.summary("swap").p99_us) + "ms"
+        + " | latency p50/p99=" + fmtMs(lat.p50_us) + "/" + fmtMs(lat.p99_us) + "ms"
+        + " | GPU upl/draw/hud=" + fmtMs(tm.summary("gpu upload").p50_us) + "/"
+        + fmtMs(tm.summary("gpu draw").p50_us) + "/" + fmtMs(tm.summary("gpu hud").p50_us) + "ms"
+        + " | dropped=" + std::to_string(dropped);
+    if (rec) s += " | REC dropped=" + std::to_string(rec->stats().dropped + readbackDropped);
     glfwSetWindowTitle(w, s.c_str());
 }
 
+// ------------------ Pipeline Stages ------------------
+using FrameClock = std::chrono::steady_clock;
+
+static uint64_t elapsedNs(FrameClock::time_point since) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(FrameClock::now() - since).count();
+    return ns > 0 ? (uint64_t)ns : 0;
+}
+
+// Settings edited by the keyboard on the render thread, read by the processing thread
+struct ViewParams {
+    bool useGPU = true, useTransform = true;
+    FilterChain filters = { FilterType::Pixelate };
+    FilterParams fp;
+    AffineParams ap;
+};
+
+struct CapturedFrame {
+    cv::Mat frame;                 // BGR, or the source's YUV layout with --yuv
+    FrameClock::time_point t0;     // capture start, for end-to-end latency
+    uint64_t captureNs = 0;
+};
+
+struct ProcessedFrame {
+    cv::Mat frame;                 // uploaded as GL_BGR (or as the YUV textures), no conversion
+    FrameFormat format = FrameFormat::BGR;
+    bool cpuProcessed = false;     // filtered + warped on the CPU: draw untransformed
+    FrameClock::time_point t0;
+    uint64_t captureNs = 0, processNs = 0;
+    // Incremental CPU frames: frame differs from frame baseSeq only inside dirty (0 = unknown)
+    uint64_t seq = 0, baseSeq = 0;
+    std::vector<cv::Rect> dirty;
+};
+
+// Hands the incremental pipeline's output (updated in place, valid until its next frame) to
+// the render thread without copying the whole frame every time. Each frame goes out in one of
+// a few buffers that only this class writes; a buffer is reused once nothing downstream (ring,
+// upload, recorder) references it any more, and brought up to date by copying just the regions
+// that changed since the frame it last carried.
+class IncrementalHandoff {
+public:
+    // Buffer holding out, the pipeline output of frame seq (seqs are consecutive) which differs
+    // from the previous one only inside dirty
+    cv::Mat publish(const cv::Mat& out, const std::vector<cv::Rect>& dirty, uint64_t seq) {
+        history_.push_back({ seq, dirty });
+        if (history_.size() > kHistory) history_.pop_front();
+
+        // Of the free buffers, the one with the newest frame has the least to catch up on
+        Slot* slot = nullptr;
+        for (Slot& s : slots_)
+            if (s.buf.u && CV_XADD(&s.buf.u->refcount, 0) == 1 && (!slot || s.seq > slot->seq)) slot = &s;
+        if (!slot) {
+            if (slots_.size() == kMaxSlots) return out.clone();     // all in flight
+            slots_.emplace_back();
+            slot = &slots_.back();
+        }
+
+        const bool patch = slot->seq && slot->buf.size() == out.size() && slot->buf.type() == out.type()
+            && history_.front().first <= slot->seq + 1;
+        if (!patch) out.copyTo(slot->buf);
+        else {
+            for (const auto& h : history_)
+                if (h.first > slot->seq)
+                    for (const cv::Rect& r : h.second) {
+                        cv::Mat roi = slot->buf(r);
+                        out(r).copyTo(roi);
+                    }
+        }
+        slot->seq = seq;
+        return slot->buf;
+    }
+
+private:
+    static constexpr size_t kMaxSlots = 4, kHistory = 8;
+    struct Slot { cv::Mat buf; uint64_t seq = 0; };
+    std::deque<Slot> slots_;                    // deque: growing keeps slot addresses
+    std::deque<std::pair<uint64_t, std::vector<cv::Rect>>> history_;   // dirty regions per seq
+};
+
 // ---------- Generate HUD texture using OpenCV text drawing ----------
 static cv::Mat makeHudBGRA(int w, int h, int scale = 1) {
     // Semi-transparent black background
@@ -67,7 +158,7 @@ static cv::Mat makeHudBGRA(int w, int h, int scale = 1) {
     int y = 24;
     y = put(y, "Controls");
     y = put(y, "G: Toggle GPU/CPU");
-    y = put(y, "1/2/3: None / Pixelate / SinCity");
+    y = put(y, "1-4: None/Pixelate/SinCity/Both");
     y = put(y, "T: Toggle Transform (Affine)");
     y = put(y, "Arrows: Translate (tx, ty)");
     y = put(y, "Q/E: Rotate");
@@ -146,15 +237,23 @@ struct HudQuad {
 };
 
 // ------------------ Interactive Demonstration ------------------
-static void interactive_mode() {
-    // Camera initialization (DSHOW + MJPG is more stable on Windows)
-    cv::VideoCapture cap(0, cv::CAP_DSHOW);
-    if (!cap.isOpened()) { std::cerr << "Camera open failed.\n"; return; }
-    cap.set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'));
-
-    cv::Mat frame; cap >> frame; if (frame.empty()) { std::cerr << "First frame empty.\n"; return; }
-    ensureBGR(frame);
-    int texW = frame.cols, texH = frame.rows;
+// sourceCfg: where frames come from (camera by default, see parseFrameSource). With yuv, frames
+//      of a YUV source (I420 Y4M, YUYV / NV12 camera) stay YUV: the GPU path uploads them as they
+//      are and converts in the shader, the CPU path filters I420 with processCpuFrameI420 and
+//      converts the others to BGR first
+// incremental: CPU frames go through IncrementalCpuPipeline and upload only changed tiles
+// record: also write the processed output (without the HUD) to a video file
+static void interactive_mode(const SourceConfig& sourceCfg, const IncrementalConfig* incremental, const RecorderConfig* record) {
+    std::string sourceErr;
+    std::unique_ptr<FrameSource> source = openFrameSource(sourceCfg, sourceErr);
+    if (!source) { std::cerr << "[Source] " << sourceErr << "\n"; return; }
+    std::cout << "[Source] " << source->describe() << std::endl;
+    const FrameFormat input = sourceCfg.yuv && isYuvFormat(source->format()) ? source->format() : FrameFormat::BGR;
+    if (sourceCfg.yuv && input == FrameFormat::BGR)
+        std::cout << "[Source] --yuv: the source delivers no I420 / NV12 / YUYV frames; they are converted to BGR" << std::endl;
+    int texW = source->size().width, texH = source->size().height;
+    // Files play at their own rate (or --source-fps), cameras are paced by the device
+    const double pace = sourceCfg.pace >= 0.0 ? sourceCfg.pace : source->fps();
 
     // Initialize OpenGL context
     if (!glfwInit()) { std::cerr << "glfwInit failed\n"; return; }
@@ -174,116 +273,283 @@ static void interactive_mode() {
 
     // GPU pipeline + simple pass-through shader
     GpuPipeline gpu; if (!gpu.init("shaders")) { std::cerr << "Shader init failed.\n"; return; }
-    GLuint passProg = glutils::loadShaderProgram("shaders/passthrough.vert", "shaders/passthrough.frag");
+    GLuint passProg = gpu.passthroughProgram();
     GLint loc_uTex_pass = glGetUniformLocation(passProg, "uTex");
     GLint loc_uAff_pass = glGetUniformLocation(passProg, "uAffine");
+    std::cout << "[Shaders] " << glutils::programCache().summary() << std::endl;
 
-    // Texture for video frames
-    GLuint texVid = glutils::createTexture2D(texW, texH, GL_RGB);
-    glBindTexture(GL_TEXTURE_2D, texVid);
-    float border[4] = { 0,0,0,1 };
-    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    // Texture(s) for video frames, clamped to a black border
+    glutils::FrameTextures texVid = glutils::createFrameTextures(texW, texH, input);
 
     // HUD texture (generated once)
     cv::Mat hudImg = makeHudBGRA(360, 220);
     GLuint texHUD = createHudTextureFromMat(hudImg);
     HudQuad hud; hud.init();
 
-    // State variables
-    bool useGPU = true, useTransform = true;
-    FilterType curF = FilterType::Pixelate;
-    FilterParams fp; fp.pixelBlock = 8; fp.keepBGR = { 20,20,200 }; fp.thresh = 60;
-    AffineParams ap; ap.tx = 0; ap.ty = 0; ap.scale = 1.f; ap.thetaDeg = 0.f;
+    // Streaming texture upload (PBO ring with fences)
+    glutils::PboUploader uploader;
+    uploader.init(texW, texH, 3, input);
+    std::cout << "[Upload] " << uploader.modeName();
+    if (input != FrameFormat::BGR) std::cout << ", " << frameFormatName(input) << " (converted in the shader)";
+    std::cout << std::endl;
+
+    // Recording: GPU frames are drawn into a frame-size target, shown by a blit and read back
+    // from it asynchronously through a PBO ring, so they come out at the size of CPU frames,
+    // which are queued as they are; a background thread encodes them
+    std::unique_ptr<VideoRecorder> recorder;
+    glutils::PboReadback readback;
+    GLuint recFbo = 0, recTex = 0;
+    int recW = 0, recH = 0;
+    if (record) {
+        recorder = std::make_unique<VideoRecorder>(*record);
+        readback.init(texW, texH);
+        std::cout << "[Record] " << record->path << (readback.async() ? " (async readback)" : " (sync readback)") << std::endl;
+    }
+
+    // UI state, owned by this (render) thread and published to the processing thread
+    ViewParams view;
+    view.fp.pixelBlock = 8; view.fp.keepBGR = { 20,20,200 }; view.fp.thresh = 60;
+    AffineParams& ap = view.ap;
+    FilterParams& fp = view.fp;
+    AtomicSnapshot<ViewParams> params(view);
 
-    bool lockG = false, lockT = false, lock1 = false, lock2 = false, lock3 = false;
+    uint64_t uploadedSeq = 0;      // incremental frame the video texture holds, 0 = other content
+    bool lockG = false, lockT = false, lock1 = false, lock2 = false, lock3 = false, lock4 = false;
     FpsAverager fpsAvg(120);
 
+    // Per-stage latency histograms, restarted every couple of seconds so the title
+    // readout follows the current mode instead of the whole session.
+    // capture/process are measured on their threads and recorded here with the frame.
+    StageTimings timings;
+    StageStat& stCapture = timings.stage("capture");
+    StageStat& stProcess = timings.stage("process");
+    StageStat& stUpload = timings.stage("upload");
+    StageStat& stRender = timings.stage("render");
+    StageStat& stSwap = timings.stage("swap");
+    StageStat& stFrame = timings.stage("frame");
+    StageStat& stLatency = timings.stage("latency");
+    // GPU execution time (timestamp queries, read back a few frames later)
+    StageStat& stGpuUpload = timings.stage("gpu upload");
+    StageStat& stGpuDraw = timings.stage("gpu draw");
+    StageStat& stGpuHud = timings.stage("gpu hud");
+    glutils::GpuTimer gpuTimer;
+    gpuTimer.init();
+    double statsResetAt = glfwGetTime() + 2.0;
+    double nextKeyStep = 0.0;
+
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    while (!glfwWindowShouldClose(win)) {
+    // Capture -> process -> render, connected by SPSC rings. Each consumer takes the newest
+    // frame and drops older ones, so a slow stage never builds up latency.
+    SpscRing<CapturedFrame, 4> capRing;
+    SpscRing<ProcessedFrame, 4> outRing;
+    std::atomic<bool> running{ true };
+    std::exception_ptr workerError;
+    std::mutex workerErrorMutex;
+    auto guarded = [&](auto body) {
+        return [&, body] {
+            try { body(); }
+            catch (...) {
+                std::lock_guard<std::mutex> lk(workerErrorMutex);
+                if (!workerError) workerError = std::current_exception();
+                running = false;
+            }
+        };
+    };
+
+    // Stops and joins the workers however the render loop ends: if it throws (shader link,
+    // upload, recorder), a std::thread destroyed while still joinable would call std::terminate
+    struct Workers {
+        std::atomic<bool>& running;
+        std::vector<std::thread> threads;
+        void join() {
+            running = false;
+            for (std::thread& t : threads) if (t.joinable()) t.join();
+        }
+        ~Workers() { join(); }
+    } workers{ running, {} };
+
+    workers.threads.emplace_back(guarded([&] {
+        const auto period = std::chrono::duration_cast<FrameClock::duration>(
+            std::chrono::duration<double>(pace > 0.0 ? 1.0 / pace : 0.0));
+        auto due = FrameClock::now();
+        while (running.load(std::memory_order_relaxed)) {
+            CapturedFrame cf;
+            cf.t0 = FrameClock::now();
+            // Mapped and corpus frames arrive as headers into the source, without a copy
+            const bool got = input != FrameFormat::BGR ? source->read(cf.frame) : source->readBGR(cf.frame);
+            if (!got || cf.frame.empty()) { std::this_thread::sleep_for(std::chrono::milliseconds(1)); continue; }
+            cf.captureNs = elapsedNs(cf.t0);
+            capRing.pushOrDrop(std::move(cf));
+            if (period.count() > 0) {
+                due += period;
+                const auto now = FrameClock::now();
+                if (due + period < now) due = now;     // fell behind: do not burst to catch up
+                else std::this_thread::sleep_until(due);
+            }
+        }
+    }));
+
+    workers.threads.emplace_back(guarded([&] {
+        IncrementalCpuPipeline inc(incremental ? *incremental : IncrementalConfig{});
+        IncrementalHandoff handoff;
+        uint64_t seq = 0, lastIncSeq = 0;
+        while (running.load(std::memory_order_relaxed)) {
+            CapturedFrame cf;
+            if (!capRing.popLatest(cf)) { std::this_thread::sleep_for(std::chrono::microseconds(200)); continue; }
+
+            std::shared_ptr<const ViewParams> vp = params.load();
+            ProcessedFrame pf;
+            pf.t0 = cf.t0;
+            pf.captureNs = cf.captureNs;
+            const auto t1 = FrameClock::now();
+            if (vp->useGPU) {
+                pf.frame = cf.frame;
+                pf.format = input;
+            }
+            else if (incremental) {
+                // Tile diffing works on BGR
+                cv::Mat bgr;
+                frameToBGR(cf.frame, input, bgr);
+                // The pipeline keeps updating its own buffers; the ring gets a handoff buffer
+                const cv::Mat& out = inc.process(bgr, buildFilterGraph(vp->filters, vp->fp, vp->useTransform ? vp->ap : AffineParams{}));
+                pf.dirty = inc.dirtyRects();
+                pf.seq = ++seq;
+                pf.frame = handoff.publish(out, pf.dirty, pf.seq);
+                pf.baseSeq = lastIncSeq;
+                pf.cpuProcessed = true;
+            }
+            else {
+                const FilterGraph graph = buildFilterGraph(vp->filters, vp->fp, vp->useTransform ? vp->ap : AffineParams{});
+                if (input == FrameFormat::I420) processCpuFrameI420(cf.frame, pf.frame, graph);
+                else {
+                    cv::Mat bgr;
+                    frameToBGR(cf.frame, input, bgr);
+                    processCpuFrame(bgr, pf.frame, graph);
+                }
+                pf.cpuProcessed = true;
+            }
+            lastIncSeq = pf.seq;
+            pf.processNs = elapsedNs(t1);
+            outRing.pushOrDrop(std::move(pf));
+        }
+    }));
+
+    while (!glfwWindowShouldClose(win) && running.load(std::memory_order_relaxed)) {
         glfwPollEvents();
         if (glfwGetKey(win, GLFW_KEY_ESCAPE) == GLFW_PRESS)
             glfwSetWindowShouldClose(win, GLFW_TRUE);
 
         // Keyboard control logic (toggle switches)
-        if (glfwGetKey(win, GLFW_KEY_G) == GLFW_PRESS) { if (!lockG) { useGPU = !useGPU; lockG = true; } }
+        if (glfwGetKey(win, GLFW_KEY_G) == GLFW_PRESS) { if (!lockG) { view.useGPU = !view.useGPU; lockG = true; } }
         else lockG = false;
-        if (glfwGetKey(win, GLFW_KEY_T) == GLFW_PRESS) { if (!lockT) { useTransform = !useTransform; lockT = true; } }
+        if (glfwGetKey(win, GLFW_KEY_T) == GLFW_PRESS) { if (!lockT) { view.useTransform = !view.useTransform; lockT = true; } }
         else lockT = false;
-        if (glfwGetKey(win, GLFW_KEY_1) == GLFW_PRESS) { if (!lock1) { curF = FilterType::None; lock1 = true; } }
+        if (glfwGetKey(win, GLFW_KEY_1) == GLFW_PRESS) { if (!lock1) { view.filters = { FilterType::None }; lock1 = true; } }
         else lock1 = false;
-        if (glfwGetKey(win, GLFW_KEY_2) == GLFW_PRESS) { if (!lock2) { curF = FilterType::Pixelate; lock2 = true; } }
+        if (glfwGetKey(win, GLFW_KEY_2) == GLFW_PRESS) { if (!lock2) { view.filters = { FilterType::Pixelate }; lock2 = true; } }
         else lock2 = false;
-        if (glfwGetKey(win, GLFW_KEY_3) == GLFW_PRESS) { if (!lock3) { curF = FilterType::SinCity; lock3 = true; } }
+        if (glfwGetKey(win, GLFW_KEY_3) == GLFW_PRESS) { if (!lock3) { view.filters = { FilterType::SinCity }; lock3 = true; } }
         else lock3 = false;
+        if (glfwGetKey(win, GLFW_KEY_4) == GLFW_PRESS) { if (!lock4) { view.filters = { FilterType::SinCity, FilterType::Pixelate }; lock4 = true; } }
+        else lock4 = false;
+
+        // Held keys step, and the settings are published, at a fixed rate: the loop also
+        // turns while it waits for a frame, so this must not depend on the frame rate
+        const double now = glfwGetTime();
+        if (now >= nextKeyStep) {
+            nextKeyStep = now + 1.0 / 60.0;
+
+            // Translation / rotation / scaling controls
+            float tStep = 5.f, rStep = 0.6f, sStep = 0.02f;
+            if (glfwGetKey(win, GLFW_KEY_LEFT) == GLFW_PRESS) ap.tx -= tStep;
+            if (glfwGetKey(win, GLFW_KEY_RIGHT) == GLFW_PRESS) ap.tx += tStep;
+            if (glfwGetKey(win, GLFW_KEY_UP) == GLFW_PRESS) ap.ty -= tStep;
+            if (glfwGetKey(win, GLFW_KEY_DOWN) == GLFW_PRESS) ap.ty += tStep;
+            if (glfwGetKey(win, GLFW_KEY_Q) == GLFW_PRESS) ap.thetaDeg -= rStep;
+            if (glfwGetKey(win, GLFW_KEY_E) == GLFW_PRESS) ap.thetaDeg += rStep;
+            if (glfwGetKey(win, GLFW_KEY_MINUS) == GLFW_PRESS) ap.scale = std::max(0.1f, ap.scale - sStep);
+            if (glfwGetKey(win, GLFW_KEY_EQUAL) == GLFW_PRESS) ap.scale += sStep;
+
+            // Filter parameter adjustment
+            if (glfwGetKey(win, GLFW_KEY_Z) == GLFW_PRESS) fp.pixelBlock = std::max(2, fp.pixelBlock - 1);
+            if (glfwGetKey(win, GLFW_KEY_X) == GLFW_PRESS) fp.pixelBlock = std::min(100, fp.pixelBlock + 1);
+            if (glfwGetKey(win, GLFW_KEY_C) == GLFW_PRESS) fp.thresh = std::max(0, fp.thresh - 1);
+            if (glfwGetKey(win, GLFW_KEY_V) == GLFW_PRESS) fp.thresh = std::min(255, fp.thresh + 1);
+
+            // Hand the new settings to the processing thread
+            params.store(view);
+        }
 
-        // Translation / rotation / scaling controls
-        float tStep = 5.f, rStep = 0.6f, sStep = 0.02f;
-        if (glfwGetKey(win, GLFW_KEY_LEFT) == GLFW_PRESS) ap.tx -= tStep;
-        if (glfwGetKey(win, GLFW_KEY_RIGHT) == GLFW_PRESS) ap.tx += tStep;
-        if (glfwGetKey(win, GLFW_KEY_UP) == GLFW_PRESS) ap.ty -= tStep;
-        if (glfwGetKey(win, GLFW_KEY_DOWN) == GLFW_PRESS) ap.ty += tStep;
-        if (glfwGetKey(win, GLFW_KEY_Q) == GLFW_PRESS) ap.thetaDeg -= rStep;
-        if (glfwGetKey(win, GLFW_KEY_E) == GLFW_PRESS) ap.thetaDeg += rStep;
-        if (glfwGetKey(win, GLFW_KEY_MINUS) == GLFW_PRESS) ap.scale = std::max(0.1f, ap.scale - sStep);
-        if (glfwGetKey(win, GLFW_KEY_EQUAL) == GLFW_PRESS) ap.scale += sStep;
-
-        // Filter parameter adjustment
-        if (glfwGetKey(win, GLFW_KEY_Z) == GLFW_PRESS) fp.pixelBlock = std::max(2, fp.pixelBlock - 1);
-        if (glfwGetKey(win, GLFW_KEY_X) == GLFW_PRESS) fp.pixelBlock = std::min(100, fp.pixelBlock + 1);
-        if (glfwGetKey(win, GLFW_KEY_C) == GLFW_PRESS) fp.thresh = std::max(0, fp.thresh - 1);
-        if (glfwGetKey(win, GLFW_KEY_V) == GLFW_PRESS) fp.thresh = std::min(255, fp.thresh + 1);
-
-        // Capture camera frame
-        cap >> frame; if (frame.empty()) continue; ensureBGR(frame);
-        if (frame.cols != texW || frame.rows != texH) {
-            texW = frame.cols; texH = frame.rows;
-            glDeleteTextures(1, &texVid);
-            texVid = glutils::createTexture2D(texW, texH, GL_RGB);
-            glBindTexture(GL_TEXTURE_2D, texVid);
-            float border2[4] = { 0,0,0,1 };
-            glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border2);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-            glBindTexture(GL_TEXTURE_2D, 0);
+        // Wait for the next processed frame without spinning
+        ProcessedFrame pf;
+        if (!outRing.popLatest(pf)) { glfwWaitEventsTimeout(0.001); continue; }
+        ScopedTimer frameTimer(stFrame);
+        gpuTimer.beginFrame();
+        stCapture.recordNs(pf.captureNs);
+        stProcess.recordNs(pf.processNs);
+
+        // GPU frames of a YUV source and CPU output (BGR) alternate on a mode switch
+        const cv::Size frameSize = framePixelSize(pf.frame, pf.format);
+        if (frameSize != cv::Size(texW, texH) || pf.format != texVid.format) {
+            texW = frameSize.width; texH = frameSize.height;
+            glutils::deleteFrameTextures(texVid);
+            texVid = glutils::createFrameTextures(texW, texH, pf.format);
+            uploadedSeq = 0;
         }
 
-        // Upload and process
-        if (!useGPU) {
-            cv::Mat img = frame.clone();
-            if (useTransform) warpCpuAffine(img, ap);
-            applyCpuFilter(img, curF, fp);
-            glutils::uploadFrameToTexture(texVid, img);
+        // Upload: BGR or YUV frames through the PBO ring (re-inits itself on a size or layout
+        // change). An incremental frame built on the one in the texture only needs its dirty tiles.
+        {
+            ScopedTimer t(stUpload);
+            glutils::GpuScope g(gpuTimer, stGpuUpload);
+            if (pf.seq && uploadedSeq && pf.baseSeq == uploadedSeq) uploader.uploadRects(texVid.tex, pf.frame, pf.dirty);
+            else                                                   uploader.upload(texVid, pf.frame);
+            uploadedSeq = pf.seq;
         }
-        else {
-            glutils::uploadFrameToTexture(texVid, frame);
+
+        // Reads of earlier GPU frames that have completed by now go to the encoder
+        if (recorder) {
+            cv::Mat done;
+            while (readback.collect(done)) recorder->push(done);
         }
 
         // Main frame rendering
+        ScopedTimer renderTimer(stRender);
         int fbW, fbH; glfwGetFramebufferSize(win, &fbW, &fbH);
         glViewport(0, 0, fbW, fbH);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        if (useGPU) {
-            gpu.draw(fsqVAO, texVid, texW, texH, curF, fp, useTransform ? ap : AffineParams{});
+        // Frames processed before a mode switch are still drawn the way they were produced
+        gpuTimer.begin(stGpuDraw);
+        const bool recordGpu = recorder && !pf.cpuProcessed;
+        if (recordGpu) {
+            if (!recTex || recW != texW || recH != texH) {
+                glDeleteFramebuffers(1, &recFbo);
+                glDeleteTextures(1, &recTex);
+                recTex = glutils::createTexture2D(texW, texH, GL_RGB);
+                glGenFramebuffers(1, &recFbo);
+                glBindFramebuffer(GL_FRAMEBUFFER, recFbo);
+                glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, recTex, 0);
+                recW = texW; recH = texH;
+            }
+            glBindFramebuffer(GL_FRAMEBUFFER, recFbo);
+            glViewport(0, 0, texW, texH);
+            glClear(GL_COLOR_BUFFER_BIT);
+        }
+        if (!pf.cpuProcessed) {
+            gpu.draw(fsqVAO, texVid, texW, texH, buildFilterGraph(view.filters, fp, view.useTransform ? ap : AffineParams{}));
         }
         else {
             glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, texVid);
+            glBindTexture(GL_TEXTURE_2D, texVid.tex);
             glUseProgram(passProg);
             if (loc_uTex_pass >= 0) glUniform1i(loc_uTex_pass, 0);
 
-            cv::Matx33f M = affineMatrix(useTransform ? ap : AffineParams{}, texW, texH);
-            glm::mat3 gM(
-                M(0, 0), M(1, 0), M(2, 0),
-                M(0, 1), M(1, 1), M(2, 1),
-                M(0, 2), M(1, 2), M(2, 2)
-            );
-            if (loc_uAff_pass >= 0) glUniformMatrix3fv(loc_uAff_pass, 1, GL_FALSE, glm::value_ptr(gM));
+            // The CPU frame is already warped: display it untransformed
+            glm::mat3 I(1.0f);
+            if (loc_uAff_pass >= 0) glUniformMatrix3fv(loc_uAff_pass, 1, GL_FALSE, glm::value_ptr(I));
 
             glBindVertexArray(fsqVAO);
             glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
@@ -291,8 +557,33 @@ static void interactive_mode() {
             glUseProgram(0);
             glBindTexture(GL_TEXTURE_2D, 0);
         }
+        if (recordGpu) {
+            // Show the recorded frame, stretched to the window like a direct draw
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, recFbo);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+            glBlitFramebuffer(0, 0, texW, texH, 0, 0, fbW, fbH, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        }
+        gpuTimer.end();
+
+        // Record the frame before the HUD goes on top. A CPU frame is already in memory and
+        // is handed over without a copy (the processing thread never writes a frame that is
+        // still referenced); pending GPU reads are flushed first so frames stay in order
+        // across a mode switch.
+        if (recorder) {
+            if (recordGpu) {
+                readback.capture(0, 0, texW, texH);     // from recFbo, still bound for reading
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                glViewport(0, 0, fbW, fbH);
+            }
+            else {
+                cv::Mat done;
+                while (readback.collect(done, true)) recorder->push(done);
+                recorder->push(pf.frame);
+            }
+        }
 
         // Draw HUD (in screen space, top-left, unaffected by affine transform)
+        gpuTimer.begin(stGpuHud);
         glUseProgram(passProg);
         if (loc_uTex_pass >= 0) glUniform1i(loc_uTex_pass, 0);
         // uAffine = I (identity matrix) so HUD remains static
@@ -304,19 +595,131 @@ static void interactive_mode() {
 
         hud.update(fbW, fbH, /*x*/8, /*y*/8, /*w*/hudImg.cols, /*h*/hudImg.rows);
         hud.draw();
+        gpuTimer.end();
+
+        renderTimer.stop();
 
         // Update window title and FPS counter
-        setTitle(win, useGPU, curF, useTransform, fpsAvg.tick());
-        glfwSwapBuffers(win);
+        setTitle(win, view.useGPU, view.filters, view.useTransform, fpsAvg.tick(), timings,
+            capRing.dropped() + outRing.dropped(), recorder.get(), readback.dropped());
+        {
+            ScopedTimer t(stSwap);
+            glfwSwapBuffers(win);
+        }
+        frameTimer.stop();
+        stLatency.recordNs(elapsedNs(pf.t0));
+        if (glfwGetTime() > statsResetAt) { timings.resetAll(); statsResetAt = glfwGetTime() + 2.0; }
     }
 
-    glDeleteTextures(1, &texVid);
+    workers.join();
+
+    if (recorder) {
+        cv::Mat done;
+        while (readback.collect(done, true)) recorder->push(done);
+        recorder->stop();
+        std::cout << "[Record] " << recorder->summary() << ", " << readback.dropped() << " dropped (readback)" << std::endl;
+    }
+    readback.release();
+    glDeleteFramebuffers(1, &recFbo);
+    glDeleteTextures(1, &recTex);
+    gpuTimer.release();
+    uploader.release();
+    glutils::deleteFrameTextures(texVid);
     glDeleteTextures(1, &texHUD);
     glfwDestroyWindow(win);
     glfwTerminate();
+    if (workerError) std::rethrow_exception(workerError);
 }
 
-int main() {
-    interactive_mode();
-    return 0;
+static const char* kUsage =
+    "Usage: VisualComputing_2 [--bench | --bench-headless] [--threads N] [--pin-cores]\n"
+    "                         [--no-frame-pool] [--no-huge-pages] [--no-pbo] [--no-shader-cache]\n"
+    "                         [--incremental] [--tile N] [--dirty-noise X]\n"
+    "                         [--record FILE] [--record-fps N] [--record-fourcc CODE]\n"
+    "                         [--source SPEC] [--source-fps N] [--yuv]   (default source camera:0)\n"
+    "                         [--bench-config FILE] [--matrix key=value ...]\n"
+    "                         [--gl-backend window|egl|osmesa]   (no mode = interactive)\n";
+
+int main(int argc, char** argv) {
+    std::string mode;
+    ThreadPoolConfig poolCfg;
+    FramePoolConfig frameCfg;
+    bool useFramePool = true;
+    IncrementalConfig incCfg;
+    bool incremental = false;
+    RecorderConfig recCfg;
+    SourceConfig sourceCfg;
+    BenchMatrix matrix;
+    GlBackend glBackend = GlBackend::Window;
+    for (int i = 1; i < argc; ++i) {
+        const std::string a = argv[i];
+        if (a == "--threads" && i + 1 < argc) poolCfg.threads = std::atoi(argv[++i]);
+        else if (a == "--pin-cores")          poolCfg.pinCores = true;
+        else if (a == "--no-frame-pool")      useFramePool = false;
+        else if (a == "--no-huge-pages")      frameCfg.hugePages = false;
+        else if (a == "--no-pbo")             glutils::setPboUploadEnabled(false);
+        else if (a == "--no-shader-cache")    glutils::programCache().setDirectory("");
+        else if (a == "--incremental")        incremental = true;
+        else if (a == "--tile" && i + 1 < argc)        incCfg.tile = std::atoi(argv[++i]);
+        else if (a == "--dirty-noise" && i + 1 < argc) incCfg.noise = std::atof(argv[++i]);
+        else if (a == "--record" && i + 1 < argc)      recCfg.path = argv[++i];
+        else if (a == "--record-fps" && i + 1 < argc)  recCfg.fps = std::atof(argv[++i]);
+        else if (a == "--record-fourcc" && i + 1 < argc) {
+            const std::string c = argv[++i];
+            if (c.size() != 4) { std::cerr << "--record-fourcc takes a four character code (MJPG, XVID, ...)\n"; return -1; }
+            recCfg.fourcc = cv::VideoWriter::fourcc(c[0], c[1], c[2], c[3]);
+        }
+        else if (a == "--source" && i + 1 < argc) {
+            std::string err;
+            if (!parseFrameSource(argv[++i], sourceCfg, err)) { std::cerr << "[Source] " << err << "\n"; return -1; }
+        }
+        else if (a == "--source-fps" && i + 1 < argc) sourceCfg.pace = std::atof(argv[++i]);
+        else if (a == "--yuv")                sourceCfg.yuv = true;
+        else if ((a == "--bench-config" || a == "--matrix") && i + 1 < argc) {
+            // Applied in command line order: later --matrix options override the file
+            std::string err;
+            const bool ok = a == "--matrix" ? setBenchOption(matrix, argv[++i], err)
+                                            : loadBenchMatrix(argv[++i], matrix, err);
+            if (!ok) { std::cerr << "[Bench] " << err << "\n"; return -1; }
+        }
+        else if (a == "--gl-backend" && i + 1 < argc) {
+            if (!parseGlBackend(argv[++i], glBackend)) {
+                std::cerr << "Unknown GL backend '" << argv[i] << "' (window, egl, osmesa)\n";
+                return -1;
+            }
+        }
+        else if (a == "--bench" || a == "--bench-headless") mode = a;
+        else if (a == "--help" || a == "-h") { std::cout << kUsage; return 0; }
+        else {
+            // Typos and options missing their value must not fall back to interactive mode
+            std::cerr << "Unknown option or missing value: '" << a << "'\n" << kUsage;
+            return -1;
+        }
+    }
+    if (mode == "--bench" || mode == "--bench-headless") {
+        std::string err;
+        if (!validateBenchMatrix(matrix, err)) { std::cerr << "[Bench] " << err << "\n"; return -1; }
+    }
+    try {
+        // Before the first frame is allocated, so every frame buffer comes from the pool
+        if (useFramePool) installFramePool(frameCfg);
+        configureCpuThreadPool(poolCfg);
+        std::cout << "[CPU] " << cpuThreadPool().threads() << " thread(s)"
+            << (cpuThreadPool().pinned() ? ", pinned" : "")
+            << " | frame pool " << (useFramePool ? (frameCfg.hugePages ? "on (huge pages)" : "on") : "off")
+            << std::endl;
+
+        if (mode == "--bench")          return run_benchmark_mode(glBackend, matrix);
+        if (mode == "--bench-headless") return run_headless_benchmark_mode(matrix);
+        interactive_mode(sourceCfg, incremental ? &incCfg : nullptr, recCfg.path.empty() ? nullptr : &recCfg);
+        return 0;
+    }
+    catch (const cv::Exception& e) {
+        std::cerr << "[OpenCV EXCEPTION] " << e.what() << std::endl;
+        return -1;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "[STD EXCEPTION] " << e.what() << std::endl;
+        return -1;
+    }
 }
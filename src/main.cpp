@@ -6,49 +6,240 @@
 #include <cmath>
 #include <string>
 #include <chrono>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
 
 #include <glad/glad.h>
-#include <GLFW/glfw3.h>
 #include <opencv2/opencv.hpp>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #include "gl_utils.hpp"
+#include "pbo_uploader.hpp"
+#include "gpu_timer.hpp"
+#include "shader_cache.hpp"
+#include "gl_context.hpp"
 #include "gpu_pipeline.hpp"
 #include "cv_filters.hpp"
 #include "cv_geom.hpp"
+#include "cpu_pipeline.hpp"
+#include "thread_pool.hpp"
+#include "frame_pool.hpp"
+#include "frame_source.hpp"
 #include "timing.hpp"
-
-// -------------------- Synthetic Frame Generator (for benchmarking instead of webcam) --------------------
-// Generate a random w×h BGR 8UC3 image; each frame varies slightly to avoid cache optimization
-static cv::Mat generateSyntheticFrame(int w, int h, unsigned seedTick) {
-    cv::Mat img(h, w, CV_8UC3);
-    cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(255));
-    // Add a simple shape/gradient overlay to prevent overly ideal randomness that helps GPU caching too much
-    int cx = (seedTick * 37) % w;
-    int cy = (seedTick * 53) % h;
-    cv::circle(img, { cx, cy }, std::max(8, std::min(w, h) / 12), cv::Scalar(20, 20, 220), -1);
-    cv::putText(img, std::to_string(seedTick % 10000), { 10, 30 }, cv::FONT_HERSHEY_SIMPLEX, 0.8, { 240,240,240 }, 2);
-    return img;
-}
+#include "benchmark.hpp"
+#include "pixel_kernels.hpp"
 
 // -------------------- Result Recording --------------------
 struct BenchResultRow {
     std::string mode, filter, transform, resolution, build;
+    std::string upload;   // texture upload path (PboUploader mode, "none" when headless)
     double avg_fps, min_fps, max_fps, std_fps;
     int samples;
+    int rep = 1;     // repetition of this cell (BenchMatrix::repetitions)
+    int threads;     // CPU worker threads (cpuThreadPool)
+    std::string isa; // CPU pixel kernel level (pixelKernels)
+    // Per-stage latency summaries (all zero if the stage did not run)
+    StageSummary stage_gen, stage_warp, stage_filter, stage_upload;
+    // GPU execution time of the texture upload and of the frame draw (GL timestamp queries)
+    StageSummary gpu_upload, gpu_draw;
+    // Input frames (FrameSource::name: "noise" / "scene" corpus, "live", "y4m", ...), the frames
+    // in the corpus or file, and what opening it cost before timing (corpus generation, file
+    // indexing); reading each frame is stage_gen
+    std::string source;
+    int source_frames = 0;
+    double source_setup_ms = 0.0;
+    std::string input;    // frames as the pipeline takes them: "bgr", or "i420" (yuv=on, I420 source)
 };
 
+static void write_stage_csv(std::ofstream& f, const StageSummary& s) {
+    f << "," << s.mean_us << "," << s.p50_us << "," << s.p99_us;
+}
+
 static void write_summary_csv(const std::vector<BenchResultRow>& rows, const std::string& path) {
     std::ofstream f(path, std::ios::out);
-    f << "mode,filter,transform,resolution,build,avg_fps,min_fps,max_fps,std_fps,samples\n";
+    f << "mode,filter,transform,resolution,build,avg_fps,min_fps,max_fps,std_fps,samples,rep,threads,upload,isa"
+        << ",gen_mean_us,gen_p50_us,gen_p99_us"
+        << ",warp_mean_us,warp_p50_us,warp_p99_us"
+        << ",filter_mean_us,filter_p50_us,filter_p99_us"
+        << ",upload_mean_us,upload_p50_us,upload_p99_us"
+        << ",gpu_upload_mean_us,gpu_upload_p50_us,gpu_upload_p99_us"
+        << ",gpu_draw_mean_us,gpu_draw_p50_us,gpu_draw_p99_us"
+        << ",source,source_frames,source_setup_ms,input\n";
     for (const auto& r : rows) {
         f << r.mode << "," << r.filter << "," << r.transform << ","
             << r.resolution << "," << r.build << ","
             << r.avg_fps << "," << r.min_fps << "," << r.max_fps << ","
-            << r.std_fps << "," << r.samples << "\n";
+            << r.std_fps << "," << r.samples << "," << r.rep << "," << r.threads << "," << r.upload << "," << r.isa;
+        write_stage_csv(f, r.stage_gen);
+        write_stage_csv(f, r.stage_warp);
+        write_stage_csv(f, r.stage_filter);
+        write_stage_csv(f, r.stage_upload);
+        write_stage_csv(f, r.gpu_upload);
+        write_stage_csv(f, r.gpu_draw);
+        f << "," << r.source << "," << r.source_frames << "," << r.source_setup_ms << "," << r.input << "\n";
+    }
+}
+
+// -------------------- Baseline Comparison --------------------
+// One matrix cell (all repetitions, see cellFps) against the same cell of the baseline CSV
+struct CellComparison {
+    std::string key;
+    int threads = 0;
+    FpsSample baseline, current;
+    FpsComparison result;
+};
+
+static std::string row_key(const BenchResultRow& r) {
+    return benchKey(r.mode, r.filter, r.transform, r.resolution);
+}
+
+// Cells of rows that have a baseline entry; a baseline without a threads column matches any
+static std::vector<CellComparison> compare_with_baseline(const std::vector<BenchResultRow>& rows,
+    const std::vector<BaselineRow>& baseline, const BenchMatrix& m)
+{
+    std::map<std::pair<std::string, int>, std::vector<FpsSample>> cells;
+    std::vector<std::pair<std::string, int>> order;
+    for (const auto& r : rows) {
+        auto id = std::make_pair(row_key(r), r.threads);
+        if (!cells.count(id)) order.push_back(id);
+        FpsSample s; s.mean = r.avg_fps; s.stddev = r.std_fps; s.n = r.samples;
+        cells[id].push_back(s);
+    }
+
+    std::vector<CellComparison> out;
+    for (const auto& id : order) {
+        const BaselineRow* base = nullptr;
+        for (const auto& b : baseline) {
+            if (b.key != id.first) continue;
+            if (b.threads == id.second) { base = &b; break; }
+            if (b.threads < 0 && !base) base = &b;
+        }
+        if (!base) continue;
+        CellComparison c;
+        c.key = id.first;
+        c.threads = id.second;
+        c.baseline = base->fps;
+        c.current = cellFps(cells[id]);
+        c.result = compareFps(c.baseline, c.current, m.confidence, m.tolerance);
+        out.push_back(c);
+    }
+    return out;
+}
+
+// Print the comparison table; returns the number of regressed cells, or -1 if no cell had
+// an interval (every compared baseline cell is a single run), i.e. nothing could be tested
+static int report_comparison(const std::vector<CellComparison>& cmp, const BenchMatrix& m) {
+    std::cout << "\n===== Baseline " << m.baseline << " (" << (int)std::round(m.confidence * 100)
+        << "% CI of the FPS change, tolerance " << m.tolerance * 100 << "%) =====\n";
+    int regressions = 0, tested = 0;
+    for (const auto& c : cmp) {
+        const char* verdict = !c.result.interval ? "no CI (single run)"
+            : c.result.regression ? "REGRESSION" : c.result.improvement ? "faster" : "ok";
+        regressions += c.result.regression;
+        tested += c.result.interval;
+        std::cout << c.key << " | threads=" << c.threads
+            << " | " << c.baseline.mean << " -> " << c.current.mean << " FPS"
+            << " | " << c.result.change * 100 << "%";
+        if (c.result.interval) std::cout << " [" << c.result.lo * 100 << ", " << c.result.hi * 100 << "]";
+        std::cout << " | " << verdict << "\n";
+    }
+    if (cmp.empty()) std::cout << "no cell of the matrix is in the baseline\n";
+    if (tested == 0) {
+        std::cerr << "[Baseline] no cell could be tested: a baseline cell needs at least 2 runs "
+            "(record it with repetitions >= 2)" << std::endl;
+        return -1;
+    }
+    std::cout << regressions << " regression(s) in " << tested << " tested cell(s)";
+    if (tested < (int)cmp.size()) std::cout << ", " << cmp.size() - tested << " single-run cell(s) not tested";
+    std::cout << std::endl;
+    return regressions;
+}
+
+// -------------------- JSON Output --------------------
+static std::string json_str(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+static void write_stage_json(std::ostream& f, const char* name, const StageSummary& s) {
+    f << json_str(name) << ": {\"mean_us\": " << s.mean_us << ", \"p50_us\": " << s.p50_us
+        << ", \"p99_us\": " << s.p99_us << "}";
+}
+
+static void write_summary_json(const std::vector<BenchResultRow>& rows, const std::vector<CellComparison>& cmp,
+    const BenchMatrix& m, const std::string& path)
+{
+    std::ofstream f(path, std::ios::out);
+    f << "{\n  \"rows\": [";
+    for (size_t i = 0; i < rows.size(); ++i) {
+        const auto& r = rows[i];
+        f << (i ? ",\n" : "\n") << "    {\"mode\": " << json_str(r.mode) << ", \"filter\": " << json_str(r.filter)
+            << ", \"transform\": " << json_str(r.transform) << ", \"resolution\": " << json_str(r.resolution)
+            << ", \"build\": " << json_str(r.build) << ", \"rep\": " << r.rep << ", \"threads\": " << r.threads
+            << ", \"upload\": " << json_str(r.upload) << ", \"isa\": " << json_str(r.isa)
+            << ", \"avg_fps\": " << r.avg_fps << ", \"min_fps\": " << r.min_fps << ", \"max_fps\": " << r.max_fps
+            << ", \"std_fps\": " << r.std_fps << ", \"samples\": " << r.samples
+            << ", \"source\": " << json_str(r.source) << ", \"source_frames\": " << r.source_frames
+            << ", \"source_setup_ms\": " << r.source_setup_ms << ", \"input\": " << json_str(r.input)
+            << ", \"stages\": {";
+        write_stage_json(f, "gen", r.stage_gen); f << ", ";
+        write_stage_json(f, "warp", r.stage_warp); f << ", ";
+        write_stage_json(f, "filter", r.stage_filter); f << ", ";
+        write_stage_json(f, "upload", r.stage_upload); f << ", ";
+        write_stage_json(f, "gpu_upload", r.gpu_upload); f << ", ";
+        write_stage_json(f, "gpu_draw", r.gpu_draw);
+        f << "}}";
+    }
+    f << "\n  ]";
+    if (!m.baseline.empty()) {
+        f << ",\n  \"baseline\": {\"path\": " << json_str(m.baseline) << ", \"confidence\": " << m.confidence
+            << ", \"tolerance\": " << m.tolerance << ", \"cells\": [";
+        for (size_t i = 0; i < cmp.size(); ++i) {
+            const auto& c = cmp[i];
+            f << (i ? ",\n" : "\n") << "    {\"cell\": " << json_str(c.key) << ", \"threads\": " << c.threads
+                << ", \"baseline_fps\": " << c.baseline.mean << ", \"fps\": " << c.current.mean
+                << ", \"change\": " << c.result.change;
+            if (c.result.interval) f << ", \"ci_low\": " << c.result.lo << ", \"ci_high\": " << c.result.hi;
+            else                   f << ", \"ci_low\": null, \"ci_high\": null";
+            f << ", \"regression\": " << (c.result.regression ? "true" : "false")
+                << ", \"improvement\": " << (c.result.improvement ? "true" : "false") << "}";
+        }
+        f << "\n  ]}";
+    }
+    f << "\n}\n";
+}
+
+// Write <stem>.csv and <stem>.json, compare with the baseline if one is set.
+// Returns 1 if a cell regressed, -1 if the baseline could not be read or no cell of it could be
+// tested, 0 otherwise.
+static int finish_benchmark(const std::vector<BenchResultRow>& rows, const BenchMatrix& m, const std::string& stem) {
+    write_summary_csv(rows, stem + ".csv");
+    std::vector<CellComparison> cmp;
+    int status = 0;
+    if (!m.baseline.empty()) {
+        std::vector<BaselineRow> baseline;
+        std::string err;
+        if (!loadBaselineCsv(m.baseline, baseline, err)) {
+            std::cerr << "[Baseline] " << err << std::endl;
+            status = -1;
+        }
+        else {
+            cmp = compare_with_baseline(rows, baseline, m);
+            const int regressions = report_comparison(cmp, m);
+            status = regressions < 0 ? -1 : regressions > 0 ? 1 : 0;
+        }
     }
+    write_summary_json(rows, cmp, m, stem + ".json");
+    std::cout << "[Results] " << stem << ".csv, " << stem << ".json" << std::endl;
+    return status;
 }
 
 // Simple statistics
@@ -61,71 +252,218 @@ static double stdev(const std::vector<double>& v) {
     double acc = 0.0; for (double x : v) acc += (x - m) * (x - m);
     return std::sqrt(acc / (v.size() - 1));
 }
+// -------------------- Stage Timing --------------------
+// Stage handles are looked up once per combination; recording is allocation-free
+struct BenchStages {
+    StageTimings timings;
+    StageStat& gen = timings.stage("generate");
+    StageStat& warp = timings.stage("warp");
+    StageStat& filter = timings.stage("filter");
+    StageStat& upload = timings.stage("upload");
+    StageStat& frame = timings.stage("frame");
+    StageStat& gpuUpload = timings.stage("gpu upload");
+    StageStat& gpuDraw = timings.stage("gpu draw");
+};
+
+// Fused CPU filter graph (processCpuFrame, or processCpuFrameI420 for an I420 frame, whose
+// conversion to BGR is then part of this stage). It is recorded under the warp stage when it
+// resamples (Transform on) and under the filter stage when it only filters.
+static void process_cpu(const cv::Mat& frame, bool i420, cv::Mat& out, const FilterChain& filters,
+    const FilterParams& fp, bool useTransform, const AffineParams& ap, BenchStages& st)
+{
+    ScopedTimer t(useTransform ? st.warp : st.filter);
+    const FilterGraph graph = buildFilterGraph(filters, fp, useTransform ? ap : AffineParams{});
+    if (i420) processCpuFrameI420(frame, out, graph);
+    else      processCpuFrame(frame, out, graph);
+}
+
+static BenchResultRow make_row(bool useGPU, const FilterChain& filters, bool useTransform,
+    int w, int h, const std::string& build, const std::string& upload,
+    const std::vector<double>& fps_samples, const BenchStages& st)
+{
+    BenchResultRow row;
+    row.mode = useGPU ? "GPU" : "CPU";
+    row.filter = chainName(filters);
+    row.transform = useTransform ? "On" : "Off";
+    row.resolution = std::to_string(w) + "x" + std::to_string(h);
+    row.build = build;
+    row.upload = upload;
+    row.avg_fps = mean(fps_samples);
+    row.min_fps = fps_samples.empty() ? 0.0 : *std::min_element(fps_samples.begin(), fps_samples.end());
+    row.max_fps = fps_samples.empty() ? 0.0 : *std::max_element(fps_samples.begin(), fps_samples.end());
+    row.std_fps = stdev(fps_samples);
+    row.samples = (int)fps_samples.size();
+    row.threads = cpuThreadPool().threads();
+    row.isa = cpuIsaName(pixelKernels().isa);
+    row.stage_gen = st.gen.summary();
+    row.stage_warp = st.warp.summary();
+    row.stage_filter = st.filter.summary();
+    row.stage_upload = st.upload.summary();
+    row.gpu_upload = st.gpuUpload.summary();
+    row.gpu_draw = st.gpuDraw.summary();
+    return row;
+}
+
+static void print_frame_pool_stats() {
+    const FramePool* pool = framePool();
+    if (!pool) { std::cout << "[FramePool] disabled\n"; return; }
+    FramePoolStats ps = pool->stats();
+    std::cout << "[FramePool] hits=" << ps.hits << " misses=" << ps.misses
+        << " cached=" << (ps.cachedBytes >> 20) << " MiB"
+        << " hugetlb=" << (ps.hugeBytes >> 20) << " MiB\n";
+}
+
+static std::string build_name() {
+#ifdef _DEBUG
+    return "Debug";
+#else
+    return "Release";
+#endif
+}
+
+// CPU pool sizes of the matrix; empty = only the pool configured on the command line (-1)
+static std::vector<int> thread_sweep(const BenchMatrix& m) {
+    return m.threads.empty() ? std::vector<int>{ -1 } : m.threads;
+}
+
+static void apply_threads(int threads) {
+    if (threads < 0 || threads == cpuThreadPool().threads()) return;
+    ThreadPoolConfig cfg;
+    cfg.threads = threads;
+    cfg.pinCores = cpuThreadPool().pinned();
+    configureCpuThreadPool(cfg);
+}
+
+// Frame source of the benchmark. A file is opened once here and replaces the resolutions
+// list with its own frame size; synthetic sources are opened per resolution (prepare_source).
+// false if the file cannot be opened.
+static bool open_bench_source(const BenchMatrix& m, std::unique_ptr<FrameSource>& src,
+    std::vector<std::pair<int, int>>& resolutions)
+{
+    resolutions = m.resolutions;
+    if (m.source.kind != SourceKind::Synthetic) {
+        std::string err;
+        src = openFrameSource(m.source, err);
+        if (!src) { std::cerr << "[Source] " << err << std::endl; return false; }
+        std::cout << "[Source] " << src->describe() << " (instead of the resolutions list)" << std::endl;
+        resolutions = { { src->size().width, src->size().height } };
+    }
+    if (m.yuv && (!src || src->format() != FrameFormat::I420))
+        std::cout << "[Source] yuv=on only applies to I420 sources; these frames are read as BGR" << std::endl;
+    return true;
+}
+
+// Input of the runs at one resolution, rewound to its first frame. A synthetic source is
+// reopened when the resolution changes, so a corpus is generated here, outside any timed region.
+static FrameSource& prepare_source(std::unique_ptr<FrameSource>& src, const BenchMatrix& m, const std::pair<int, int>& res) {
+    if (m.source.kind == SourceKind::Synthetic && (!src || src->size() != cv::Size(res.first, res.second))) {
+        SourceConfig cfg = m.source;
+        cfg.width = res.first; cfg.height = res.second;
+        std::string err;
+        src = openFrameSource(cfg, err);
+        if (!src) throw std::runtime_error("[Source] " + err);
+        std::cout << "[Source] " << src->describe()
+            << (!cfg.live && src->frameCount() < cfg.corpus.frames ? " (capped by memory limit)" : "") << std::endl;
+    }
+    src->rewind();
+    return *src;
+}
+
+// yuv=on keeps the frames of an I420 source as they are; everything else is read as BGR
+static bool feeds_i420(const BenchMatrix& m, const FrameSource& src) {
+    return m.yuv && src.format() == FrameFormat::I420;
+}
+
+static void set_source(BenchResultRow& row, const FrameSource& src, bool i420) {
+    row.source = src.name();
+    row.source_frames = src.frameCount();
+    row.source_setup_ms = src.setupMs();
+    row.input = frameFormatName(i420 ? FrameFormat::I420 : FrameFormat::BGR);
+}
+
+static AffineParams bench_affine() {
+    AffineParams aff; aff.tx = 60.f; aff.ty = 40.f; aff.scale = 1.15f; aff.thetaDeg = 8.f;
+    return aff;
+}
 
 // -------------------- Run One Combination --------------------
-static BenchResultRow run_one_combo(GLFWwindow* win,
+static BenchResultRow run_one_combo(GlContext& ctx,
     GpuPipeline& gpu,
     GLuint passProg, GLint loc_uTex, GLint loc_uAff,
-    GLuint vao, GLuint& tex, int& texW, int& texH,
+    GLuint vao, glutils::FrameTextures& tex, int& texW, int& texH,
+    glutils::PboUploader& uploader,
+    glutils::GpuTimer& gpuTimer,
+    FrameSource& source, bool i420,
     const std::pair<int, int>& reqRes,
     const std::string& build,
-    FilterType filter, bool useGPU, bool useTransform,
+    const FilterChain& filters, bool useGPU, bool useTransform,
     const AffineParams& aff,
-    int warmup_sec = 1, int sample_sec = 5)
+    double warmup_sec = 1, double sample_sec = 5)
 {
-    // 1) Change resolution: recreate texture and resize window
+    // 1) Change resolution: recreate texture and resize the window / offscreen target. GPU
+    //    rows of an I420 input upload its planes; CPU rows upload their BGR output.
     texW = reqRes.first; texH = reqRes.second;
-    glDeleteTextures(1, &tex);
-    tex = glutils::createTexture2D(texW, texH, GL_RGB);
-    glfwSetWindowSize(win, texW, texH);
+    const bool planes = i420 && useGPU;
+    glutils::deleteFrameTextures(tex);
+    const FrameFormat layout = planes ? FrameFormat::I420 : FrameFormat::BGR;
+    tex = glutils::createFrameTextures(texW, texH, layout);
+    uploader.init(texW, texH, 3, layout);
+    ctx.resize(texW, texH);
 
     FilterParams fp; fp.pixelBlock = 8; fp.keepBGR = { 20,20,200 }; fp.thresh = 60;
     AffineParams ap = aff;
 
     std::vector<double> fps_samples;
-    auto t0 = std::chrono::high_resolution_clock::now();
-    auto elapsed_sec = [&] { return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - t0).count(); };
-
-    // 2) Rendering loop: use synthetic frames, not limited by camera FPS
-    double last = glfwGetTime();
-    unsigned tick = 0;
-
-    while (!glfwWindowShouldClose(win)) {
-        // Generate input frame
-        cv::Mat frame = generateSyntheticFrame(texW, texH, ++tick);
+    BenchStages st;
+    bool warm = false;
+    cv::Mat frame, img;          // reused every frame
+    using Clock = std::chrono::steady_clock;
+    const auto t0 = Clock::now();
+    auto elapsed_sec = [&] { return std::chrono::duration<double>(Clock::now() - t0).count(); };
+
+    // 2) Rendering loop: frames from the source (corpus, live generation or a file), not limited by camera FPS
+    auto last = Clock::now();
+
+    while (!ctx.shouldClose()) {
+        // Drop everything timed during warmup (including GPU queries still in flight)
+        if (!warm && elapsed_sec() > warmup_sec) { gpuTimer.finish(); st.timings.resetAll(); warm = true; }
+        gpuTimer.beginFrame();
+
+        // Input frame: a header into the corpus / mapped file, or generated / decoded into frame
+        bool got;
+        { ScopedTimer t(st.gen); got = i420 ? source.read(frame) : source.readBGR(frame); }
+        if (!got) break;
 
         // CPU / GPU processing paths
+        // Upload is BGR (or the I420 planes) straight into a PBO slot, no color conversion
         if (!useGPU) {
-            cv::Mat img = frame;
-            if (useTransform) warpCpuAffine(img, ap);
-            applyCpuFilter(img, filter, fp);
-            glutils::uploadFrameToTexture(tex, img);
+            process_cpu(frame, i420, img, filters, fp, useTransform, ap, st);
+            ScopedTimer t(st.upload); glutils::GpuScope g(gpuTimer, st.gpuUpload);
+            uploader.upload(tex, img);
         }
         else {
-            glutils::uploadFrameToTexture(tex, frame);
+            ScopedTimer t(st.upload); glutils::GpuScope g(gpuTimer, st.gpuUpload);
+            uploader.upload(tex, frame);
         }
 
         // Render
-        int fbW, fbH; glfwGetFramebufferSize(win, &fbW, &fbH);
+        int fbW, fbH; ctx.beginFrame(fbW, fbH);
         glViewport(0, 0, fbW, fbH);
         glClear(GL_COLOR_BUFFER_BIT);
 
+        gpuTimer.begin(st.gpuDraw);
         if (useGPU) {
-            gpu.draw(vao, tex, texW, texH, filter, fp, useTransform ? ap : AffineParams{});
+            gpu.draw(vao, tex, texW, texH, buildFilterGraph(filters, fp, useTransform ? ap : AffineParams{}));
         }
         else {
             glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, tex);
+            glBindTexture(GL_TEXTURE_2D, tex.tex);
             glUseProgram(passProg);
             if (loc_uTex >= 0) glUniform1i(loc_uTex, 0);
 
-            cv::Matx33f M = affineMatrix(useTransform ? ap : AffineParams{}, texW, texH);
-            glm::mat3 gM(
-                M(0, 0), M(1, 0), M(2, 0),
-                M(0, 1), M(1, 1), M(2, 1),
-                M(0, 2), M(1, 2), M(2, 2)
-            );
-            if (loc_uAff >= 0) glUniformMatrix3fv(loc_uAff, 1, GL_FALSE, glm::value_ptr(gM));
+            // The CPU frame is already warped: display it untransformed
+            glm::mat3 I(1.0f);
+            if (loc_uAff >= 0) glUniformMatrix3fv(loc_uAff, 1, GL_FALSE, glm::value_ptr(I));
 
             glBindVertexArray(vao);
             glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
@@ -133,13 +471,13 @@ static BenchResultRow run_one_combo(GLFWwindow* win,
             glUseProgram(0);
             glBindTexture(GL_TEXTURE_2D, 0);
         }
+        gpuTimer.end();
 
-        glfwSwapBuffers(win);
-        glfwPollEvents();
+        ctx.present();
 
         // Measure FPS (frame-to-frame interval)
-        double now = glfwGetTime();
-        double dt = now - last; last = now;
+        const auto now = Clock::now();
+        double dt = std::chrono::duration<double>(now - last).count(); last = now;
         if (dt > 0.0) {
             double fps = 1.0 / dt;
             if (elapsed_sec() > warmup_sec) fps_samples.push_back(fps);
@@ -149,119 +487,193 @@ static BenchResultRow run_one_combo(GLFWwindow* win,
     }
 
     // Collect results
-    BenchResultRow row;
-    row.mode = useGPU ? "GPU" : "CPU";
-    row.filter = filterName(filter);
-    row.transform = useTransform ? "On" : "Off";
-    row.resolution = std::to_string(texW) + "x" + std::to_string(texH);
-    row.build = build;
-    row.avg_fps = mean(fps_samples);
-    row.min_fps = fps_samples.empty() ? 0.0 : *std::min_element(fps_samples.begin(), fps_samples.end());
-    row.max_fps = fps_samples.empty() ? 0.0 : *std::max_element(fps_samples.begin(), fps_samples.end());
-    row.std_fps = stdev(fps_samples);
-    row.samples = (int)fps_samples.size();
-    return row;
+    gpuTimer.finish();
+    return make_row(useGPU, filters, useTransform, texW, texH, build, uploader.modeName(), fps_samples, st);
 }
 
-// -------------------- Automatic Benchmark Pipeline --------------------
-static int run_benchmark_mode() {
-    // Initialize OpenGL window
-    if (!glfwInit()) { std::cerr << "glfwInit failed\n"; return -1; }
-    // Start with an initial window; size will be adjusted later for each test
-    GLFWwindow* win = glfwCreateWindow(640, 480, "Synthetic Benchmark", nullptr, nullptr);
-    if (!win) { std::cerr << "Create window failed\n"; glfwTerminate(); return -1; }
-    glfwMakeContextCurrent(win);
-    // Disable VSync to avoid frame rate lock by display refresh rate
-    glfwSwapInterval(0);
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-        std::cerr << "glad init failed\n"; return -1;
+// -------------------- Run One Combination (headless, CPU only) --------------------
+// Same frame loop as run_one_combo minus upload/draw/swap: every stage is timed on its own
+// and FPS is derived from the summed per-frame wall time.
+static BenchResultRow run_one_combo_headless(FrameSource& source, bool i420,
+    const std::pair<int, int>& reqRes,
+    const std::string& build,
+    const FilterChain& filters, bool useTransform,
+    const AffineParams& aff,
+    double warmup_sec = 1, double sample_sec = 5)
+{
+    const int w = reqRes.first, h = reqRes.second;
+    FilterParams fp; fp.pixelBlock = 8; fp.keepBGR = { 20,20,200 }; fp.thresh = 60;
+    AffineParams ap = aff;
+
+    std::vector<double> fps_samples;
+    BenchStages st;
+    bool warm = false;
+    cv::Mat frame, img, staging; // reused every frame
+    using Clock = std::chrono::steady_clock;
+    const auto t0 = Clock::now();
+    auto elapsed_sec = [&] { return std::chrono::duration<double>(Clock::now() - t0).count(); };
+
+    for (;;) {
+        if (!warm && elapsed_sec() > warmup_sec) { st.timings.resetAll(); warm = true; }
+
+        const auto tFrame = Clock::now();
+        {
+            ScopedTimer tf(st.frame);
+            bool got;
+            { ScopedTimer t(st.gen); got = i420 ? source.read(frame) : source.readBGR(frame); }
+            if (!got) break;
+            process_cpu(frame, i420, img, filters, fp, useTransform, ap, st);
+            // CPU half of the streaming upload: the copy into a PBO slot
+            { ScopedTimer t(st.upload); img.copyTo(staging); }
+        }
+        const double frameSec = std::chrono::duration<double>(Clock::now() - tFrame).count();
+        if (warm && frameSec > 0.0) fps_samples.push_back(1.0 / frameSec);
+
+        if (elapsed_sec() > warmup_sec + sample_sec) break;
     }
 
+    return make_row(false, filters, useTransform, w, h, build, "none", fps_samples, st);
+}
+
+static void print_cpu_kernels() {
+    std::cout << "[CPU] kernels: " << cpuIsaName(pixelKernels().isa)
+        << " (detected " << cpuIsaName(detectCpuIsa()) << ")" << std::endl;
+}
+
+// -------------------- Automatic Benchmark Pipeline --------------------
+int run_benchmark_mode(GlBackend backend, const BenchMatrix& m) {
+    // Initialize the GL context (window or offscreen); size will be adjusted later for each test
+    std::unique_ptr<GlContext> ctx = createGlContext(backend, 640, 480, "Synthetic Benchmark");
+    if (!ctx) return -1;
+    std::cout << "[GL] " << glBackendName(backend) << " | " << glGetString(GL_RENDERER)
+        << " | " << glGetString(GL_VERSION) << std::endl;
+    print_cpu_kernels();
+
     // Resources
     GLuint vao = glutils::createFullScreenQuadVAO();
     GpuPipeline gpu; if (!gpu.init("shaders")) { std::cerr << "Shader init failed.\n"; return -1; }
-    GLuint passProg = glutils::loadShaderProgram("shaders/passthrough.vert", "shaders/passthrough.frag");
+    GLuint passProg = gpu.passthroughProgram();
     GLint loc_uTex = glGetUniformLocation(passProg, "uTex");
     GLint loc_uAff = glGetUniformLocation(passProg, "uAffine");
+    std::cout << "[Shaders] " << glutils::programCache().summary() << std::endl;
 
     int texW = 640, texH = 480;
-    GLuint tex = glutils::createTexture2D(texW, texH, GL_RGB);
-
-    std::string build =
-#ifdef _DEBUG
-        "Debug";
-#else
-        "Release";
-#endif
-
-    // Test matrix (can be modified as needed)
-    const std::vector<std::pair<int, int>> resolutions = {
-        {640, 480},
-        {1280, 720},
-        {1920, 1080}
-    };
-    const std::vector<FilterType> filters = {
-        FilterType::None, FilterType::Pixelate, FilterType::SinCity
-    };
-    const std::vector<bool> transforms = { false, true };
-    const std::vector<bool> modes = { false /*CPU*/, true /*GPU*/ };
-
-    AffineParams aff; aff.tx = 60.f; aff.ty = 40.f; aff.scale = 1.15f; aff.thetaDeg = 8.f;
+    glutils::FrameTextures tex = glutils::createFrameTextures(texW, texH, FrameFormat::BGR);
+    glutils::PboUploader uploader;
+    glutils::GpuTimer gpuTimer;
+    gpuTimer.init();
+    std::cout << "[GPU timer] " << (gpuTimer.active() ? "timestamp queries" : "unavailable") << std::endl;
+
+    const std::string build = build_name();
+    const AffineParams aff = bench_affine();
+    const std::vector<int> sweep = thread_sweep(m);
+    std::unique_ptr<FrameSource> source;
+    std::vector<std::pair<int, int>> resolutions;
+    if (!open_bench_source(m, source, resolutions)) return -1;
 
     // Clear color
     glClearColor(0.08f, 0.1f, 0.15f, 1.0f);
 
     // Run all combinations and collect results
     std::vector<BenchResultRow> results;
-    for (bool useGPU : modes) {
-        for (auto f : filters) {
-            for (bool t : transforms) {
-                for (auto r : resolutions) {
-                    std::cout << "[RUN] " << (useGPU ? "GPU" : "CPU")
-                        << " | " << filterName(f)
-                        << " | T=" << (t ? "On" : "Off")
-                        << " | " << r.first << "x" << r.second << std::endl;
-
-                    auto row = run_one_combo(win, gpu, passProg, loc_uTex, loc_uAff,
-                        vao, tex, texW, texH,
-                        r, build, f, useGPU, t, aff,
-                        /*warmup_sec*/1, /*sample_sec*/5);
-                    results.push_back(row);
+    for (bool useGPU : m.gpuModes) {
+        for (size_t ti = 0; ti < sweep.size(); ++ti) {
+            if (useGPU && ti > 0) break;     // GPU rows do not depend on the CPU pool size
+            apply_threads(sweep[ti]);
+            for (const auto& f : m.filters) {
+                for (bool t : m.transforms) {
+                    for (auto r : resolutions) {
+                        for (int rep = 1; rep <= m.repetitions; ++rep) {
+                            std::cout << "[RUN] " << (useGPU ? "GPU" : "CPU")
+                                << " | " << chainName(f)
+                                << " | T=" << (t ? "On" : "Off")
+                                << " | " << r.first << "x" << r.second
+                                << " | threads=" << cpuThreadPool().threads()
+                                << " | rep " << rep << "/" << m.repetitions << std::endl;
+
+                            FrameSource& src = prepare_source(source, m, r);
+                            const bool i420 = feeds_i420(m, src);
+                            auto row = run_one_combo(*ctx, gpu, passProg, loc_uTex, loc_uAff,
+                                vao, tex, texW, texH, uploader, gpuTimer, src, i420,
+                                r, build, f, useGPU, t, aff, m.warmupSec, m.sampleSec);
+                            row.rep = rep;
+                            set_source(row, src, i420);
+                            results.push_back(row);
+                        }
+                    }
                 }
             }
         }
     }
 
-    // Write CSV (to current working directory)
-    std::string out = "perf_summary_" + build + ".csv"; 
-    write_summary_csv(results, out);
+    // Write CSV + JSON (to current working directory); offscreen runs get their own files
+    const std::string stem = "perf_summary_" + build
+        + (backend == GlBackend::Window ? std::string() : std::string("_") + glBackendName(backend));
 
     // Print summary to console
     std::cout << "\n===== Benchmark Summary (avg_fps) =====\n";
     for (const auto& r : results) {
         std::cout << r.mode << " | " << r.filter << " | " << r.transform
             << " | " << r.resolution << " | " << r.build
-            << " => " << r.avg_fps << " FPS (n=" << r.samples << ")\n";
+            << " => " << r.avg_fps << " FPS (n=" << r.samples << ")"
+            << " | GPU upload/draw " << r.gpu_upload.mean_us << "/" << r.gpu_draw.mean_us << " us\n";
     }
-
-    // Cleanup
-    glDeleteTextures(1, &tex);
-    glfwDestroyWindow(win);
-    glfwTerminate();
-    return 0;
+    print_frame_pool_stats();
+    const int status = finish_benchmark(results, m, stem);
+
+    // Cleanup (GL objects first, while the context is still current)
+    uploader.release();
+    gpuTimer.release();
+    glutils::deleteFrameTextures(tex);
+    glDeleteVertexArrays(1, &vao);
+    gpu.release();
+    ctx.reset();
+    return status;
 }
 
- //-------------------- main --------------------
-//int main() {
-//    try {
-//        return run_benchmark_mode();
-//    }
-//    catch (const cv::Exception& e) {
-//        std::cerr << "[OpenCV EXCEPTION] " << e.what() << std::endl;
-//        return -1;
-//    }
-//    catch (const std::exception& e) {
-//        std::cerr << "[STD EXCEPTION] " << e.what() << std::endl;
-//        return -1;
-//    }
-//}
+// -------------------- Headless Benchmark Pipeline (CPU only, no display needed) --------------------
+int run_headless_benchmark_mode(const BenchMatrix& m) {
+    const std::string build = build_name();
+    const AffineParams aff = bench_affine();
+    print_cpu_kernels();
+    std::unique_ptr<FrameSource> source;
+    std::vector<std::pair<int, int>> resolutions;
+    if (!open_bench_source(m, source, resolutions)) return -1;
+
+    std::vector<BenchResultRow> results;
+    for (int threads : thread_sweep(m)) {
+        apply_threads(threads);
+        for (const auto& f : m.filters) {
+            for (bool t : m.transforms) {
+                for (auto r : resolutions) {
+                    for (int rep = 1; rep <= m.repetitions; ++rep) {
+                        std::cout << "[RUN] CPU (headless)"
+                            << " | " << chainName(f)
+                            << " | T=" << (t ? "On" : "Off")
+                            << " | " << r.first << "x" << r.second
+                            << " | threads=" << cpuThreadPool().threads()
+                            << " | rep " << rep << "/" << m.repetitions << std::endl;
+
+                        FrameSource& src = prepare_source(source, m, r);
+                        const bool i420 = feeds_i420(m, src);
+                        auto row = run_one_combo_headless(src, i420, r, build, f, t, aff, m.warmupSec, m.sampleSec);
+                        row.rep = rep;
+                        set_source(row, src, i420);
+                        results.push_back(row);
+                    }
+                }
+            }
+        }
+    }
+
+    std::cout << "\n===== Headless Benchmark Summary (avg_fps | p99 us: gen / warp / filter / upload) =====\n";
+    for (const auto& r : results) {
+        std::cout << r.mode << " | " << r.filter << " | " << r.transform
+            << " | " << r.resolution << " | " << r.build
+            << " => " << r.avg_fps << " FPS (n=" << r.samples << ") | "
+            << r.stage_gen.p99_us << " / " << r.stage_warp.p99_us << " / "
+            << r.stage_filter.p99_us << " / " << r.stage_upload.p99_us << "\n";
+    }
+    print_frame_pool_stats();
+    return finish_benchmark(results, m, "perf_summary_" + build + "_headless");
+}
@@ -0,0 +1,108 @@
+#include "pbo_readback.hpp"
+#include "pbo_uploader.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace glutils {
+
+	// GL rows run bottom-up: copy them into a top-down BGR8 frame, on the calling (render)
+	// thread like the upload copies (pbo_uploader.cpp copyIntoSlot)
+	static void copyFlipped(cv::Mat& dst, const uchar* src) {
+		const size_t rowBytes = (size_t)dst.cols * 3;
+		const int h = dst.rows;
+		for (int y = 0; y < h; ++y)
+			std::memcpy(dst.ptr<uchar>(y), src + (size_t)(h - 1 - y) * rowBytes, rowBytes);
+	}
+
+	static void readPixelsBGR(int x, int y, int w, int h, void* pixels) {
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(x, y, w, h, GL_BGR, GL_UNSIGNED_BYTE, pixels);
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	}
+
+	void PboReadback::init(int width, int height, int slots) {
+		release();
+		w_ = width; h_ = height;
+		bytes_ = (size_t)width * height * 3;
+		if (!pboUploadEnabled()) return;
+
+		slots_ = std::min(std::max(slots, 2), kMaxSlots);
+		glGenBuffers(slots_, pbo_);
+		for (int s = 0; s < slots_; ++s) {
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo_[s]);
+			glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)bytes_, nullptr, GL_STREAM_READ);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	void PboReadback::release() {
+		for (int s = 0; s < slots_; ++s)
+			if (fence_[s]) { glDeleteSync(fence_[s]); fence_[s] = nullptr; }
+		if (slots_ > 0) glDeleteBuffers(slots_, pbo_);
+		std::fill(pbo_, pbo_ + kMaxSlots, 0u);
+		sync_.release();
+		w_ = h_ = slots_ = head_ = pending_ = 0;
+		bytes_ = 0;
+	}
+
+	void PboReadback::capture(int x, int y, int width, int height) {
+		if (width <= 0 || height <= 0) return;
+		if (width != w_ || height != h_) {
+			dropped_ += pending_;
+			init(width, height, slots_ ? slots_ : 3);
+		}
+
+		if (slots_ == 0) {
+			if (pending_) ++dropped_;  // previous frame never collected
+			cv::Mat bottomUp(h_, w_, CV_8UC3);
+			readPixelsBGR(x, y, w_, h_, bottomUp.data);
+			sync_ = cv::Mat(h_, w_, CV_8UC3);
+			copyFlipped(sync_, bottomUp.data);
+			pending_ = 1;
+			return;
+		}
+
+		if (pending_ == slots_) { ++dropped_; return; }
+		const int s = (head_ + pending_) % slots_;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo_[s]);
+		readPixelsBGR(x, y, w_, h_, nullptr);     // offset 0 into the bound PBO
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		fence_[s] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		++pending_;
+	}
+
+	bool PboReadback::collect(cv::Mat& out, bool wait) {
+		if (pending_ == 0) return false;
+		if (slots_ == 0) {
+			out = sync_;
+			sync_.release();
+			pending_ = 0;
+			return true;
+		}
+
+		const int s = head_;
+		GLenum r = glClientWaitSync(fence_[s], GL_SYNC_FLUSH_COMMANDS_BIT, wait ? 1000000000ull : 0);
+		while (wait && r == GL_TIMEOUT_EXPIRED)
+			r = glClientWaitSync(fence_[s], 0, 1000000000ull);
+		if (r == GL_TIMEOUT_EXPIRED) return false;
+		glDeleteSync(fence_[s]);
+		fence_[s] = nullptr;
+		head_ = (head_ + 1) % slots_;
+		--pending_;
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo_[s]);
+		const void* p = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)bytes_, GL_MAP_READ_BIT);
+		bool ok = p != nullptr;
+		if (ok) {
+			// A fresh Mat per frame: the previous one may still be queued for encoding
+			cv::Mat frame(h_, w_, CV_8UC3);
+			copyFlipped(frame, (const uchar*)p);
+			out = frame;
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		else ++dropped_;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		return ok;
+	}
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <glad/glad.h>
+#include <opencv2/opencv.hpp>
+
+namespace glutils {
+
+	/// Asynchronous BGR8 framebuffer readback, the counterpart of PboUploader.
+	/// capture() only queues glReadPixels into the next pixel pack buffer of a ring and fences
+	/// it; the copy runs on the GPU while the next frames are drawn. collect() maps a slot once
+	/// its fence has signaled, typically one or two frames later, so the render thread never
+	/// waits for the GPU. With PBOs disabled (setPboUploadEnabled) reads are synchronous.
+	class PboReadback {
+	public:
+		PboReadback() = default;
+		PboReadback(const PboReadback&) = delete;
+		PboReadback& operator=(const PboReadback&) = delete;
+
+		/// Allocate `slots` PBOs for width x height BGR8 reads. Needs a current GL context.
+		void init(int width, int height, int slots = 3);
+		/// Free the PBOs and drop pending reads; call while the context is still current
+		void release();
+
+		/// Queue a read of the width x height region at (x, y) of the bound read framebuffer.
+		/// Re-inits (dropping pending reads) if the size changed; if every slot is still
+		/// pending the frame is dropped instead of stalling.
+		void capture(int x, int y, int width, int height);
+
+		/// Oldest pending read as a new top-down BGR8 Mat; false if none has completed yet.
+		/// wait blocks until the oldest read is done (flush at shutdown / before a mode switch).
+		bool collect(cv::Mat& out, bool wait = false);
+
+		int pending() const { return pending_; }
+		uint64_t dropped() const { return dropped_; }   // frames lost to a full ring or re-init
+		bool async() const { return slots_ > 0; }
+
+	private:
+		static constexpr int kMaxSlots = 4;
+		int w_ = 0, h_ = 0, slots_ = 0;
+		int head_ = 0, pending_ = 0;   // oldest pending slot, pending slot count
+		size_t bytes_ = 0;
+		uint64_t dropped_ = 0;
+		GLuint pbo_[kMaxSlots] = {};
+		GLsync fence_[kMaxSlots] = {};
+		cv::Mat sync_;                 // synchronous mode: the one pending frame
+	};
+
+}
@@ -0,0 +1,266 @@
+#include "pbo_uploader.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace glutils {
+
+	// Copy a frame (BGR8 or YUV) into tightly packed slot memory. Runs on the render thread:
+	// not through cpuThreadPool(), whose parallelFor would wait for the processing thread's pass.
+	static void copyIntoSlot(uchar* dst, const cv::Mat& frame) {
+		const size_t rowBytes = (size_t)frame.cols * frame.elemSize();
+		if (frame.isContinuous()) {
+			std::memcpy(dst, frame.data, rowBytes * frame.rows);
+			return;
+		}
+		for (int y = 0; y < frame.rows; ++y)
+			std::memcpy(dst + y * rowBytes, frame.ptr<uchar>(y), rowBytes);
+	}
+
+	// GL_BGR rows of w*3 bytes are not 4-byte aligned in general
+	static void texSubImageBGR(GLuint tex, int w, int h, const void* pixels) {
+		glBindTexture(GL_TEXTURE_2D, tex);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_BGR, GL_UNSIGNED_BYTE, pixels);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	// The planes of an I420 frame starting at pixels (nullptr: at offset 0 of the bound PBO).
+	// Chroma rows of w / 2 bytes are not 4-byte aligned in general either.
+	static void texSubImageI420(const FrameTextures& t, int w, int h, const uchar* pixels) {
+		const size_t lumaBytes = (size_t)w * h, chromaBytes = lumaBytes / 4;
+		const struct { GLuint tex; int w, h; size_t off; } planes[3] = {
+			{ t.tex, w, h, 0 }, { t.texU, w / 2, h / 2, lumaBytes }, { t.texV, w / 2, h / 2, lumaBytes + chromaBytes }
+		};
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (const auto& p : planes) {
+			glBindTexture(GL_TEXTURE_2D, p.tex);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, p.w, p.h, GL_RED, GL_UNSIGNED_BYTE,
+				pixels ? (const void*)(pixels + p.off) : (const void*)p.off);
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	// NV12: the Y plane, then the interleaved UV plane as GL_RG; YUYV: the same rows of
+	// w * 2 bytes as GL_RG at full width and as GL_RGBA at half width
+	static void texSubImageYuv(const FrameTextures& t, int w, int h, const uchar* pixels) {
+		if (t.format == FrameFormat::I420) { texSubImageI420(t, w, h, pixels); return; }
+		const bool nv12 = t.format == FrameFormat::NV12;
+		const struct { GLuint tex; int w, h; GLenum fmt; size_t off; } parts[2] = {
+			{ t.tex, w, h, GLenum(nv12 ? GL_RED : GL_RG), 0 },
+			{ t.texU, w / 2, nv12 ? h / 2 : h, GLenum(nv12 ? GL_RG : GL_RGBA), nv12 ? (size_t)w * h : 0 }
+		};
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (const auto& p : parts) {
+			glBindTexture(GL_TEXTURE_2D, p.tex);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, p.w, p.h, p.fmt, GL_UNSIGNED_BYTE,
+				pixels ? (const void*)(pixels + p.off) : (const void*)p.off);
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	// Sub-rectangle r of a texture from rows of rowLength pixels, pixels pointing at r's top-left
+	static void texSubRectBGR(GLuint tex, const cv::Rect& r, int rowLength, const void* pixels) {
+		glBindTexture(GL_TEXTURE_2D, tex);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, rowLength);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, r.x, r.y, r.width, r.height, GL_BGR, GL_UNSIGNED_BYTE, pixels);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	static bool g_pboEnabled = true;
+
+	void setPboUploadEnabled(bool on) { g_pboEnabled = on; }
+	bool pboUploadEnabled() { return g_pboEnabled; }
+
+	void PboUploader::init(int width, int height, int slots, FrameFormat format) {
+		release();
+		CV_Assert(format == FrameFormat::BGR || isYuvFormat(format));
+		CV_Assert(format == FrameFormat::BGR || (width & 1) == 0);
+		CV_Assert((format != FrameFormat::I420 && format != FrameFormat::NV12) || (height & 1) == 0);
+		w_ = width; h_ = height;
+		format_ = format;
+		bytes_ = (size_t)rows() * width * CV_ELEM_SIZE(type());
+		slots_ = std::min(std::max(slots, 2), kMaxSlots);
+		cur_ = 0;
+		mode_ = Mode::Direct;
+		if (!g_pboEnabled) return;
+
+		glGenBuffers(slots_, pbo_);
+#if defined(GL_VERSION_4_4)
+		if (GLAD_GL_VERSION_4_4) {
+			const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			bool ok = true;
+			for (int s = 0; s < slots_; ++s) {
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo_[s]);
+				glBufferStorage(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)bytes_, nullptr, flags);
+				mapped_[s] = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)bytes_, flags);
+				ok = ok && mapped_[s] != nullptr;
+			}
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			if (ok) { mode_ = Mode::Persistent; return; }
+
+			// Immutable storage cannot be respecified: start over with fresh buffers
+			for (int s = 0; s < slots_; ++s) {
+				if (!mapped_[s]) continue;
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo_[s]);
+				glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+				mapped_[s] = nullptr;
+			}
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			glDeleteBuffers(slots_, pbo_);
+			glGenBuffers(slots_, pbo_);
+		}
+#endif
+		for (int s = 0; s < slots_; ++s) {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo_[s]);
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)bytes_, nullptr, GL_STREAM_DRAW);
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		mode_ = Mode::Mapped;
+	}
+
+	void PboUploader::release() {
+		for (int s = 0; s < slots_; ++s) {
+			if (fence_[s]) { glDeleteSync(fence_[s]); fence_[s] = nullptr; }
+			if (mapped_[s] && mode_ != Mode::Direct) {
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo_[s]);
+				glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			}
+			mapped_[s] = nullptr;
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		if (mode_ != Mode::Direct && slots_ > 0) glDeleteBuffers(slots_, pbo_);
+		std::fill(pbo_, pbo_ + kMaxSlots, 0u);
+		staging_.release();
+		w_ = h_ = slots_ = cur_ = 0;
+		bytes_ = 0;
+		begun_ = false;
+		format_ = FrameFormat::BGR;
+		mode_ = Mode::Direct;
+	}
+
+	void PboUploader::waitSlot(int s) {
+		if (!fence_[s]) return;
+		// Flush once so the fence can signal, then block until the GL is done reading the slot
+		GLenum r = glClientWaitSync(fence_[s], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+		while (r == GL_TIMEOUT_EXPIRED)
+			r = glClientWaitSync(fence_[s], 0, 1000000000ull);
+		glDeleteSync(fence_[s]);
+		fence_[s] = nullptr;
+	}
+
+	int PboUploader::type() const {
+		switch (format_) {
+		case FrameFormat::I420:
+		case FrameFormat::NV12: return CV_8UC1;
+		case FrameFormat::YUYV: return CV_8UC2;
+		default:                return CV_8UC3;
+		}
+	}
+
+	cv::Mat PboUploader::beginFrame() {
+		CV_Assert(w_ > 0 && h_ > 0 && !begun_);
+		begun_ = true;
+		if (mode_ == Mode::Direct) {
+			staging_.create(rows(), w_, type());
+			return staging_;
+		}
+		waitSlot(cur_);
+		if (mode_ == Mode::Mapped) {
+			// The fence guarantees the GL is done with this slot, so no implicit sync is needed
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo_[cur_]);
+			mapped_[cur_] = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)bytes_,
+				GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			CV_Assert(mapped_[cur_] != nullptr);
+		}
+		return cv::Mat(rows(), w_, type(), mapped_[cur_]);
+	}
+
+	void PboUploader::commit(const FrameTextures& dst, const cv::Mat& frame) {
+		CV_Assert(begun_ && dst.format == format_ && frame.type() == type()
+			&& frame.cols == w_ && frame.rows == rows());
+		begun_ = false;
+
+		if (mode_ == Mode::Direct) {
+			const cv::Mat* src = &frame;
+			if (!frame.isContinuous()) { frame.copyTo(staging_); src = &staging_; }
+			if (format_ != FrameFormat::BGR) texSubImageYuv(dst, w_, h_, src->data);
+			else                             texSubImageBGR(dst.tex, w_, h_, src->data);
+			return;
+		}
+
+		uchar* slot = (uchar*)mapped_[cur_];
+		if (frame.data != slot) copyIntoSlot(slot, frame);
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo_[cur_]);
+		if (mode_ == Mode::Mapped) {
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			mapped_[cur_] = nullptr;
+		}
+		// Offset 0 into the bound PBO
+		if (format_ != FrameFormat::BGR) texSubImageYuv(dst, w_, h_, nullptr);
+		else                             texSubImageBGR(dst.tex, w_, h_, nullptr);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		fence_[cur_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		cur_ = (cur_ + 1) % slots_;
+	}
+
+	void PboUploader::upload(const FrameTextures& dst, const cv::Mat& frame) {
+		if (frame.empty()) return;
+		const int h = framePixelSize(frame, dst.format).height;
+		if (frame.cols != w_ || h != h_ || dst.format != format_) init(frame.cols, h, slots_ ? slots_ : 3, dst.format);
+		beginFrame();
+		commit(dst, frame);
+	}
+
+	void PboUploader::uploadRects(GLuint tex, const cv::Mat& bgr, const std::vector<cv::Rect>& rects) {
+		if (bgr.empty()) return;
+		if (format_ != FrameFormat::BGR || bgr.cols != w_ || bgr.rows != h_ || bgr.type() != CV_8UC3 || bgr.step % 3 != 0) {
+			upload(tex, bgr);
+			return;
+		}
+		if (rects.empty()) return;
+
+		if (mode_ == Mode::Direct) {
+			for (const cv::Rect& r : rects)
+				texSubRectBGR(tex, r, (int)(bgr.step / 3), bgr.ptr<uchar>(r.y) + 3 * r.x);
+			return;
+		}
+
+		// The slot is laid out like a full frame; only the rect rows are written
+		uchar* slot = beginFrame().data;
+		begun_ = false;
+		for (const cv::Rect& r : rects)
+			for (int y = r.y; y < r.y + r.height; ++y)
+				std::memcpy(slot + ((size_t)y * w_ + r.x) * 3, bgr.ptr<uchar>(y) + 3 * r.x, (size_t)r.width * 3);
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo_[cur_]);
+		if (mode_ == Mode::Mapped) {
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			mapped_[cur_] = nullptr;
+		}
+		for (const cv::Rect& r : rects)
+			texSubRectBGR(tex, r, w_, (const void*)(((size_t)r.y * w_ + r.x) * 3));
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		fence_[cur_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		cur_ = (cur_ + 1) % slots_;
+	}
+
+	const char* PboUploader::modeName() const {
+		switch (mode_) {
+		case Mode::Direct:     return "direct";
+		case Mode::Mapped:     return "mapped PBO";
+		case Mode::Persistent: return "persistent PBO";
+		}
+		return "unknown";
+	}
+
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <glad/glad.h>
+#include <opencv2/opencv.hpp>
+#include "gl_utils.hpp"
+
+namespace glutils {
+
+	/// Streaming frame texture uploader.
+	/// Frames are written into a ring of pixel buffer objects and copied into the texture with
+	/// format GL_BGR straight from the PBO, so there is no cvtColor and no synchronous copy from
+	/// client memory. Each slot is guarded by a fence: the CPU fills slot N+1 while the GL is
+	/// still reading slot N, and only waits if it wraps around onto a slot still in flight.
+	/// YUV frames (I420 / NV12: 1.5 bytes per pixel, YUYV: 2, instead of 3) take the same path:
+	/// the slot holds the frame as it is and each FrameTextures texture reads its part of it.
+	class PboUploader {
+	public:
+		enum class Mode {
+			Direct,        // no PBOs: glTexSubImage2D(GL_BGR) from client memory
+			Mapped,        // glMapBufferRange(INVALIDATE | UNSYNCHRONIZED) per frame (GL 3.3)
+			Persistent     // glBufferStorage, mapped once (GL 4.4)
+		};
+
+		PboUploader() = default;
+		PboUploader(const PboUploader&) = delete;
+		PboUploader& operator=(const PboUploader&) = delete;
+
+		/// Allocate `slots` PBOs for width x height frames in format (BGR8 or a YUV layout, see
+		/// createFrameTextures). Needs a current GL context. Falls back to Mode::Direct when PBO
+		/// uploads are disabled (setPboUploadEnabled).
+		void init(int width, int height, int slots = 3, FrameFormat format = FrameFormat::BGR);
+		/// Free the PBOs; call while the context is still current (like the textures)
+		void release();
+
+		/// Writable view of the next slot, a Mat in the FrameFormat layout; valid
+		/// until commit(). The memory may be write-combined: fill it with sequential writes only
+		/// and never read it back.
+		cv::Mat beginFrame();
+
+		/// Queue the texture update for the frame started with beginFrame(). If `frame` is not
+		/// the view beginFrame() returned, it is copied into the slot first. The textures must
+		/// be width x height and match the frame layout (FrameTextures::format).
+		void commit(const FrameTextures& dst, const cv::Mat& frame);
+		void commit(GLuint tex, const cv::Mat& bgr) { commit(FrameTextures{ tex }, bgr); }
+
+		/// beginFrame() + commit(); re-inits if the frame size or layout changed. dst decides
+		/// the layout: frame must be in dst.format.
+		void upload(const FrameTextures& dst, const cv::Mat& frame);
+		void upload(GLuint tex, const cv::Mat& bgr) { upload(FrameTextures{ tex }, bgr); }
+
+		/// Update only the given disjoint rectangles of tex from the same regions of bgr; the rest
+		/// of the texture keeps its contents. Goes through a slot like upload() (only the rect
+		/// rows are copied) and falls back to a full upload if the frame size changed. BGR only.
+		void uploadRects(GLuint tex, const cv::Mat& bgr, const std::vector<cv::Rect>& rects);
+
+		Mode mode() const { return mode_; }
+		const char* modeName() const;
+		int width() const { return w_; }
+		int height() const { return h_; }
+		FrameFormat format() const { return format_; }
+
+	private:
+		void waitSlot(int s);
+		int rows() const { return format_ == FrameFormat::I420 || format_ == FrameFormat::NV12 ? h_ * 3 / 2 : h_; }
+		int type() const;
+
+		static constexpr int kMaxSlots = 4;
+		Mode mode_ = Mode::Direct;
+		int w_ = 0, h_ = 0, slots_ = 0, cur_ = 0;
+		size_t bytes_ = 0;
+		bool begun_ = false;
+		FrameFormat format_ = FrameFormat::BGR;
+		GLuint pbo_[kMaxSlots] = {};
+		GLsync fence_[kMaxSlots] = {};
+		void* mapped_[kMaxSlots] = {};
+		cv::Mat staging_;              // Direct mode: client-memory "slot"
+	};
+
+	/// Process-wide switch used by PboUploader::init (on by default, --no-pbo turns it off)
+	void setPboUploadEnabled(bool on);
+	bool pboUploadEnabled();
+
+}
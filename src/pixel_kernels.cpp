@@ -0,0 +1,106 @@
+#include "pixel_kernels.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#if defined(VC_KERNELS_X86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+const char* cpuIsaName(CpuIsa isa) {
+    switch (isa) {
+    case CpuIsa::Scalar: return "scalar";
+    case CpuIsa::Sse42:  return "sse42";
+    case CpuIsa::Avx2:   return "avx2";
+    case CpuIsa::Avx512: return "avx512";
+    }
+    return "unknown";
+}
+
+#if defined(VC_KERNELS_X86)
+static void cpuid(int leaf, int sub, unsigned r[4]) {
+#if defined(_MSC_VER)
+    int v[4];
+    __cpuidex(v, leaf, sub);
+    for (int i = 0; i < 4; ++i) r[i] = (unsigned)v[i];
+#else
+    __cpuid_count(leaf, sub, r[0], r[1], r[2], r[3]);
+#endif
+}
+
+// XCR0: which register states the OS saves on context switch
+static unsigned long long xgetbv0() {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((unsigned long long)hi << 32) | lo;
+#endif
+}
+#endif
+
+CpuIsa detectCpuIsa() {
+#if defined(VC_KERNELS_X86)
+    unsigned r[4];
+    cpuid(0, 0, r);
+    const unsigned maxLeaf = r[0];
+    if (maxLeaf < 1) return CpuIsa::Scalar;
+
+    cpuid(1, 0, r);
+    const bool ssse3 = r[2] & (1u << 9), sse42 = r[2] & (1u << 20);
+    const bool osxsave = r[2] & (1u << 27), avx = r[2] & (1u << 28);
+    if (!ssse3 || !sse42) return CpuIsa::Scalar;
+    if (!osxsave || !avx || maxLeaf < 7) return CpuIsa::Sse42;
+
+    const unsigned long long xcr0 = xgetbv0();
+    if ((xcr0 & 0x6) != 0x6) return CpuIsa::Sse42;                 // XMM + YMM
+    cpuid(7, 0, r);
+    const bool avx2 = r[1] & (1u << 5);
+    const bool avx512 = (r[1] & (1u << 16)) && (r[1] & (1u << 30)) && (r[1] & (1u << 31));    // F, BW, VL
+    if (!avx2) return CpuIsa::Sse42;
+    if (!avx512 || (xcr0 & 0xE0) != 0xE0) return CpuIsa::Avx2;     // opmask + ZMM
+    return CpuIsa::Avx512;
+#else
+    return CpuIsa::Scalar;
+#endif
+}
+
+static const PixelKernels* kernelTable(CpuIsa isa) {
+    switch (isa) {
+    case CpuIsa::Sse42:  return pixelKernelsSse42();
+    case CpuIsa::Avx2:   return pixelKernelsAvx2();
+    case CpuIsa::Avx512: return pixelKernelsAvx512();
+    default:             return pixelKernelsScalar();
+    }
+}
+
+static const PixelKernels& selectKernels() {
+    const CpuIsa detected = detectCpuIsa();
+    CpuIsa want = detected;
+    if (const char* env = std::getenv("VC_CPU_ISA")) {
+        bool known = false;
+        for (int i = 0; i <= (int)CpuIsa::Avx512; ++i) {
+            if (std::strcmp(env, cpuIsaName((CpuIsa)i)) == 0) { want = (CpuIsa)i; known = true; }
+        }
+        if (!known)
+            std::cerr << "[CPU] unknown VC_CPU_ISA '" << env << "', using " << cpuIsaName(detected) << "\n";
+        else if ((int)want > (int)detected) {
+            std::cerr << "[CPU] VC_CPU_ISA=" << env << " not supported here, using " << cpuIsaName(detected) << "\n";
+            want = detected;
+        }
+    }
+    for (int i = (int)want; i > 0; --i) {
+        if (const PixelKernels* k = kernelTable((CpuIsa)i)) return *k;
+    }
+    return *pixelKernelsScalar();
+}
+
+const PixelKernels& pixelKernels() {
+    static const PixelKernels& k = selectKernels();
+    return k;
+}
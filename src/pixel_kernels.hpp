@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Hot pixel loops, built once per instruction set (pixel_kernels_<isa>.cpp, each compiled with
+// its own -m / /arch flags from the shared pixel_kernels.inl) and picked at run time: the best
+// level the CPU and OS support, unless the environment variable VC_CPU_ISA forces one
+// (scalar | sse42 | avx2 | avx512) for A/B runs. A forced level the CPU lacks falls back to
+// the detected one.
+enum class CpuIsa { Scalar = 0, Sse42, Avx2, Avx512 };
+
+const char* cpuIsaName(CpuIsa isa);     // "scalar", "sse42", "avx2", "avx512"
+
+// SinCity: keep a pixel if its squared BGR distance to (b, g, r) is below lim, else replace
+// it by its luma (OpenCV 4's Q15 BGR2GRAY weights, identical to cvtColor)
+struct SinCityKey {
+    int b, g, r;
+    int lim;
+};
+constexpr int kGrayShift = 15;
+constexpr int kGrayB = 3735, kGrayG = 19235, kGrayR = 9798;
+
+// Warp: 16.16 source positions; the blend uses the top kWarpWeightBits of the fraction
+// (cv::warpAffine itself interpolates with 5 bits)
+constexpr int kWarpFracBits = 16;
+constexpr int kWarpWeightBits = 11;
+
+struct PixelKernels {
+    CpuIsa isa;
+
+    // SinCity on n interleaved BGR pixels, in place
+    void (*sinCitySpan)(uint8_t* p, int n, const SinCityKey& k);
+
+    // Interior span of a bilinear affine warp (warp_engine.hpp): pixel i of dst samples src at
+    // (u + i * du, v + i * dv), fixed point with kWarpFracBits fractional bits in integer-centered
+    // coordinates (pixel (i, j) at (i, j)). The caller guarantees that all four taps of every
+    // pixel lie inside src and that byte offsets into src fit in an int
+    void (*warpSpanBilinear)(const uint8_t* src, size_t step, int u, int v, int du, int dv,
+        int n, uint8_t* dst);
+
+    // Pixelate block fill: expand sx cell colors into one output row of width pixels, output
+    // pixel x taking cell x * sx / width (INTER_NEAREST)
+    void (*expandCellsBGR)(uint8_t* dst, const uint8_t* cells, int sx, int width);
+};
+
+// Kernels of the selected level; detection runs once, on first use
+const PixelKernels& pixelKernels();
+
+// Best level this CPU / OS supports, regardless of VC_CPU_ISA
+CpuIsa detectCpuIsa();
+
+// Per-level tables, nullptr when that level is not compiled in (non-x86 builds)
+const PixelKernels* pixelKernelsScalar();
+const PixelKernels* pixelKernelsSse42();
+const PixelKernels* pixelKernelsAvx2();
+const PixelKernels* pixelKernelsAvx512();
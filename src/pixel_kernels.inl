@@ -0,0 +1,366 @@
+// Pixel kernels, included once per instruction-set level by pixel_kernels_<isa>.cpp with
+//   VC_KERNEL_ISA    0 scalar, 1 SSE4.2, 2 AVX2, 3 AVX-512 (F + BW + VL)
+//   VC_KERNEL_NS     namespace of this build
+//   VC_KERNEL_ENTRY  name of the table accessor (pixel_kernels.hpp)
+// Everything here lives in VC_KERNEL_NS and calls no inline functions from other headers
+// (pixel_kernels.hpp pulls in only <cstddef> / <cstdint>, bytes are uint8_t rather than
+// OpenCV's uchar): the linker keeps one copy of an inline function across all TUs, and
+// that copy could be the one compiled with AVX-512 flags. All kernels are integer arithmetic,
+// so results are bit-identical across levels.
+#include "pixel_kernels.hpp"
+#include <string.h>
+
+#if VC_KERNEL_ISA > 0 && !defined(VC_KERNELS_X86)
+// Not an x86 build: only the scalar level exists
+const PixelKernels* VC_KERNEL_ENTRY() { return nullptr; }
+#else
+
+#if VC_KERNEL_ISA > 0
+#include <immintrin.h>
+#endif
+
+namespace VC_KERNEL_NS {
+
+// ---------------- SinCity ----------------
+// Squared BGR distance to the key (integer, no sqrt) decides between the original color and
+// its luma, written back in place
+
+static inline void sinCityPixel(uint8_t* p, const SinCityKey& k) {
+    const int b = p[0], g = p[1], r = p[2];
+    const int db = b - k.b, dg = g - k.g, dr = r - k.r;
+    if (db * db + dg * dg + dr * dr < k.lim) return;
+    const uint8_t y = (uint8_t)((b * kGrayB + g * kGrayG + r * kGrayR + (1 << (kGrayShift - 1))) >> kGrayShift);
+    p[0] = p[1] = p[2] = y;
+}
+
+#if VC_KERNEL_ISA >= 1
+// 16 interleaved BGR pixels (48 bytes in v0..v2) <-> planar 16-byte B/G/R vectors
+static inline void deinterleaveBGR16(__m128i v0, __m128i v1, __m128i v2,
+    __m128i& b, __m128i& g, __m128i& r)
+{
+    b = _mm_or_si128(_mm_or_si128(
+        _mm_shuffle_epi8(v0, _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+        _mm_shuffle_epi8(v1, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1))),
+        _mm_shuffle_epi8(v2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13)));
+    g = _mm_or_si128(_mm_or_si128(
+        _mm_shuffle_epi8(v0, _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+        _mm_shuffle_epi8(v1, _mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1))),
+        _mm_shuffle_epi8(v2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14)));
+    r = _mm_or_si128(_mm_or_si128(
+        _mm_shuffle_epi8(v0, _mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+        _mm_shuffle_epi8(v1, _mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1))),
+        _mm_shuffle_epi8(v2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15)));
+}
+
+// Per-pixel byte x (16 pixels) -> replicated over the 3 channels of output vector 0/1/2
+static inline __m128i expandTo3(__m128i x, int j) {
+    switch (j) {
+    case 0:  return _mm_shuffle_epi8(x, _mm_setr_epi8(0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5));
+    case 1:  return _mm_shuffle_epi8(x, _mm_setr_epi8(5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10));
+    default: return _mm_shuffle_epi8(x, _mm_setr_epi8(10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15));
+    }
+}
+
+// Select original (keep8 = 0xFF) or luma per pixel for 16 pixels, in place
+static inline void blendStore16(uint8_t* p, const __m128i v[3], __m128i keep8, __m128i y8) {
+    for (int j = 0; j < 3; ++j) {
+        const __m128i m = expandTo3(keep8, j);
+        const __m128i out = _mm_or_si128(_mm_and_si128(m, v[j]), _mm_andnot_si128(m, expandTo3(y8, j)));
+        _mm_storeu_si128((__m128i*)(p + 16 * j), out);
+    }
+}
+#endif
+
+#if VC_KERNEL_ISA >= 2
+// AVX2: all 16 pixels in one 16x16-bit register set
+struct SinCitySimd {
+    __m256i kb, kg, kr, lim, wBG, wR1, one;
+    explicit SinCitySimd(const SinCityKey& k)
+        : kb(_mm256_set1_epi16((short)k.b)), kg(_mm256_set1_epi16((short)k.g)), kr(_mm256_set1_epi16((short)k.r)),
+          lim(_mm256_set1_epi32(k.lim)),
+          wBG(_mm256_set1_epi32((kGrayG << 16) | kGrayB)),
+          wR1(_mm256_set1_epi32(((1 << (kGrayShift - 1)) << 16) | kGrayR)),
+          one(_mm256_set1_epi16(1)) {}
+
+    // keep mask (0xFF / 0x00) and luma for 16 planar pixels
+    void run(__m128i b8, __m128i g8, __m128i r8, __m128i& keep8, __m128i& y8) const {
+        const __m256i b = _mm256_cvtepu8_epi16(b8), g = _mm256_cvtepu8_epi16(g8), r = _mm256_cvtepu8_epi16(r8);
+        const __m256i zero = _mm256_setzero_si256();
+
+        const __m256i db = _mm256_sub_epi16(b, kb), dg = _mm256_sub_epi16(g, kg), dr = _mm256_sub_epi16(r, kr);
+        const __m256i bgL = _mm256_unpacklo_epi16(db, dg), bgH = _mm256_unpackhi_epi16(db, dg);
+        const __m256i rL = _mm256_unpacklo_epi16(dr, zero), rH = _mm256_unpackhi_epi16(dr, zero);
+        const __m256i d2L = _mm256_add_epi32(_mm256_madd_epi16(bgL, bgL), _mm256_madd_epi16(rL, rL));
+        const __m256i d2H = _mm256_add_epi32(_mm256_madd_epi16(bgH, bgH), _mm256_madd_epi16(rH, rH));
+        // unpack lo/hi + packs are both per 128-bit lane, so pixel order is preserved
+        const __m256i keep16 = _mm256_packs_epi32(_mm256_cmpgt_epi32(lim, d2L), _mm256_cmpgt_epi32(lim, d2H));
+
+        const __m256i lBG = _mm256_unpacklo_epi16(b, g), hBG = _mm256_unpackhi_epi16(b, g);
+        const __m256i lR1 = _mm256_unpacklo_epi16(r, one), hR1 = _mm256_unpackhi_epi16(r, one);
+        const __m256i yL = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(lBG, wBG), _mm256_madd_epi16(lR1, wR1)), kGrayShift);
+        const __m256i yH = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(hBG, wBG), _mm256_madd_epi16(hR1, wR1)), kGrayShift);
+        const __m256i y16 = _mm256_packs_epi32(yL, yH);
+
+        keep8 = _mm_packs_epi16(_mm256_castsi256_si128(keep16), _mm256_extracti128_si256(keep16, 1));
+        y8 = _mm_packus_epi16(_mm256_castsi256_si128(y16), _mm256_extracti128_si256(y16, 1));
+    }
+};
+#elif VC_KERNEL_ISA == 1
+// SSE4.2 (SSSE3 shuffles): two halves of 8 pixels each
+struct SinCitySimd {
+    __m128i kb, kg, kr, lim, wBG, wR1, one;
+    explicit SinCitySimd(const SinCityKey& k)
+        : kb(_mm_set1_epi16((short)k.b)), kg(_mm_set1_epi16((short)k.g)), kr(_mm_set1_epi16((short)k.r)),
+          lim(_mm_set1_epi32(k.lim)),
+          wBG(_mm_set1_epi32((kGrayG << 16) | kGrayB)),
+          wR1(_mm_set1_epi32(((1 << (kGrayShift - 1)) << 16) | kGrayR)),
+          one(_mm_set1_epi16(1)) {}
+
+    void half(__m128i b, __m128i g, __m128i r, __m128i& keep16, __m128i& y16) const {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i db = _mm_sub_epi16(b, kb), dg = _mm_sub_epi16(g, kg), dr = _mm_sub_epi16(r, kr);
+        const __m128i bgL = _mm_unpacklo_epi16(db, dg), bgH = _mm_unpackhi_epi16(db, dg);
+        const __m128i rL = _mm_unpacklo_epi16(dr, zero), rH = _mm_unpackhi_epi16(dr, zero);
+        const __m128i d2L = _mm_add_epi32(_mm_madd_epi16(bgL, bgL), _mm_madd_epi16(rL, rL));
+        const __m128i d2H = _mm_add_epi32(_mm_madd_epi16(bgH, bgH), _mm_madd_epi16(rH, rH));
+        keep16 = _mm_packs_epi32(_mm_cmpgt_epi32(lim, d2L), _mm_cmpgt_epi32(lim, d2H));
+
+        const __m128i lBG = _mm_unpacklo_epi16(b, g), hBG = _mm_unpackhi_epi16(b, g);
+        const __m128i lR1 = _mm_unpacklo_epi16(r, one), hR1 = _mm_unpackhi_epi16(r, one);
+        const __m128i yL = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(lBG, wBG), _mm_madd_epi16(lR1, wR1)), kGrayShift);
+        const __m128i yH = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(hBG, wBG), _mm_madd_epi16(hR1, wR1)), kGrayShift);
+        y16 = _mm_packs_epi32(yL, yH);
+    }
+
+    void run(__m128i b8, __m128i g8, __m128i r8, __m128i& keep8, __m128i& y8) const {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i kL, kH, yL, yH;
+        half(_mm_unpacklo_epi8(b8, zero), _mm_unpacklo_epi8(g8, zero), _mm_unpacklo_epi8(r8, zero), kL, yL);
+        half(_mm_unpackhi_epi8(b8, zero), _mm_unpackhi_epi8(g8, zero), _mm_unpackhi_epi8(r8, zero), kH, yH);
+        keep8 = _mm_packs_epi16(kL, kH);
+        y8 = _mm_packus_epi16(yL, yH);
+    }
+};
+#endif
+
+#if VC_KERNEL_ISA >= 1
+// 16 pixels: read once, select original / luma per pixel, write back in place
+static inline void sinCityBlock16(uint8_t* p, const SinCitySimd& s) {
+    const __m128i v[3] = {
+        _mm_loadu_si128((const __m128i*)(p)),
+        _mm_loadu_si128((const __m128i*)(p + 16)),
+        _mm_loadu_si128((const __m128i*)(p + 32))
+    };
+    __m128i b, g, r, keep8, y8;
+    deinterleaveBGR16(v[0], v[1], v[2], b, g, r);
+    s.run(b, g, r, keep8, y8);
+    blendStore16(p, v, keep8, y8);
+}
+#endif
+
+#if VC_KERNEL_ISA >= 3
+// AVX-512BW: 32 pixels per step, the AVX2 arithmetic on 32 16-bit lanes
+struct SinCitySimd32 {
+    static constexpr __mmask16 kAll16 = 0xFFFF;
+    static constexpr __mmask32 kAll32 = 0xFFFFFFFFu;
+    __m512i kb, kg, kr, lim, wBG, wR1, one;
+    explicit SinCitySimd32(const SinCityKey& k)
+        : kb(_mm512_set1_epi16((short)k.b)), kg(_mm512_set1_epi16((short)k.g)), kr(_mm512_set1_epi16((short)k.r)),
+          lim(_mm512_set1_epi32(k.lim)),
+          wBG(_mm512_set1_epi32((kGrayG << 16) | kGrayB)),
+          wR1(_mm512_set1_epi32(((1 << (kGrayShift - 1)) << 16) | kGrayR)),
+          one(_mm512_set1_epi16(1)) {}
+
+    void run(__m256i b8, __m256i g8, __m256i r8, __m256i& keep8, __m256i& y8) const {
+        const __m512i b = _mm512_cvtepu8_epi16(b8), g = _mm512_cvtepu8_epi16(g8), r = _mm512_cvtepu8_epi16(r8);
+        const __m512i zero = _mm512_setzero_si512(), ones = _mm512_set1_epi32(-1);
+
+        const __m512i db = _mm512_sub_epi16(b, kb), dg = _mm512_sub_epi16(g, kg), dr = _mm512_sub_epi16(r, kr);
+        const __m512i bgL = _mm512_unpacklo_epi16(db, dg), bgH = _mm512_unpackhi_epi16(db, dg);
+        const __m512i rL = _mm512_unpacklo_epi16(dr, zero), rH = _mm512_unpackhi_epi16(dr, zero);
+        const __m512i d2L = _mm512_add_epi32(_mm512_madd_epi16(bgL, bgL), _mm512_madd_epi16(rL, rL));
+        const __m512i d2H = _mm512_add_epi32(_mm512_madd_epi16(bgH, bgH), _mm512_madd_epi16(rH, rH));
+        // Per-128-bit-lane unpack / pack as in the AVX2 path keeps the pixel order
+        const __m512i kL = _mm512_mask_blend_epi32(_mm512_cmpgt_epi32_mask(lim, d2L), zero, ones);
+        const __m512i kH = _mm512_mask_blend_epi32(_mm512_cmpgt_epi32_mask(lim, d2H), zero, ones);
+        const __m512i keep16 = _mm512_packs_epi32(kL, kH);
+
+        const __m512i lBG = _mm512_unpacklo_epi16(b, g), hBG = _mm512_unpackhi_epi16(b, g);
+        const __m512i lR1 = _mm512_unpacklo_epi16(r, one), hR1 = _mm512_unpackhi_epi16(r, one);
+        // The unmasked srai / cvtepi16_epi8 intrinsics pass an undefined vector as the merge
+        // source, which GCC reports as -Wmaybe-uninitialized; the all-lanes zero-masked forms
+        // compile to the same instructions
+        const __m512i yL = _mm512_maskz_srai_epi32(kAll16, _mm512_add_epi32(_mm512_madd_epi16(lBG, wBG), _mm512_madd_epi16(lR1, wR1)), kGrayShift);
+        const __m512i yH = _mm512_maskz_srai_epi32(kAll16, _mm512_add_epi32(_mm512_madd_epi16(hBG, wBG), _mm512_madd_epi16(hR1, wR1)), kGrayShift);
+        const __m512i y16 = _mm512_packs_epi32(yL, yH);
+
+        // 0 / -1 and 0..255 narrow exactly by truncation
+        keep8 = _mm512_maskz_cvtepi16_epi8(kAll32, keep16);
+        y8 = _mm512_maskz_cvtepi16_epi8(kAll32, y16);
+    }
+};
+
+static inline void sinCityBlock32(uint8_t* p, const SinCitySimd32& s) {
+    const __m128i v[6] = {
+        _mm_loadu_si128((const __m128i*)(p)),      _mm_loadu_si128((const __m128i*)(p + 16)),
+        _mm_loadu_si128((const __m128i*)(p + 32)), _mm_loadu_si128((const __m128i*)(p + 48)),
+        _mm_loadu_si128((const __m128i*)(p + 64)), _mm_loadu_si128((const __m128i*)(p + 80))
+    };
+    __m128i b0, g0, r0, b1, g1, r1;
+    deinterleaveBGR16(v[0], v[1], v[2], b0, g0, r0);
+    deinterleaveBGR16(v[3], v[4], v[5], b1, g1, r1);
+    __m256i keep8, y8;
+    s.run(_mm256_inserti128_si256(_mm256_castsi128_si256(b0), b1, 1),
+        _mm256_inserti128_si256(_mm256_castsi128_si256(g0), g1, 1),
+        _mm256_inserti128_si256(_mm256_castsi128_si256(r0), r1, 1), keep8, y8);
+    blendStore16(p, v, _mm256_castsi256_si128(keep8), _mm256_castsi256_si128(y8));
+    blendStore16(p + 48, v + 3, _mm256_extracti128_si256(keep8, 1), _mm256_extracti128_si256(y8, 1));
+}
+#endif
+
+static void sinCitySpan(uint8_t* p, int n, const SinCityKey& k) {
+    int x = 0;
+#if VC_KERNEL_ISA >= 3
+    const SinCitySimd32 s32(k);
+    for (; x + 32 <= n; x += 32, p += 96) sinCityBlock32(p, s32);
+#endif
+#if VC_KERNEL_ISA >= 1
+    const SinCitySimd s(k);
+    for (; x + 16 <= n; x += 16, p += 48) sinCityBlock16(p, s);
+#endif
+    for (; x < n; ++x, p += 3) sinCityPixel(p, k);
+}
+
+// ---------------- Bilinear affine warp ----------------
+// Fixed point (pixel_kernels.hpp): pixel i of the span samples the source at
+// (u + i * du, v + i * dv) with kWarpFracBits fractional bits, in integer-centered coordinates.
+// The caller guarantees all four taps of every pixel lie inside the source, so there are no
+// bounds checks; the integer blend is exact, hence identical at every level.
+
+static const int kWeightOne = 1 << kWarpWeightBits;
+static const int kBlendShift = 2 * kWarpWeightBits;
+
+static inline void bilinearFixed(const uint8_t* src, size_t step, int U, int V, uint8_t* out) {
+    const int x0 = U >> kWarpFracBits, y0 = V >> kWarpFracBits;
+    const int ax = (U >> (kWarpFracBits - kWarpWeightBits)) & (kWeightOne - 1);
+    const int ay = (V >> (kWarpFracBits - kWarpWeightBits)) & (kWeightOne - 1);
+    const int w00 = (kWeightOne - ax) * (kWeightOne - ay), w01 = ax * (kWeightOne - ay);
+    const int w10 = (kWeightOne - ax) * ay, w11 = ax * ay;
+    const uint8_t* p = src + (size_t)y0 * step + 3 * (size_t)x0;
+    const uint8_t* q = p + step;
+    for (int c = 0; c < 3; ++c)
+        out[c] = (uint8_t)((p[c] * w00 + p[3 + c] * w01 + q[c] * w10 + q[3 + c] * w11 + (1 << (kBlendShift - 1))) >> kBlendShift);
+}
+
+#if VC_KERNEL_ISA >= 2
+// 8 pixels packed as BGRx in 32-bit lanes -> 24 bytes at out
+static inline void storeBGR8(__m256i px, uint8_t* out) {
+    const __m256i packed = _mm256_shuffle_epi8(px, _mm256_setr_epi8(
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1));
+    const __m128i lo = _mm256_castsi256_si128(packed), hi = _mm256_extracti128_si256(packed, 1);
+    _mm_storel_epi64((__m128i*)out, lo);
+    const int lo2 = _mm_extract_epi32(lo, 2);
+    memcpy(out + 8, &lo2, 4);
+    _mm_storel_epi64((__m128i*)(out + 12), hi);
+    const int hi2 = _mm_extract_epi32(hi, 2);
+    memcpy(out + 20, &hi2, 4);
+}
+
+// 8 pixels at fixed-point positions U, V. Each tap pair is two 4-byte gathers: at the left
+// pixel (B G R + next B) and 2 bytes further (R + right pixel's B G R), both inside the row.
+static inline void warpFixed8(const uint8_t* src, __m256i vstep, __m256i U, __m256i V, uint8_t* out) {
+    const __m256i x0 = _mm256_srai_epi32(U, kWarpFracBits), y0 = _mm256_srai_epi32(V, kWarpFracBits);
+    const __m256i fracMask = _mm256_set1_epi32(kWeightOne - 1), one = _mm256_set1_epi32(kWeightOne);
+    const __m256i ax = _mm256_and_si256(_mm256_srli_epi32(U, kWarpFracBits - kWarpWeightBits), fracMask);
+    const __m256i ay = _mm256_and_si256(_mm256_srli_epi32(V, kWarpFracBits - kWarpWeightBits), fracMask);
+    const __m256i bx = _mm256_sub_epi32(one, ax), by = _mm256_sub_epi32(one, ay);
+
+    const __m256i off = _mm256_add_epi32(_mm256_mullo_epi32(y0, vstep), _mm256_add_epi32(x0, _mm256_add_epi32(x0, x0)));
+    const __m256i offB = _mm256_add_epi32(off, vstep), two = _mm256_set1_epi32(2);
+    const __m256i t00 = _mm256_i32gather_epi32((const int*)src, off, 1);
+    const __m256i t01 = _mm256_srli_epi32(_mm256_i32gather_epi32((const int*)src, _mm256_add_epi32(off, two), 1), 8);
+    const __m256i t10 = _mm256_i32gather_epi32((const int*)src, offB, 1);
+    const __m256i t11 = _mm256_srli_epi32(_mm256_i32gather_epi32((const int*)src, _mm256_add_epi32(offB, two), 1), 8);
+
+    // Horizontal then vertical: the same integer as the four-weight sum of bilinearFixed
+    const __m256i byte = _mm256_set1_epi32(0xFF), half = _mm256_set1_epi32(1 << (kBlendShift - 1));
+    __m256i px = _mm256_setzero_si256();
+    for (int c = 0; c < 3; ++c) {
+        const int s = 8 * c;
+        const __m256i h0 = _mm256_add_epi32(
+            _mm256_mullo_epi32(_mm256_and_si256(_mm256_srli_epi32(t00, s), byte), bx),
+            _mm256_mullo_epi32(_mm256_and_si256(_mm256_srli_epi32(t01, s), byte), ax));
+        const __m256i h1 = _mm256_add_epi32(
+            _mm256_mullo_epi32(_mm256_and_si256(_mm256_srli_epi32(t10, s), byte), bx),
+            _mm256_mullo_epi32(_mm256_and_si256(_mm256_srli_epi32(t11, s), byte), ax));
+        const __m256i r = _mm256_srli_epi32(_mm256_add_epi32(_mm256_add_epi32(
+            _mm256_mullo_epi32(h0, by), _mm256_mullo_epi32(h1, ay)), half), kBlendShift);
+        px = _mm256_or_si256(px, _mm256_slli_epi32(r, s));
+    }
+    storeBGR8(px, out);
+}
+#endif
+
+static void warpSpanBilinear(const uint8_t* src, size_t step, int u, int v, int du, int dv,
+    int n, uint8_t* dst)
+{
+    // Positions wrap in unsigned arithmetic; every one inside the span is in range
+    const unsigned uu = (unsigned)u, uv = (unsigned)v, udu = (unsigned)du, udv = (unsigned)dv;
+    int i = 0;
+#if VC_KERNEL_ISA >= 2
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i laneU = _mm256_mullo_epi32(lane, _mm256_set1_epi32(du));
+    const __m256i laneV = _mm256_mullo_epi32(lane, _mm256_set1_epi32(dv));
+    const __m256i vstep = _mm256_set1_epi32((int)step);
+    for (; i + 8 <= n; i += 8) {
+        const __m256i U = _mm256_add_epi32(_mm256_set1_epi32((int)(uu + (unsigned)i * udu)), laneU);
+        const __m256i V = _mm256_add_epi32(_mm256_set1_epi32((int)(uv + (unsigned)i * udv)), laneV);
+        warpFixed8(src, vstep, U, V, dst + 3 * i);
+    }
+#endif
+    for (; i < n; ++i)
+        bilinearFixed(src, step, (int)(uu + (unsigned)i * udu), (int)(uv + (unsigned)i * udv), dst + 3 * i);
+}
+
+// ---------------- Pixelate block fill ----------------
+
+// Cells of exactly B pixels: fixed-width stores the compiler unrolls / vectorizes per level
+template <int B>
+static void expandFixed(uint8_t* dst, const uint8_t* c, int sx) {
+    for (int i = 0; i < sx; ++i, c += 3, dst += 3 * B) {
+        const uint8_t b = c[0], g = c[1], r = c[2];
+        for (int k = 0; k < B; ++k) { dst[3 * k] = b; dst[3 * k + 1] = g; dst[3 * k + 2] = r; }
+    }
+}
+
+static void expandCellsBGR(uint8_t* dst, const uint8_t* c, int sx, int width) {
+    if (width % sx == 0) {
+        switch (width / sx) {
+        case 2:  expandFixed<2>(dst, c, sx);  return;
+        case 4:  expandFixed<4>(dst, c, sx);  return;
+        case 8:  expandFixed<8>(dst, c, sx);  return;
+        case 16: expandFixed<16>(dst, c, sx); return;
+        case 32: expandFixed<32>(dst, c, sx); return;
+        default: break;
+        }
+    }
+    // Output pixel x belongs to cell x * sx / width
+    for (int i = 0, x = 0; i < sx; ++i, c += 3) {
+        const int xEnd = ((i + 1) * width + sx - 1) / sx;
+        for (; x < xEnd; ++x) { dst[3 * x] = c[0]; dst[3 * x + 1] = c[1]; dst[3 * x + 2] = c[2]; }
+    }
+}
+
+static const PixelKernels kTable = {
+    (CpuIsa)VC_KERNEL_ISA,
+    sinCitySpan,
+    warpSpanBilinear,
+    expandCellsBGR
+};
+
+} // namespace VC_KERNEL_NS
+
+const PixelKernels* VC_KERNEL_ENTRY() { return &VC_KERNEL_NS::kTable; }
+
+#endif
@@ -0,0 +1,5 @@
+// AVX2 build of pixel_kernels.inl (compile flags set per file in CMakeLists.txt)
+#define VC_KERNEL_ISA 2
+#define VC_KERNEL_NS kernels_avx2
+#define VC_KERNEL_ENTRY pixelKernelsAvx2
+#include "pixel_kernels.inl"
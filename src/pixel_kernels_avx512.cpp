@@ -0,0 +1,5 @@
+// AVX-512 build of pixel_kernels.inl (compile flags set per file in CMakeLists.txt)
+#define VC_KERNEL_ISA 3
+#define VC_KERNEL_NS kernels_avx512
+#define VC_KERNEL_ENTRY pixelKernelsAvx512
+#include "pixel_kernels.inl"
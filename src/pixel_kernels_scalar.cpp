@@ -0,0 +1,5 @@
+// Scalar build of pixel_kernels.inl (compile flags set per file in CMakeLists.txt)
+#define VC_KERNEL_ISA 0
+#define VC_KERNEL_NS kernels_scalar
+#define VC_KERNEL_ENTRY pixelKernelsScalar
+#include "pixel_kernels.inl"
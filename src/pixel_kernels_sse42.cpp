@@ -0,0 +1,5 @@
+// SSE4.2 build of pixel_kernels.inl (compile flags set per file in CMakeLists.txt)
+#define VC_KERNEL_ISA 1
+#define VC_KERNEL_NS kernels_sse42
+#define VC_KERNEL_ENTRY pixelKernelsSse42
+#include "pixel_kernels.inl"
@@ -0,0 +1,161 @@
+#include "shader_cache.hpp"
+#include "gl_utils.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace glutils {
+
+	static const uint32_t kMagic = 0x42504356;     // "VCPB"
+	static const uint32_t kFileVersion = 1;
+
+	// FNV-1a, 64 bit
+	static uint64_t fnv1a(const std::string& s, uint64_t h = 1469598103934665603ull) {
+		for (unsigned char c : s) { h ^= c; h *= 1099511628211ull; }
+		return h;
+	}
+
+	static std::string hex64(uint64_t v) {
+		char buf[17];
+		std::snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)v);
+		return buf;
+	}
+
+	static std::string glString(GLenum name) {
+		const GLubyte* s = glGetString(name);
+		return s ? (const char*)s : "";
+	}
+
+	bool programBinarySupported() {
+#if defined(GL_VERSION_4_1)
+		if (GLAD_GL_VERSION_4_1) return true;
+#endif
+#if defined(GL_ARB_get_program_binary)
+		if (GLAD_GL_ARB_get_program_binary) return true;
+#endif
+		return false;
+	}
+
+	ProgramCache& programCache() {
+		static ProgramCache cache = [] {
+			ProgramCache c;
+			const char* env = std::getenv("VC_SHADER_CACHE");
+			c.setDirectory(env ? env : "shader_cache");
+			return c;
+		}();
+		return cache;
+	}
+
+	bool ProgramCache::available() {
+		if (dir_.empty()) return false;
+		if (formats_ < 0) {
+			formats_ = 0;
+#if defined(VC_HAVE_PROGRAM_BINARY)
+			if (programBinarySupported()) glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats_);
+#endif
+			driver_ = glString(GL_VENDOR) + "\n" + glString(GL_RENDERER) + "\n" + glString(GL_VERSION);
+		}
+		return formats_ > 0;
+	}
+
+	// File: magic, version, driver string, source hash, binary format, binary
+	GLuint ProgramCache::loadBinary(const std::string& path, uint64_t srcHash) {
+#if defined(VC_HAVE_PROGRAM_BINARY)
+		std::ifstream f(path, std::ios::binary);
+		if (!f) return 0;
+		uint32_t magic = 0, version = 0, driverLen = 0, format = 0, size = 0;
+		uint64_t hash = 0;
+		f.read((char*)&magic, 4).read((char*)&version, 4).read((char*)&driverLen, 4);
+		if (!f || magic != kMagic || version != kFileVersion || driverLen != driver_.size()) return 0;
+		std::string driver(driverLen, '\0');
+		f.read(&driver[0], driverLen).read((char*)&hash, 8).read((char*)&format, 4).read((char*)&size, 4);
+		if (!f || driver != driver_ || hash != srcHash || size == 0) return 0;
+		std::vector<char> bin(size);
+		if (!f.read(bin.data(), size)) return 0;
+
+		GLuint prog = glCreateProgram();
+		glProgramBinary(prog, (GLenum)format, bin.data(), (GLsizei)size);
+		GLint ok = 0;
+		glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+		if (ok) return prog;
+		glDeleteProgram(prog);
+		++stats_.rejected;
+#else
+		(void)path; (void)srcHash;
+#endif
+		return 0;
+	}
+
+	void ProgramCache::storeBinary(const std::string& path, uint64_t srcHash, GLuint prog) {
+#if defined(VC_HAVE_PROGRAM_BINARY)
+		GLint len = 0;
+		glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &len);
+		if (len <= 0) return;
+		std::vector<char> bin((size_t)len);
+		GLenum format = 0;
+		GLsizei got = 0;
+		glGetProgramBinary(prog, len, &got, &format, bin.data());
+		if (got <= 0) return;
+
+		std::error_code ec;
+		std::filesystem::create_directories(dir_, ec);
+		// Write next to the target and move it in, so a concurrent reader never sees half a file
+		const std::string tmp = path + ".tmp";
+		{
+			std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+			const uint32_t driverLen = (uint32_t)driver_.size(), fmt = (uint32_t)format, size = (uint32_t)got;
+			f.write((const char*)&kMagic, 4).write((const char*)&kFileVersion, 4).write((const char*)&driverLen, 4);
+			f.write(driver_.data(), driverLen).write((const char*)&srcHash, 8);
+			f.write((const char*)&fmt, 4).write((const char*)&size, 4).write(bin.data(), got);
+			if (!f) { std::cerr << "[Shaders] cannot write " << tmp << std::endl; return; }
+		}
+		std::filesystem::rename(tmp, path, ec);
+		if (ec) std::filesystem::remove(tmp, ec);
+#else
+		(void)path; (void)srcHash; (void)prog;
+#endif
+	}
+
+	GLuint ProgramCache::link(const std::string& vsrc, const std::string& fsrc) {
+		const auto t0 = std::chrono::steady_clock::now();
+		auto done = [&](GLuint prog) {
+			stats_.ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+			return prog;
+		};
+
+		if (!available()) {
+			++stats_.compiled;
+			return done(buildProgram(vsrc, fsrc, false));
+		}
+		const uint64_t srcHash = fnv1a(fsrc, fnv1a(std::string(1, '\0'), fnv1a(vsrc)));
+		const std::string path = dir_ + "/" + hex64(fnv1a(driver_, srcHash)) + ".bin";
+		if (GLuint prog = loadBinary(path, srcHash)) {
+			++stats_.loaded;
+			return done(prog);
+		}
+		const GLuint prog = buildProgram(vsrc, fsrc, true);
+		++stats_.compiled;
+		storeBinary(path, srcHash, prog);
+		return done(prog);
+	}
+
+	std::string ProgramCache::summary() const {
+		std::ostringstream s;
+		s.setf(std::ios::fixed);
+		s.precision(1);
+		s << stats_.loaded + stats_.compiled << " program(s) in " << stats_.ms << " ms ("
+			<< stats_.loaded << " from cache, " << stats_.compiled << " compiled";
+		if (stats_.rejected) s << ", " << stats_.rejected << " stale";
+		s << "), cache ";
+		if (dir_.empty())       s << "off";
+		else if (formats_ == 0) s << "unsupported by driver";
+		else                    s << dir_;
+		return s.str();
+	}
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <glad/glad.h>
+
+// glGetProgramBinary / glProgramBinary / glProgramParameteri are declared: core in GL 4.1, or
+// from ARB_get_program_binary (same entry points and enums) if glad was generated with it
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_get_program_binary)
+#define VC_HAVE_PROGRAM_BINARY 1
+#endif
+
+namespace glutils {
+
+	struct ProgramCacheStats {
+		int loaded = 0;                // programs restored from a cached binary
+		int compiled = 0;              // programs compiled from source (miss or rejected binary)
+		int rejected = 0;              // cached binaries the driver refused (driver update, ...)
+		double ms = 0.0;               // total time spent in link()
+	};
+
+	/// On-disk cache of linked GL programs (glGetProgramBinary / glProgramBinary).
+	/// Binaries are stored per program under a hash of both sources and the GL vendor, renderer
+	/// and version strings, so a driver change or an edited / regenerated shader never picks up
+	/// a stale binary. A binary the driver refuses to load is recompiled and overwritten.
+	/// Needs GL 4.1 (or ARB_get_program_binary) and at least one binary format; otherwise every
+	/// program is compiled as before. Must be used from the thread that owns the GL context.
+	class ProgramCache {
+	public:
+		/// Cache directory, created on first store; "" disables the cache. Defaults to
+		/// $VC_SHADER_CACHE or "shader_cache" in the working directory.
+		void setDirectory(const std::string& dir) { dir_ = dir; }
+		const std::string& directory() const { return dir_; }
+
+		/// Linked program for the two sources: from the cache if possible, else compiled,
+		/// linked and stored. Throws like linkProgram on compile / link errors.
+		GLuint link(const std::string& vertexSrc, const std::string& fragmentSrc);
+
+		const ProgramCacheStats& stats() const { return stats_; }
+		/// "4 programs in 12.3 ms (3 from cache, 1 compiled), cache shader_cache"
+		std::string summary() const;
+
+	private:
+		bool available();              // binaries supported by the current context
+		GLuint loadBinary(const std::string& path, uint64_t srcHash);
+		void storeBinary(const std::string& path, uint64_t srcHash, GLuint prog);
+
+		std::string dir_;
+		int formats_ = -1;             // GL_NUM_PROGRAM_BINARY_FORMATS, -1 = not queried yet
+		std::string driver_;           // vendor / renderer / version of the context
+		ProgramCacheStats stats_;
+	};
+
+	/// Process-wide cache used by linkProgram / loadShaderProgram
+	ProgramCache& programCache();
+
+	/// Program binaries usable in the current context: GL 4.1, or ARB_get_program_binary
+	bool programBinarySupported();
+
+}
@@ -0,0 +1,144 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+static thread_local bool tls_inPool = false;
+
+static bool pinCurrentThread(int core) {
+#if defined(_WIN32)
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << (core % 64)) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core % CPU_SETSIZE, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)core;
+    return false;
+#endif
+}
+
+ThreadPool::ThreadPool(const ThreadPoolConfig& cfg) {
+    const int hw = std::max(1, (int)std::thread::hardware_concurrency());
+    const int n = cfg.threads > 0 ? cfg.threads : hw;
+
+    shares_.reset(new Share[n]);
+    pinned_ = cfg.pinCores && n > 1;
+    workers_.reserve(n - 1);
+    for (int i = 0; i < n - 1; ++i) {
+        workers_.emplace_back([this, i, hw, pin = pinned_] {
+            if (pin) pinCurrentThread((i + 1) % hw);
+            workerLoop(i + 1);
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& t : workers_) t.join();
+}
+
+void ThreadPool::parallelFor(int begin, int end, int grain, const RangeFn& fn) {
+    if (end <= begin) return;
+    grain = std::max(1, grain);
+    const int chunks = (end - begin + grain - 1) / grain;
+    if (workers_.empty() || chunks == 1 || tls_inPool) { fn(begin, end); return; }
+
+    std::lock_guard<std::mutex> call(callMutex_);
+    const int n = threads();
+    for (int i = 0; i < n; ++i) {
+        shares_[i].next.store((int)((long long)i * chunks / n), std::memory_order_relaxed);
+        shares_[i].end = (int)((long long)(i + 1) * chunks / n);
+    }
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        fn_ = &fn; begin_ = begin; end_ = end; grain_ = grain;
+        error_ = nullptr;
+        active_ = (int)workers_.size();
+        ++generation_;
+    }
+    wake_.notify_all();
+
+    tls_inPool = true;
+    runShares(0);
+    tls_inPool = false;
+
+    std::exception_ptr err;
+    {
+        std::unique_lock<std::mutex> lk(m_);
+        done_.wait(lk, [this] { return active_ == 0; });
+        fn_ = nullptr;
+        err = error_;
+        error_ = nullptr;
+    }
+    if (err) std::rethrow_exception(err);
+}
+
+void ThreadPool::runShares(int self) {
+    const int n = threads();
+    for (int k = 0; k < n; ++k) {
+        Share& s = shares_[(self + k) % n];   // own share first, then steal round-robin
+        for (;;) {
+            const int c = s.next.fetch_add(1, std::memory_order_relaxed);
+            if (c >= s.end) break;
+            const int b = begin_ + c * grain_;
+            try {
+                (*fn_)(b, std::min(end_, b + grain_));
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lk(m_);
+                if (!error_) error_ = std::current_exception();
+                for (int i = 0; i < n; ++i)
+                    shares_[i].next.store(shares_[i].end, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+void ThreadPool::workerLoop(int idx) {
+    tls_inPool = true;
+    unsigned long long seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lk(m_);
+            wake_.wait(lk, [&] { return stop_ || generation_ != seen; });
+            if (stop_) return;
+            seen = generation_;
+        }
+        runShares(idx);
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            if (--active_ == 0) done_.notify_one();
+        }
+    }
+}
+
+// -------------------- Process-wide pool --------------------
+
+static std::mutex g_poolMutex;
+static ThreadPoolConfig g_poolConfig;
+static std::unique_ptr<ThreadPool> g_pool;
+
+ThreadPool& cpuThreadPool() {
+    std::lock_guard<std::mutex> lk(g_poolMutex);
+    if (!g_pool) g_pool = std::make_unique<ThreadPool>(g_poolConfig);
+    return *g_pool;
+}
+
+void configureCpuThreadPool(const ThreadPoolConfig& cfg) {
+    std::lock_guard<std::mutex> lk(g_poolMutex);
+    g_poolConfig = cfg;
+    g_pool.reset();
+}
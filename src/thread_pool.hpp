@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct ThreadPoolConfig {
+    int  threads = 0;         // total threads incl. the caller; 0 = std::thread::hardware_concurrency()
+    bool pinCores = false;    // pin worker i to core i+1 (the calling thread is left alone)
+};
+
+// Persistent fork-join pool for the CPU frame kernels.
+// parallelFor() cuts [begin, end) into chunks of `grain` items and gives every thread a
+// contiguous share of them. A thread drains its own share first and then steals chunks from
+// the others, so bands that cost more (e.g. warp rows with a lot of border) even out.
+// The calling thread takes part; nested calls and single-chunk ranges run inline.
+class ThreadPool {
+public:
+    using RangeFn = std::function<void(int begin, int end)>;
+
+    explicit ThreadPool(const ThreadPoolConfig& cfg = {});
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int threads() const { return (int)workers_.size() + 1; }
+    bool pinned() const { return pinned_; }
+
+    // Blocks until fn has run over the whole range; rethrows the first exception thrown by fn
+    void parallelFor(int begin, int end, int grain, const RangeFn& fn);
+
+private:
+    struct alignas(64) Share {
+        std::atomic<int> next{ 0 };
+        int end = 0;
+    };
+
+    void workerLoop(int idx);
+    void runShares(int self);
+
+    std::vector<std::thread> workers_;
+    std::unique_ptr<Share[]> shares_;
+    bool pinned_ = false;
+
+    std::mutex callMutex_;            // one parallelFor at a time
+    std::mutex m_;
+    std::condition_variable wake_, done_;
+    unsigned long long generation_ = 0;
+    int active_ = 0;
+    bool stop_ = false;
+
+    // Current job (written under m_ before generation_ is bumped)
+    const RangeFn* fn_ = nullptr;
+    int begin_ = 0, end_ = 0, grain_ = 1;
+    std::exception_ptr error_;
+};
+
+// Rows per band for frame kernels: about bandBytes of output, so a band and the source rows
+// it reads stay in L2 while it is being processed
+inline int bandRows(size_t rowBytes, size_t bandBytes = 64 << 10) {
+    return rowBytes >= bandBytes ? 1 : (int)(bandBytes / rowBytes);
+}
+
+// Process-wide pool used by the CPU pipeline. configureCpuThreadPool() replaces it and must
+// not be called while a frame is being processed.
+ThreadPool& cpuThreadPool();
+void configureCpuThreadPool(const ThreadPoolConfig& cfg);
@@ -1,8 +1,18 @@
 #pragma once
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <deque>
 #include <fstream>
+#include <limits>
+#include <memory>
 #include <string>
+#include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 class FpsAverager {
 public:
@@ -18,12 +28,11 @@ public:
         if (dt > 0.000001) {
             double fps = 1.0 / dt;
             dq_.push_back(fps);
-            if (dq_.size() > window_) dq_.pop_front();
+            sum_ += fps;
+            if (dq_.size() > window_) { sum_ -= dq_.front(); dq_.pop_front(); }
         }
         // ƽ
-        double sum = 0;
-        for (auto v : dq_) sum += v;
-        return dq_.empty() ? 0.0 : sum / dq_.size();
+        return dq_.empty() ? 0.0 : sum_ / dq_.size();
     }
 
 private:
@@ -31,6 +40,193 @@ private:
     size_t window_;
     Clock::time_point last_;
     std::deque<double> dq_;
+    double sum_ = 0.0;   // running sum of dq_, so tick() is O(1)
+};
+
+// -------------------- Latency statistics --------------------
+
+// O(1) streaming mean / variance / min / max (Welford)
+class RunningStats {
+public:
+    void add(double x) {
+        ++n_;
+        double d = x - mean_;
+        mean_ += d / (double)n_;
+        m2_ += d * (x - mean_);
+        if (x < min_) min_ = x;
+        if (x > max_) max_ = x;
+    }
+    void reset() { *this = RunningStats(); }
+
+    uint64_t count() const { return n_; }
+    double mean() const { return mean_; }
+    double variance() const { return n_ > 1 ? m2_ / (double)(n_ - 1) : 0.0; }
+    double stddev() const { return std::sqrt(variance()); }
+    double min() const { return n_ ? min_ : 0.0; }
+    double max() const { return n_ ? max_ : 0.0; }
+
+private:
+    uint64_t n_ = 0;
+    double mean_ = 0.0, m2_ = 0.0;
+    double min_ = std::numeric_limits<double>::max();
+    double max_ = std::numeric_limits<double>::lowest();
+};
+
+// Fixed-bucket log-linear (HDR-style) histogram of nanosecond latencies.
+// Values below 2^kSubBits get one bucket each; above that every power of two is split
+// into 2^kSubBits linear sub-buckets (~3% relative error). record() never allocates.
+class LatencyHistogram {
+public:
+    static constexpr int kSubBits = 5;
+    static constexpr int kSub = 1 << kSubBits;
+    static constexpr int kMaxLog2 = 40;   // ~18 min; larger values land in the last bucket
+    static constexpr int kBuckets = kSub + (kMaxLog2 - kSubBits + 1) * kSub;
+
+    void record(uint64_t ns) {
+        ++counts_[bucketOf(ns)];
+        ++total_;
+        if (ns > maxNs_) maxNs_ = ns;
+    }
+    void reset() { counts_.fill(0); total_ = 0; maxNs_ = 0; }
+
+    uint64_t count() const { return total_; }
+    uint64_t maxNs() const { return maxNs_; }
+
+    // Value at quantile q in [0,1]: midpoint of the bucket holding the q-th sample, clamped to max
+    uint64_t percentileNs(double q) const {
+        if (total_ == 0) return 0;
+        uint64_t rank = (uint64_t)std::ceil(std::min(std::max(q, 0.0), 1.0) * (double)total_);
+        if (rank == 0) rank = 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < kBuckets; ++i) {
+            seen += counts_[i];
+            if (seen >= rank)
+                return std::min(bucketLow(i) + bucketWidth(i) / 2, maxNs_);
+        }
+        return maxNs_;
+    }
+
+    static int bucketOf(uint64_t v) {
+        if (v < (uint64_t)kSub) return (int)v;
+        int msb = floorLog2(v);
+        if (msb > kMaxLog2) return kBuckets - 1;
+        int shift = msb - kSubBits;
+        int sub = (int)((v >> shift) & (kSub - 1));
+        return kSub + shift * kSub + sub;
+    }
+    static uint64_t bucketLow(int i) {
+        if (i < kSub) return (uint64_t)i;
+        int shift = (i - kSub) / kSub, sub = (i - kSub) % kSub;
+        return (uint64_t)(kSub + sub) << shift;
+    }
+    static uint64_t bucketWidth(int i) {
+        return i < kSub ? 1 : (uint64_t)1 << ((i - kSub) / kSub);
+    }
+
+private:
+    static int floorLog2(uint64_t v) {
+#if defined(_MSC_VER)
+        unsigned long idx; _BitScanReverse64(&idx, v); return (int)idx;
+#elif defined(__GNUC__) || defined(__clang__)
+        return 63 - __builtin_clzll(v);
+#else
+        int r = 0; while (v >>= 1) ++r; return r;
+#endif
+    }
+
+    std::array<uint64_t, kBuckets> counts_{};
+    uint64_t total_ = 0;
+    uint64_t maxNs_ = 0;
+};
+
+// Summary of one stage, all latencies in microseconds
+struct StageSummary {
+    uint64_t count = 0;
+    double mean_us = 0, stddev_us = 0;
+    double p50_us = 0, p90_us = 0, p99_us = 0, max_us = 0;
+};
+
+// One named pipeline stage: histogram for percentiles + streaming moments for mean/stddev
+class StageStat {
+public:
+    explicit StageStat(std::string name) : name_(std::move(name)) {}
+
+    void recordNs(uint64_t ns) { hist_.record(ns); stats_.add((double)ns); }
+    void recordUs(double us) { recordNs(us > 0.0 ? (uint64_t)(us * 1e3) : 0); }
+    void reset() { hist_.reset(); stats_.reset(); }
+
+    const std::string& name() const { return name_; }
+    uint64_t count() const { return hist_.count(); }
+    const LatencyHistogram& histogram() const { return hist_; }
+
+    StageSummary summary() const {
+        StageSummary s;
+        s.count = hist_.count();
+        s.mean_us = stats_.mean() * 1e-3;
+        s.stddev_us = stats_.stddev() * 1e-3;
+        s.p50_us = hist_.percentileNs(0.50) * 1e-3;
+        s.p90_us = hist_.percentileNs(0.90) * 1e-3;
+        s.p99_us = hist_.percentileNs(0.99) * 1e-3;
+        s.max_us = hist_.maxNs() * 1e-3;
+        return s;
+    }
+
+private:
+    std::string name_;
+    LatencyHistogram hist_;
+    RunningStats stats_;
+};
+
+// RAII timer: records the elapsed time of its scope into a stage
+class ScopedTimer {
+public:
+    using Clock = std::chrono::steady_clock;
+    explicit ScopedTimer(StageStat& stage) : stage_(&stage), t0_(Clock::now()) {}
+    ~ScopedTimer() { stop(); }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    // Record now instead of at scope exit (later calls are no-ops)
+    void stop() {
+        if (!stage_) return;
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0_).count();
+        stage_->recordNs(ns > 0 ? (uint64_t)ns : 0);
+        stage_ = nullptr;
+    }
+    // Drop the measurement (e.g. frame still inside warmup)
+    void cancel() { stage_ = nullptr; }
+
+private:
+    StageStat* stage_;
+    Clock::time_point t0_;
+};
+
+// Registry of named stages. Look a stage up once (stage() may allocate) and keep the
+// reference; recording through StageStat& / ScopedTimer is allocation-free.
+class StageTimings {
+public:
+    StageStat& stage(const std::string& name) {
+        for (auto& s : stages_)
+            if (s->name() == name) return *s;
+        stages_.push_back(std::make_unique<StageStat>(name));
+        return *stages_.back();
+    }
+    const StageStat* find(const std::string& name) const {
+        for (auto& s : stages_)
+            if (s->name() == name) return s.get();
+        return nullptr;
+    }
+    StageSummary summary(const std::string& name) const {
+        const StageStat* s = find(name);
+        return s ? s->summary() : StageSummary{};
+    }
+    void resetAll() { for (auto& s : stages_) s->reset(); }
+
+    size_t size() const { return stages_.size(); }
+    const StageStat& operator[](size_t i) const { return *stages_[i]; }
+
+private:
+    std::vector<std::unique_ptr<StageStat>> stages_;
 };
 
 class CsvLogger {
@@ -0,0 +1,84 @@
+#include "video_recorder.hpp"
+#include <algorithm>
+#include <iostream>
+
+VideoRecorder::VideoRecorder(const RecorderConfig& cfg) : cfg_(cfg) {
+    cfg_.queueDepth = std::max(cfg_.queueDepth, 1);
+    if (cfg_.fps <= 0.0) cfg_.fps = 30.0;
+    encoder_ = std::thread([this] { encodeLoop(); });
+}
+
+VideoRecorder::~VideoRecorder() { stop(); }
+
+bool VideoRecorder::push(const cv::Mat& bgr) {
+    if (bgr.empty()) return false;
+    submitted_.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        if (stopping_ || (int)queue_.size() >= cfg_.queueDepth) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        queue_.push_back(bgr);
+    }
+    cv_.notify_one();
+    return true;
+}
+
+void VideoRecorder::stop() {
+    {
+        std::lock_guard<std::mutex> lk(m_);
+        stopping_ = true;
+    }
+    cv_.notify_one();
+    if (encoder_.joinable()) encoder_.join();
+}
+
+void VideoRecorder::encodeLoop() {
+    cv::VideoWriter writer;
+    cv::Size size;
+    bool openFailed = false;
+    cv::Mat resized;
+    for (;;) {
+        cv::Mat frame;
+        {
+            std::unique_lock<std::mutex> lk(m_);
+            cv_.wait(lk, [&] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) break;     // stopping and drained
+            frame = std::move(queue_.front());
+            queue_.pop_front();
+        }
+
+        if (!writer.isOpened() && !openFailed) {
+            size = frame.size();
+            openFailed = !writer.open(cfg_.path, cfg_.fourcc, cfg_.fps, size, true);
+            if (openFailed) std::cerr << "[Record] cannot open " << cfg_.path << " for writing\n";
+        }
+        if (openFailed) { failed_.fetch_add(1, std::memory_order_relaxed); continue; }
+
+        if (frame.size() != size) {
+            cv::resize(frame, resized, size, 0, 0, cv::INTER_AREA);
+            writer.write(resized);
+        }
+        else writer.write(frame);
+        written_.fetch_add(1, std::memory_order_relaxed);
+    }
+    writer.release();
+}
+
+RecorderStats VideoRecorder::stats() const {
+    RecorderStats s;
+    s.submitted = submitted_.load(std::memory_order_relaxed);
+    s.written = written_.load(std::memory_order_relaxed);
+    s.dropped = dropped_.load(std::memory_order_relaxed);
+    s.failed = failed_.load(std::memory_order_relaxed);
+    return s;
+}
+
+std::string VideoRecorder::summary() const {
+    const RecorderStats s = stats();
+    std::string r = std::to_string(s.written) + " frames written to " + cfg_.path
+        + ", " + std::to_string(s.dropped) + " dropped (encoder behind)";
+    if (s.failed) r += ", " + std::to_string(s.failed) + " lost (writer failed)";
+    return r;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct RecorderConfig {
+    std::string path;                   // output file; the container follows the extension
+    int    fourcc = cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
+    double fps = 30.0;
+    int    queueDepth = 8;              // frames waiting for the encoder before push() drops
+};
+
+struct RecorderStats {
+    uint64_t submitted = 0;             // frames passed to push()
+    uint64_t written = 0;               // frames handed to cv::VideoWriter
+    uint64_t dropped = 0;               // frames refused because the queue was full
+    uint64_t failed = 0;                // frames lost because the writer could not be opened
+};
+
+// Background video sink. push() only queues a reference to the frame (cv::Mat sharing, no
+// pixel copy), so the caller must not write into a pushed frame afterwards; an encoder thread
+// writes the queue to a cv::VideoWriter, opened with the size of the first frame (later frames
+// of another size are resized). When the encoder falls behind the queue stays bounded and new
+// frames are dropped and counted instead of blocking the render or processing thread.
+class VideoRecorder {
+public:
+    explicit VideoRecorder(const RecorderConfig& cfg = {});
+    ~VideoRecorder();                   // stop()
+    VideoRecorder(const VideoRecorder&) = delete;
+    VideoRecorder& operator=(const VideoRecorder&) = delete;
+
+    // Queue a BGR8 frame; false if it was dropped
+    bool push(const cv::Mat& bgr);
+
+    // Encode what is still queued, close the file and join the encoder thread
+    void stop();
+
+    RecorderStats stats() const;
+    // "812 frames written to out.avi, 3 dropped (encoder behind)"
+    std::string summary() const;
+    const RecorderConfig& config() const { return cfg_; }
+
+private:
+    void encodeLoop();
+
+    RecorderConfig cfg_;
+    mutable std::mutex m_;
+    std::condition_variable cv_;
+    std::deque<cv::Mat> queue_;
+    bool stopping_ = false;
+    std::atomic<uint64_t> submitted_{ 0 }, written_{ 0 }, dropped_{ 0 }, failed_{ 0 };
+    std::thread encoder_;
+};
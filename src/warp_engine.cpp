@@ -0,0 +1,189 @@
+#include "warp_engine.hpp"
+#include "pixel_kernels.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+static const long long kOne = 1LL << kWarpFracBits;
+
+// Fixed-point positions are re-anchored from the exact (double) position every kAnchor output
+// pixels, so the rounded step drifts by less than kAnchor * 2^-17 pixel
+static const int kAnchor = 64;
+
+// A matrix within this much of a lattice map moves no sample by more than the blend resolution
+static const double kLatticeEps = 1.0 / (1 << kWarpWeightBits);
+
+static long long floorDiv(long long a, long long b) {     // b > 0
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+static long long ceilDiv(long long a, long long b) {      // b > 0
+    return -floorDiv(-a, b);
+}
+
+// i in [0, n) with lo <= a + i * d < hi, as [i0, i1) (i0 == i1 when empty)
+static void solveSpan(long long a, long long d, long long lo, long long hi, int n, int& i0, int& i1) {
+    long long b = 0, e = n;
+    if (d == 0) {
+        if (a < lo || a >= hi) e = 0;
+    }
+    else if (d > 0) {
+        b = ceilDiv(lo - a, d);
+        e = floorDiv(hi - 1 - a, d) + 1;
+    }
+    else {
+        b = ceilDiv(a - hi + 1, -d);
+        e = floorDiv(a - lo, -d) + 1;
+    }
+    b = std::min(std::max(b, 0LL), (long long)n);
+    e = std::min(e, (long long)n);
+    i0 = (int)b;
+    i1 = (int)std::max(b, e);
+}
+
+// Intersection of the spans where a + i * da lies in [loA, hiA) and b + i * db in [loB, hiB)
+static void solveSpan2(long long a, long long da, long long loA, long long hiA,
+    long long b, long long db, long long loB, long long hiB, int n, int& i0, int& i1)
+{
+    int a0, a1, b0, b1;
+    solveSpan(a, da, loA, hiA, n, a0, a1);
+    solveSpan(b, db, loB, hiB, n, b0, b1);
+    i0 = std::max(a0, b0);
+    i1 = std::max(i0, std::min(a1, b1));
+}
+
+// Bilinear sample at a 16.16 position near the border: taps outside read as black. Same
+// weights and rounding as the warpSpanBilinear kernels.
+static void sampleChecked(const cv::Mat& src, long long U, long long V, uchar* out) {
+    const int one = 1 << kWarpWeightBits, shift = 2 * kWarpWeightBits;
+    const int x0 = (int)(U >> kWarpFracBits), y0 = (int)(V >> kWarpFracBits);
+    const int ax = (int)((U >> (kWarpFracBits - kWarpWeightBits)) & (one - 1));
+    const int ay = (int)((V >> (kWarpFracBits - kWarpWeightBits)) & (one - 1));
+    const int w[4] = { (one - ax) * (one - ay), ax * (one - ay), (one - ax) * ay, ax * ay };
+    int acc[3] = { 1 << (shift - 1), 1 << (shift - 1), 1 << (shift - 1) };
+    for (int k = 0; k < 4; ++k) {
+        const int xx = x0 + (k & 1), yy = y0 + (k >> 1);
+        if (xx < 0 || yy < 0 || xx >= src.cols || yy >= src.rows) continue;
+        const uchar* s = src.ptr<uchar>(yy) + 3 * xx;
+        acc[0] += w[k] * s[0]; acc[1] += w[k] * s[1]; acc[2] += w[k] * s[2];
+    }
+    for (int c = 0; c < 3; ++c) out[c] = (uchar)(acc[c] >> shift);
+}
+
+AffineWarp::AffineWarp(const cv::Matx33f& M, int cols, int rows) : cols_(cols), rows_(rows) {
+    // Integer-centered source position of output pixel (0, 0) and its steps along x and y
+    const double m00 = M(0, 0), m01 = M(0, 1), m10 = M(1, 0), m11 = M(1, 1);
+    cu_ = m00 * 0.5 + m01 * 0.5 + M(0, 2) - 0.5;
+    cv_ = m10 * 0.5 + m11 * 0.5 + M(1, 2) - 0.5;
+    cuy_ = m01; cvy_ = m11;
+    mu_ = m00; mv_ = m10;
+    stepU_ = std::llround(m00 * kOne);
+    stepV_ = std::llround(m10 * kOne);
+
+    // Lattice maps: the 2x2 part is a signed permutation and pixel centers land on pixel
+    // centers, so every output pixel is a copy of one source pixel
+    const double r00 = std::round(m00), r01 = std::round(m01), r10 = std::round(m10), r11 = std::round(m11);
+    const double ru = std::round(cu_), rv = std::round(cv_);
+    const bool perm = std::abs(r00) + std::abs(r01) == 1 && std::abs(r10) + std::abs(r11) == 1
+        && std::abs(r00) + std::abs(r10) == 1;
+    const double errU = std::abs(m00 - r00) * cols + std::abs(m01 - r01) * rows + std::abs(cu_ - ru);
+    const double errV = std::abs(m10 - r10) * cols + std::abs(m11 - r11) * rows + std::abs(cv_ - rv);
+    if (perm && errU < kLatticeEps && errV < kLatticeEps
+        && std::abs(ru) < INT_MAX / 2 && std::abs(rv) < INT_MAX / 2) {
+        u0_ = (int)ru; v0_ = (int)rv;
+        uy_ = (int)r01; vy_ = (int)r11;
+        du_ = (int)r00; dv_ = (int)r10;
+        kind_ = du_ == 1 ? Kind::Copy : du_ == -1 ? Kind::Reverse : Kind::Column;
+    }
+}
+
+static inline int clampTo(int v, int lo, int hi) { return std::min(std::max(v, lo), hi); }
+
+void AffineWarp::row(const cv::Mat& src, int y, uchar* dst, int x0, int x1) const {
+    CV_Assert(src.type() == CV_8UC3 && src.cols == cols_ && src.rows == rows_);
+    CV_Assert(0 <= x0 && x0 <= x1 && x1 <= cols_);
+    if (kind_ == Kind::Bilinear) bilinearRow(src, y, dst, x0, x1);
+    else latticeRow(src, y, dst, x0, x1);
+}
+
+void AffineWarp::latticeRow(const cv::Mat& src, int y, uchar* dst, int x0, int x1) const {
+    const long long su = u0_ + (long long)y * uy_, sv = v0_ + (long long)y * vy_;
+    int i0, i1;
+    solveSpan2(su, du_, 0, cols_, sv, dv_, 0, rows_, cols_, i0, i1);
+    i0 = clampTo(i0, x0, x1); i1 = clampTo(i1, x0, x1);
+    std::memset(dst + 3 * (size_t)x0, 0, (size_t)(i0 - x0) * 3);
+    std::memset(dst + 3 * (size_t)i1, 0, (size_t)(x1 - i1) * 3);
+    if (i1 == i0) return;
+
+    const uchar* s = src.ptr<uchar>((int)(sv + (long long)i0 * dv_)) + 3 * (su + (long long)i0 * du_);
+    uchar* d = dst + 3 * (size_t)i0;
+    if (kind_ == Kind::Copy) {
+        std::memcpy(d, s, (size_t)(i1 - i0) * 3);
+        return;
+    }
+    // Reverse walks the source row backwards, Column walks a source column
+    const ptrdiff_t stride = (ptrdiff_t)dv_ * (ptrdiff_t)src.step + 3 * du_;
+    for (int i = i0; i < i1; ++i, s += stride, d += 3) {
+        d[0] = s[0]; d[1] = s[1]; d[2] = s[2];
+    }
+}
+
+void AffineWarp::bilinearRow(const cv::Mat& src, int y, uchar* dst, int x0, int x1) const {
+    const double pu = cu_ + y * cuy_, pv = cv_ + y * cvy_;
+    // Position of output pixel i: anchored at the start of its kAnchor block, then stepped
+    auto posU = [&](int i) { const int k = i & ~(kAnchor - 1); return std::llround((pu + k * mu_) * kOne) + (i - k) * stepU_; };
+    auto posV = [&](int i) { const int k = i & ~(kAnchor - 1); return std::llround((pv + k * mv_) * kOne) + (i - k) * stepV_; };
+
+    // Spans are solved on the unanchored line U + i * stepU, which stays within `slack` of the
+    // anchored positions: pixels with at least one tap inside, and those with all four inside
+    const long long U = posU(0), V = posV(0), W = cols_, H = rows_;
+    const long long slack = 2 + cols_ / 2;
+    int t0, t1, i0, i1;
+    solveSpan2(U, stepU_, -kOne - slack, W * kOne + slack, V, stepV_, -kOne - slack, H * kOne + slack, cols_, t0, t1);
+    solveSpan2(U, stepU_, slack, (W - 1) * kOne - slack, V, stepV_, slack, (H - 1) * kOne - slack, cols_, i0, i1);
+    if (i1 == i0) i0 = i1 = t1;
+    t0 = clampTo(t0, x0, x1); i0 = clampTo(i0, x0, x1);
+    i1 = clampTo(i1, x0, x1); t1 = clampTo(t1, x0, x1);
+
+    std::memset(dst + 3 * (size_t)x0, 0, (size_t)(t0 - x0) * 3);
+    std::memset(dst + 3 * (size_t)t1, 0, (size_t)(x1 - t1) * 3);
+    for (int i = t0; i < i0; ++i) sampleChecked(src, posU(i), posV(i), dst + 3 * i);
+    for (int i = i1; i < t1; ++i) sampleChecked(src, posU(i), posV(i), dst + 3 * i);
+    if (i1 == i0) return;
+
+    // Inner positions are below 2^31 by construction; the kernel needs the steps and byte
+    // offsets in an int as well
+    const bool fits = cols_ < (1 << (31 - kWarpFracBits)) && rows_ < (1 << (31 - kWarpFracBits))
+        && std::abs(stepU_) <= INT_MAX && std::abs(stepV_) <= INT_MAX
+        && (double)src.step * rows_ < (double)INT_MAX;
+    if (!fits) {
+        for (int i = i0; i < i1; ++i) sampleChecked(src, posU(i), posV(i), dst + 3 * i);
+        return;
+    }
+    const PixelKernels& k = pixelKernels();
+    for (int a = i0; a < i1;) {
+        const int b = std::min(i1, (a & ~(kAnchor - 1)) + kAnchor);
+        k.warpSpanBilinear(src.data, src.step, (int)posU(a), (int)posV(a), (int)stepU_, (int)stepV_, b - a, dst + 3 * a);
+        a = b;
+    }
+}
+
+const char* warpKindName(AffineWarp::Kind k) {
+    switch (k) {
+    case AffineWarp::Kind::Copy:     return "copy";
+    case AffineWarp::Kind::Reverse:  return "reverse";
+    case AffineWarp::Kind::Column:   return "column";
+    case AffineWarp::Kind::Bilinear: return "bilinear";
+    }
+    return "unknown";
+}
+
+void warpAffineBGR(const cv::Mat& src, cv::Mat& dst, const cv::Matx33f& M) {
+    CV_Assert(src.type() == CV_8UC3 && src.data != dst.data);
+    dst.create(src.size(), CV_8UC3);
+    const AffineWarp warp(M, src.cols, src.rows);
+    cpuThreadPool().parallelFor(0, src.rows, bandRows((size_t)src.cols * 3), [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y) warp.row(src, y, dst.ptr<uchar>(y));
+    });
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+
+// Bilinear affine warp of an 8UC3 frame onto a frame of the same size, planned once per
+// matrix (affineMatrix convention: output pixel center (x + 0.5, y + 0.5) samples the source
+// at M * (x + 0.5, y + 0.5), black outside). The plan picks the cheapest exact kernel:
+//   Copy      integer translation: one memcpy per row
+//   Reverse   180 degree rotation / horizontal mirror with integer offset: reversed row copy
+//   Column    90 / 270 degree rotation (or transpose) with integer offset: a source column per row
+//   Bilinear  anything else: source positions stepped in 16.16 fixed point, the inner span of
+//             every row through pixelKernels().warpSpanBilinear without bounds checks
+// Each row's valid span is solved analytically; pixels that map fully outside the source are
+// zero-filled and never sampled.
+class AffineWarp {
+public:
+    enum class Kind { Copy, Reverse, Column, Bilinear };
+
+    AffineWarp(const cv::Matx33f& M, int cols, int rows);
+
+    Kind kind() const { return kind_; }
+
+    // Output row y (cols BGR pixels) into dst; src must be cols x rows
+    void row(const cv::Mat& src, int y, uchar* dst) const { row(src, y, dst, 0, cols_); }
+    // Only pixels [x0, x1) of the row (dst still points at pixel 0); identical to the full row
+    void row(const cv::Mat& src, int y, uchar* dst, int x0, int x1) const;
+
+private:
+    void latticeRow(const cv::Mat& src, int y, uchar* dst, int x0, int x1) const;
+    void bilinearRow(const cv::Mat& src, int y, uchar* dst, int x0, int x1) const;
+
+    Kind kind_ = Kind::Bilinear;
+    int cols_, rows_;
+    // Lattice kinds: source pixel of output (0, y) is (u0 + y * uy, v0 + y * vy), and each
+    // output step moves it by (du, dv)
+    int u0_ = 0, v0_ = 0, uy_ = 0, vy_ = 0, du_ = 0, dv_ = 0;
+    // Bilinear: integer-centered source position of output (0, y) is (cu + y * cuy, cv + y * cvy)
+    double cu_ = 0, cv_ = 0, cuy_ = 0, cvy_ = 0;
+    double mu_ = 0, mv_ = 0;            // per output pixel
+    long long stepU_ = 0, stepV_ = 0;   // the same, 16.16
+};
+
+const char* warpKindName(AffineWarp::Kind k);
+
+// Full frame through AffineWarp, row bands on the CPU thread pool
+void warpAffineBGR(const cv::Mat& src, cv::Mat& dst, const cv::Matx33f& M);